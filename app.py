@@ -13,33 +13,19 @@ def matrix_to_numpy(matrix):
     Args:
         matrix: mlcpp.Matrix object
     Returns:
-        numpy.ndarray: Converted matrix
+        numpy.ndarray: Zero-copy float32 view of the matrix
     """
-    rows, cols = matrix.rows(), matrix.cols()
-    result = np.zeros((rows, cols))
-    # Copy each element individually due to C++/Python binding
-    for i in range(rows):
-        for j in range(cols):
-            result[i, j] = matrix.at(i, j)
-    return result
+    return matrix.numpy()
 
 def numpy_to_matrix(array):
     """Convert numpy array to mlcpp Matrix for computation
     Args:
         array: numpy.ndarray input
     Returns:
-        mlcpp.Matrix: Converted matrix
+        mlcpp.Matrix: Matrix sharing memory with the float32 array
     """
-    rows, cols = array.shape
-    matrix = mlcpp.Matrix(rows, cols)
-    # Set each element individually due to C++/Python binding
-    for i in range(rows):
-        for j in range(cols):
-            val = array[i, j]
-            # Two-step assignment required by C++ binding
-            ref = matrix.at(i, j)
-            ref = val
-    return matrix
+    # C-contiguous float32 arrays are wrapped without copying
+    return mlcpp.Matrix(np.ascontiguousarray(array, dtype=np.float32))
 
 def main():
     """Main application entry point"""
@@ -114,13 +100,7 @@ def main():
     for i in range(X.shape[0]):
         for j in range(X.shape[1]):
             # Create input matrix for current point
-            input_matrix = mlcpp.Matrix(1, 2)
-            # Get references for modification
-            x_val = input_matrix.at(0, 0)
-            y_val = input_matrix.at(0, 1)
-            # Set input values
-            x_val = X[i, j]
-            y_val = Y[i, j]
+            input_matrix = numpy_to_matrix(np.array([[X[i, j], Y[i, j]]]))
             # Forward pass through network
             output = nn.forward(input_matrix)
             Z[i, j] = output.at(0, 0)
@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+"""Compare two mlcpp_bench JSON results and flag performance regressions.
+
+Usage:
+    mlcpp_bench --benchmark_out=before.json --benchmark_out_format=json
+    ... change kernels, rebuild ...
+    mlcpp_bench --benchmark_out=after.json --benchmark_out_format=json
+    python benchmarks/compare.py before.json after.json --threshold 0.05
+
+A benchmark regresses when its time grows by more than the threshold
+(a fraction, 0.05 = 5%). The exit status is 1 when anything regressed, so
+the script can gate CI. Runs made with --benchmark_repetitions are compared
+by their median.
+"""
+import argparse
+import json
+import sys
+
+# Factor converting each Google Benchmark time unit to nanoseconds
+TIME_UNITS = {"ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9}
+
+# Context keys that must match for the comparison to be meaningful
+CONTEXT_KEYS = ("mlcpp_kernel_isa", "mlcpp_num_threads", "num_cpus")
+
+
+def load(path, metric):
+    """Return (context, {benchmark name: time in ns}) for one result file."""
+    with open(path) as f:
+        data = json.load(f)
+
+    medians = {}
+    samples = {}
+    for bench in data.get("benchmarks", []):
+        if bench.get("error_occurred"):
+            continue
+        time = bench[metric] * TIME_UNITS[bench.get("time_unit", "ns")]
+        name = bench.get("run_name", bench["name"])
+        if bench.get("run_type") == "aggregate":
+            if bench.get("aggregate_name") == "median":
+                medians[name] = time
+        else:
+            samples.setdefault(name, []).append(time)
+
+    times = {name: sum(values) / len(values) for name, values in samples.items()}
+    times.update(medians)
+    return data.get("context", {}), times
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("baseline", help="JSON output of the reference run")
+    parser.add_argument("contender", help="JSON output of the run under test")
+    parser.add_argument("--threshold", type=float, default=0.05,
+                        help="relative slowdown reported as a regression (default 0.05)")
+    parser.add_argument("--metric", choices=("real_time", "cpu_time"), default="real_time",
+                        help="time to compare (default real_time)")
+    args = parser.parse_args()
+
+    base_context, base = load(args.baseline, args.metric)
+    new_context, new = load(args.contender, args.metric)
+
+    for key in CONTEXT_KEYS:
+        if base_context.get(key) != new_context.get(key):
+            print(f"warning: {key} differs: {base_context.get(key)} vs {new_context.get(key)}",
+                  file=sys.stderr)
+
+    common = [name for name in base if name in new]
+    missing = sorted(set(base) ^ set(new))
+    if not common:
+        print("No benchmarks in common", file=sys.stderr)
+        return 1
+
+    width = max(len(name) for name in common)
+    print(f"{'Benchmark':<{width}}  {'Baseline':>12}  {'Contender':>12}  {'Change':>8}")
+    regressions = 0
+    for name in common:
+        change = new[name] / base[name] - 1.0
+        if change > args.threshold:
+            status = "REGRESSION"
+            regressions += 1
+        elif change < -args.threshold:
+            status = "improved"
+        else:
+            status = ""
+        print(f"{name:<{width}}  {base[name]:>10.0f}ns  {new[name]:>10.0f}ns  {change:>+7.1%}  {status}")
+
+    if missing:
+        print(f"\n{len(missing)} benchmark(s) present in only one file: {', '.join(missing)}")
+    print(f"\n{regressions} regression(s) beyond {args.threshold:.0%} out of {len(common)} benchmarks")
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
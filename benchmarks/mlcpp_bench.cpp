@@ -0,0 +1,279 @@
+// Kernel and inference benchmarks
+// Run with --benchmark_out=results.json --benchmark_out_format=json and
+// compare two runs with benchmarks/compare.py
+#include <benchmark/benchmark.h>
+#include "cpu_dispatch.hpp"
+#include "half.hpp"
+#include "matrix.hpp"
+#include "neural.hpp"
+#include "optimizations.hpp"
+#include "sparse_matrix.hpp"
+#include "static_network.hpp"
+#include "thread_pool.hpp"
+#include "trainer.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+
+namespace {
+
+// Deterministic, non-trivial contents so no kernel sees all zeros
+void fill(ml::Matrix& m, float seed) {
+    float* data = m.data();
+    for (size_t i = 0; i < m.rows() * m.cols(); ++i) {
+        data[i] = static_cast<float>((i * 7 + static_cast<size_t>(seed * 13)) % 17) * 0.0625f - 0.5f;
+    }
+}
+
+// Reports floating-point operations per second next to the timings
+void set_flops(benchmark::State& state, double flops_per_iteration) {
+    state.counters["FLOPS"] = benchmark::Counter(flops_per_iteration,
+                                                 benchmark::Counter::kIsIterationInvariantRate,
+                                                 benchmark::Counter::kIs1000);
+}
+
+// Square sizes and the skinny inference shapes (few rows, wide layers)
+void gemm_shapes(benchmark::internal::Benchmark* b) {
+    for (long n : {64, 128, 256, 512, 1024}) {
+        b->Args({n, n, n});
+    }
+    for (long m : {1, 8, 32}) {
+        b->Args({m, 1024, 1024});
+    }
+    b->Args({1024, 64, 1024});
+    b->ArgNames({"m", "n", "k"});
+}
+
+// Raw kernel on preallocated buffers
+void BM_BlockMultiply(benchmark::State& state) {
+    size_t m = state.range(0), n = state.range(1), k = state.range(2);
+    ml::Matrix a(m, k), b(k, n), c(m, n);
+    fill(a, 1.0f);
+    fill(b, 2.0f);
+    for (auto _ : state) {
+        ml::block_multiply(c.data(), a.data(), b.data(), m, n, k);
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+    set_flops(state, 2.0 * m * n * k);
+}
+BENCHMARK(BM_BlockMultiply)->Apply(gemm_shapes)->UseRealTime();
+
+// Matrix-level product, including allocation of the result
+void BM_MatrixProduct(benchmark::State& state) {
+    size_t m = state.range(0), n = state.range(1), k = state.range(2);
+    ml::Matrix a(m, k), b(k, n);
+    fill(a, 1.0f);
+    fill(b, 2.0f);
+    for (auto _ : state) {
+        ml::Matrix c = a * b;
+        benchmark::DoNotOptimize(c.data());
+    }
+    set_flops(state, 2.0 * m * n * k);
+}
+BENCHMARK(BM_MatrixProduct)->Apply(gemm_shapes)->UseRealTime();
+
+// Element-wise kernels: each element is read twice and written once
+template <void (*Kernel)(float*, const float*, size_t)>
+void BM_Elementwise(benchmark::State& state) {
+    size_t size = state.range(0);
+    ml::Matrix a(1, size), b(1, size);
+    fill(a, 1.0f);
+    fill(b, 2.0f);
+    for (auto _ : state) {
+        Kernel(a.data(), b.data(), size);
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * 3 * size * sizeof(float));
+}
+BENCHMARK_TEMPLATE(BM_Elementwise, ml::simd_add)
+    ->Name("BM_SimdAdd")->RangeMultiplier(8)->Range(1 << 10, 1 << 24)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Elementwise, ml::simd_subtract)
+    ->Name("BM_SimdSubtract")->RangeMultiplier(8)->Range(1 << 10, 1 << 24)->UseRealTime();
+
+// Dense a times a pruned 1024 x 1024 b keeping one 1 x block_cols block in
+// every 1 / density; FLOPS counts only the stored values
+void BM_Spmm(benchmark::State& state) {
+    size_t m = state.range(0);
+    size_t block_cols = state.range(1);
+    size_t keep_every = 100 / state.range(2);
+    const size_t n = 1024, k = 1024;
+    ml::Matrix a(m, k), dense(k, n), c(m, n);
+    fill(a, 1.0f);
+    fill(dense, 2.0f);
+    for (size_t i = 0; i < k; ++i)
+        for (size_t j = 0; j < n; ++j)
+            if ((i * 7 + j / block_cols) % keep_every != 0) dense.at(i, j) = 0.0f;
+    ml::SparseMatrix b(dense, 1, block_cols);
+    for (auto _ : state) {
+        ml::spmm(c.view(), a.view(), b);
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+    set_flops(state, 2.0 * m * b.stored_values());
+}
+BENCHMARK(BM_Spmm)
+    ->ArgsProduct({{1, 64}, {1, 8}, {5, 10, 20}})->ArgNames({"m", "block_cols", "percent"})->UseRealTime();
+
+// Fused layer GEMM through 2048 x 2048 weights stored at each precision
+// (0 = float32, 1 = bfloat16, 2 = float16); small batches are bound by the
+// weight reads, which half precision halves
+void BM_WeightPrecision(benchmark::State& state) {
+    size_t m = state.range(0);
+    auto precision = static_cast<ml::Precision>(state.range(1));
+    const size_t n = 2048, k = 2048;
+    ml::Matrix a(m, k), w(k, n), c(m, n), bias(1, n);
+    fill(a, 1.0f);
+    fill(w, 2.0f);
+    std::optional<ml::HalfMatrix> half;
+    if (precision != ml::Precision::Float32) {
+        half.emplace(w, precision);
+    }
+    for (auto _ : state) {
+        if (half) {
+            ml::gemm_bias_activation(c.view(), a.view(), *half, bias.data(), ml::ActivationType::ReLU);
+        } else {
+            ml::gemm_bias_activation(c.view(), a.view(), w.view(), bias.data(), ml::ActivationType::ReLU);
+        }
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+    set_flops(state, 2.0 * m * n * k);
+}
+BENCHMARK(BM_WeightPrecision)
+    ->ArgsProduct({{1, 8, 64}, {0, 1, 2}})->ArgNames({"m", "precision"})->UseRealTime();
+
+constexpr size_t FORWARD_INPUTS = 256;
+constexpr size_t FORWARD_WIDTH = 512;
+constexpr size_t FORWARD_OUTPUTS = 10;
+
+// depth hidden ReLU layers of FORWARD_WIDTH followed by a sigmoid output
+void add_layers(ml::NeuralNetwork& network, size_t depth) {
+    size_t inputs = FORWARD_INPUTS;
+    for (size_t i = 0; i < depth; ++i) {
+        network.add_layer(inputs, FORWARD_WIDTH, ml::ActivationType::ReLU);
+        inputs = FORWARD_WIDTH;
+    }
+    network.add_layer(inputs, FORWARD_OUTPUTS, ml::ActivationType::Sigmoid);
+}
+
+void forward_shapes(benchmark::internal::Benchmark* b) {
+    for (long depth : {1, 4}) {
+        for (long batch : {1, 8, 64, 256}) {
+            b->Args({batch, depth});
+        }
+    }
+    b->ArgNames({"batch", "depth"});
+}
+
+// Stateful forward: latency is the reported time per iteration,
+// throughput is samples (rows) per second
+void BM_Forward(benchmark::State& state) {
+    size_t batch = state.range(0);
+    ml::NeuralNetwork network;
+    add_layers(network, state.range(1));
+    ml::Matrix input(batch, FORWARD_INPUTS);
+    fill(input, 3.0f);
+    for (auto _ : state) {
+        ml::Matrix output = network.forward(input);
+        benchmark::DoNotOptimize(output.data());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * batch);
+}
+BENCHMARK(BM_Forward)->Apply(forward_shapes)->UseRealTime();
+
+// Stateless forward into a reused InferenceContext (no allocation)
+void BM_ForwardContext(benchmark::State& state) {
+    size_t batch = state.range(0);
+    ml::NeuralNetwork network;
+    add_layers(network, state.range(1));
+    ml::InferenceContext context(network, batch);
+    ml::Matrix input(batch, FORWARD_INPUTS);
+    fill(input, 3.0f);
+    for (auto _ : state) {
+        const ml::Matrix& output = network.forward(input, context);
+        benchmark::DoNotOptimize(output.data());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * batch);
+}
+BENCHMARK(BM_ForwardContext)->Apply(forward_shapes)->UseRealTime();
+
+// Single-row latency of a small fixed MLP (32 -> 64 -> 64 -> 8): the dynamic
+// network (engine 0), its stateless path with a context (1) and the
+// compile-time StaticNetwork loaded from it (2)
+using SmallScorer = ml::StaticNetwork<ml::Dense<32, 64, ml::ActivationType::ReLU>,
+                                      ml::Dense<64, 64, ml::ActivationType::ReLU>,
+                                      ml::Dense<64, 8, ml::ActivationType::Sigmoid>>;
+
+void BM_SmallNetworkLatency(benchmark::State& state) {
+    ml::NeuralNetwork network;
+    network.add_layer(32, 64, ml::ActivationType::ReLU);
+    network.add_layer(64, 64, ml::ActivationType::ReLU);
+    network.add_layer(64, 8, ml::ActivationType::Sigmoid);
+    ml::Matrix input(1, 32);
+    fill(input, 3.0f);
+    ml::InferenceContext context(network, 1);
+    auto scorer = std::make_unique<SmallScorer>(network);
+    SmallScorer::Input row;
+    std::copy(input.data(), input.data() + 32, row.begin());
+    for (auto _ : state) {
+        switch (state.range(0)) {
+        case 0: {
+            ml::Matrix output = network.forward(input);
+            benchmark::DoNotOptimize(output.data());
+            break;
+        }
+        case 1:
+            benchmark::DoNotOptimize(network.forward(input, context).data());
+            break;
+        default: {
+            benchmark::DoNotOptimize(row.data());
+            SmallScorer::Output output = scorer->forward(row);
+            benchmark::DoNotOptimize(output.data());
+            break;
+        }
+        }
+    }
+    set_flops(state, 2.0 * (32 * 64 + 64 * 64 + 64 * 8));
+}
+BENCHMARK(BM_SmallNetworkLatency)->DenseRange(0, 2)->ArgName("engine");
+
+// One epoch of DataParallelTrainer over 4096 rows in minibatches of 256
+// Synchronous (mode 0) or Hogwild (mode 1); compare workers to see scaling
+void BM_TrainEpoch(benchmark::State& state) {
+    constexpr size_t rows = 4096;
+    ml::NeuralNetwork network;
+    add_layers(network, 2);
+    ml::Matrix inputs(rows, FORWARD_INPUTS), targets(rows, FORWARD_OUTPUTS);
+    fill(inputs, 3.0f);
+    fill(targets, 5.0f);
+    ml::TrainerConfig config;
+    config.num_workers = state.range(0);
+    config.mode = state.range(1) ? ml::TrainingMode::Hogwild : ml::TrainingMode::Synchronous;
+    ml::DataParallelTrainer trainer(network, config);
+    for (auto _ : state) {
+        ml::EpochStats stats = trainer.train_epoch(inputs, targets, 0.01f);
+        benchmark::DoNotOptimize(stats.loss);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * rows);
+}
+BENCHMARK(BM_TrainEpoch)
+    ->ArgsProduct({{1, 2, 4, 8}, {0, 1}})->ArgNames({"workers", "mode"})->UseRealTime();
+
+} // namespace
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    // Recorded in the JSON context so runs on different kernels are never
+    // compared by accident
+    benchmark::AddCustomContext("mlcpp_kernel_isa", ml::get_kernel_isa());
+    benchmark::AddCustomContext("mlcpp_num_threads", std::to_string(ml::get_num_threads()));
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,253 @@
+#pragma once
+#include "isa.hpp"
+#include <immintrin.h>
+#include <cstdint>
+#include <cstring>
+
+namespace ml {
+
+// Enumeration of supported activation functions for neural network layers
+enum class ActivationType {
+    ReLU,    // Rectified Linear Unit f(x) = max(0,x) - Good for hidden layers
+    Sigmoid, // Logistic function f(x) = 1/(1+e^(-x)) - Good for binary classification
+    Tanh     // Hyperbolic tangent f(x) = tanh(x) - Alternative to sigmoid
+};
+
+// Compiled per instruction-set variant, see isa.hpp
+namespace MLCPP_ISA {
+
+// Fast activation approximations shared by the scalar, AVX2 and AVX-512 code
+// paths. Scalar and vector versions evaluate the same polynomials, so edge
+// tiles and full tiles of a GEMM epilogue agree to within rounding of the
+// last bit
+//
+// Error bounds (measured against double-precision references):
+//   exp_approx:     relative error <= 3e-7 on [-87, 88]; returns 0 below -87.34 and
+//                   saturates at exp(88.38) ~= 2.4e38 above
+//   sigmoid_approx: absolute error <= 1.2e-7 everywhere
+//   tanh_approx:    absolute error <= 2.4e-7 everywhere, relative error <= 3e-7 for |x| < 0.625
+// NaN inputs come out as NaN from all three, as with std::exp, so a diverged
+// network stays visible in its outputs
+
+namespace approx {
+
+// Cephes-style expf: exp(x) = 2^n * exp(r) with |r| <= ln(2)/2 and a
+// degree-6 minimax polynomial for exp(r)
+constexpr float EXP_HI = 88.3762626647949f;
+constexpr float EXP_LO = -87.3365447504019f;
+constexpr float LOG2E = 1.44269504088896341f;
+constexpr float LN2_HI = 0.693359375f;
+constexpr float LN2_LO = -2.12194440e-4f;
+constexpr float EXP_P0 = 1.9875691500e-4f;
+constexpr float EXP_P1 = 1.3981999507e-3f;
+constexpr float EXP_P2 = 8.3334519073e-3f;
+constexpr float EXP_P3 = 4.1665795894e-2f;
+constexpr float EXP_P4 = 1.6666665459e-1f;
+constexpr float EXP_P5 = 5.0000001201e-1f;
+
+// Cephes tanhf odd polynomial, used for |x| < TANH_SMALL where 1 - 2/(e^2x+1)
+// would lose relative precision to cancellation
+constexpr float TANH_SMALL = 0.625f;
+constexpr float TANH_P0 = -5.70498872745e-3f;
+constexpr float TANH_P1 = 2.06390887954e-2f;
+constexpr float TANH_P2 = -5.37397155531e-2f;
+constexpr float TANH_P3 = 1.33314422036e-1f;
+constexpr float TANH_P4 = -3.33332819422e-1f;
+
+inline float exp_approx(float x) {
+    if (x != x) {
+        return x; // NaN would reach the integer conversion below
+    }
+    if (x < EXP_LO) {
+        return 0.0f;
+    }
+    x = x > EXP_HI ? EXP_HI : x;
+    float n = __builtin_floorf(x * LOG2E + 0.5f);
+    float r = x - n * LN2_HI - n * LN2_LO;
+    float p = EXP_P0;
+    p = p * r + EXP_P1;
+    p = p * r + EXP_P2;
+    p = p * r + EXP_P3;
+    p = p * r + EXP_P4;
+    p = p * r + EXP_P5;
+    p = p * (r * r) + r + 1.0f;
+    int32_t bits = (static_cast<int32_t>(n) + 127) << 23;
+    float scale;
+    std::memcpy(&scale, &bits, sizeof(scale));
+    return p * scale;
+}
+
+inline float sigmoid_approx(float x) {
+    return 1.0f / (1.0f + exp_approx(-x));
+}
+
+inline float tanh_approx(float x) {
+    float ax = x < 0.0f ? -x : x;
+    if (ax < TANH_SMALL) {
+        float z = x * x;
+        float p = TANH_P0;
+        p = p * z + TANH_P1;
+        p = p * z + TANH_P2;
+        p = p * z + TANH_P3;
+        p = p * z + TANH_P4;
+        return p * z * x + x;
+    }
+    float t = 1.0f - 2.0f / (exp_approx(2.0f * ax) + 1.0f);
+    return x < 0.0f ? -t : t;
+}
+
+#if defined(__AVX2__) && defined(__FMA__)
+
+inline __m256 exp_approx(__m256 x) {
+    __m256 input = x;
+    __m256 underflow = _mm256_cmp_ps(x, _mm256_set1_ps(EXP_LO), _CMP_LT_OQ);
+    x = _mm256_min_ps(x, _mm256_set1_ps(EXP_HI));
+    __m256 n = _mm256_floor_ps(_mm256_fmadd_ps(x, _mm256_set1_ps(LOG2E), _mm256_set1_ps(0.5f)));
+    __m256 r = _mm256_fnmadd_ps(n, _mm256_set1_ps(LN2_HI), x);
+    r = _mm256_fnmadd_ps(n, _mm256_set1_ps(LN2_LO), r);
+    __m256 p = _mm256_set1_ps(EXP_P0);
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(EXP_P1));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(EXP_P2));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(EXP_P3));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(EXP_P4));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(EXP_P5));
+    p = _mm256_fmadd_ps(p, _mm256_mul_ps(r, r), _mm256_add_ps(r, _mm256_set1_ps(1.0f)));
+    __m256i bits = _mm256_slli_epi32(
+        _mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+    __m256 result = _mm256_andnot_ps(underflow, _mm256_mul_ps(p, _mm256_castsi256_ps(bits)));
+    // The clamp above replaced NaN lanes with EXP_HI; put them back
+    return _mm256_blendv_ps(result, input, _mm256_cmp_ps(input, input, _CMP_UNORD_Q));
+}
+
+inline __m256 sigmoid_approx(__m256 x) {
+    __m256 one = _mm256_set1_ps(1.0f);
+    __m256 e = exp_approx(_mm256_sub_ps(_mm256_setzero_ps(), x));
+    return _mm256_div_ps(one, _mm256_add_ps(one, e));
+}
+
+inline __m256 tanh_approx(__m256 x) {
+    __m256 sign_mask = _mm256_set1_ps(-0.0f);
+    __m256 ax = _mm256_andnot_ps(sign_mask, x);
+    __m256 sign = _mm256_and_ps(sign_mask, x);
+
+    // Small-argument polynomial
+    __m256 z = _mm256_mul_ps(x, x);
+    __m256 p = _mm256_set1_ps(TANH_P0);
+    p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(TANH_P1));
+    p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(TANH_P2));
+    p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(TANH_P3));
+    p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(TANH_P4));
+    __m256 small = _mm256_fmadd_ps(_mm256_mul_ps(p, z), x, x);
+
+    // Large-argument form 1 - 2 / (e^(2|x|) + 1), sign restored afterwards
+    __m256 one = _mm256_set1_ps(1.0f);
+    __m256 e = exp_approx(_mm256_add_ps(ax, ax));
+    __m256 large = _mm256_sub_ps(one, _mm256_div_ps(_mm256_set1_ps(2.0f), _mm256_add_ps(e, one)));
+    large = _mm256_or_ps(large, sign);
+
+    __m256 use_small = _mm256_cmp_ps(ax, _mm256_set1_ps(TANH_SMALL), _CMP_LT_OQ);
+    return _mm256_blendv_ps(large, small, use_small);
+}
+
+#endif
+
+#if defined(__AVX512F__) && defined(__AVX512DQ__)
+
+inline __m512 exp_approx(__m512 x) {
+    __m512 input = x;
+    __mmask16 underflow = _mm512_cmp_ps_mask(x, _mm512_set1_ps(EXP_LO), _CMP_LT_OQ);
+    x = _mm512_min_ps(x, _mm512_set1_ps(EXP_HI));
+    __m512 n = _mm512_roundscale_ps(_mm512_fmadd_ps(x, _mm512_set1_ps(LOG2E), _mm512_set1_ps(0.5f)),
+                                    _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+    __m512 r = _mm512_fnmadd_ps(n, _mm512_set1_ps(LN2_HI), x);
+    r = _mm512_fnmadd_ps(n, _mm512_set1_ps(LN2_LO), r);
+    __m512 p = _mm512_set1_ps(EXP_P0);
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(EXP_P1));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(EXP_P2));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(EXP_P3));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(EXP_P4));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(EXP_P5));
+    p = _mm512_fmadd_ps(p, _mm512_mul_ps(r, r), _mm512_add_ps(r, _mm512_set1_ps(1.0f)));
+    __m512i bits = _mm512_slli_epi32(
+        _mm512_add_epi32(_mm512_cvtps_epi32(n), _mm512_set1_epi32(127)), 23);
+    __m512 result = _mm512_maskz_mul_ps(static_cast<__mmask16>(~underflow), p, _mm512_castsi512_ps(bits));
+    // The clamp above replaced NaN lanes with EXP_HI; put them back
+    return _mm512_mask_mov_ps(result, _mm512_cmp_ps_mask(input, input, _CMP_UNORD_Q), input);
+}
+
+inline __m512 sigmoid_approx(__m512 x) {
+    __m512 one = _mm512_set1_ps(1.0f);
+    __m512 e = exp_approx(_mm512_sub_ps(_mm512_setzero_ps(), x));
+    return _mm512_div_ps(one, _mm512_add_ps(one, e));
+}
+
+inline __m512 tanh_approx(__m512 x) {
+    __m512 sign_mask = _mm512_set1_ps(-0.0f);
+    __m512 ax = _mm512_andnot_ps(sign_mask, x);
+    __m512 sign = _mm512_and_ps(sign_mask, x);
+
+    // Small-argument polynomial
+    __m512 z = _mm512_mul_ps(x, x);
+    __m512 p = _mm512_set1_ps(TANH_P0);
+    p = _mm512_fmadd_ps(p, z, _mm512_set1_ps(TANH_P1));
+    p = _mm512_fmadd_ps(p, z, _mm512_set1_ps(TANH_P2));
+    p = _mm512_fmadd_ps(p, z, _mm512_set1_ps(TANH_P3));
+    p = _mm512_fmadd_ps(p, z, _mm512_set1_ps(TANH_P4));
+    __m512 small = _mm512_fmadd_ps(_mm512_mul_ps(p, z), x, x);
+
+    // Large-argument form 1 - 2 / (e^(2|x|) + 1), sign restored afterwards
+    __m512 one = _mm512_set1_ps(1.0f);
+    __m512 e = exp_approx(_mm512_add_ps(ax, ax));
+    __m512 large = _mm512_sub_ps(one, _mm512_div_ps(_mm512_set1_ps(2.0f), _mm512_add_ps(e, one)));
+    large = _mm512_or_ps(large, sign);
+
+    __mmask16 use_small = _mm512_cmp_ps_mask(ax, _mm512_set1_ps(TANH_SMALL), _CMP_LT_OQ);
+    return _mm512_mask_blend_ps(use_small, large, small);
+}
+
+#endif
+
+} // namespace approx
+
+// Compile-time activation functor, specialised per ActivationType
+// apply() is available for scalars, for __m256 vectors on AVX2 targets and
+// for __m512 vectors on AVX-512 targets
+template <ActivationType Type>
+struct Activation;
+
+template <>
+struct Activation<ActivationType::ReLU> {
+    static float apply(float x) { return x > 0.0f ? x : 0.0f; }
+#if defined(__AVX2__) && defined(__FMA__)
+    static __m256 apply(__m256 x) { return _mm256_max_ps(x, _mm256_setzero_ps()); }
+#endif
+#if defined(__AVX512F__) && defined(__AVX512DQ__)
+    static __m512 apply(__m512 x) { return _mm512_max_ps(x, _mm512_setzero_ps()); }
+#endif
+};
+
+template <>
+struct Activation<ActivationType::Sigmoid> {
+    static float apply(float x) { return approx::sigmoid_approx(x); }
+#if defined(__AVX2__) && defined(__FMA__)
+    static __m256 apply(__m256 x) { return approx::sigmoid_approx(x); }
+#endif
+#if defined(__AVX512F__) && defined(__AVX512DQ__)
+    static __m512 apply(__m512 x) { return approx::sigmoid_approx(x); }
+#endif
+};
+
+template <>
+struct Activation<ActivationType::Tanh> {
+    static float apply(float x) { return approx::tanh_approx(x); }
+#if defined(__AVX2__) && defined(__FMA__)
+    static __m256 apply(__m256 x) { return approx::tanh_approx(x); }
+#endif
+#if defined(__AVX512F__) && defined(__AVX512DQ__)
+    static __m512 apply(__m512 x) { return approx::tanh_approx(x); }
+#endif
+};
+
+} // namespace MLCPP_ISA
+
+} // namespace ml
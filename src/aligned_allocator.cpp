@@ -0,0 +1,148 @@
+#include "aligned_allocator.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace ml {
+
+namespace {
+
+// Size classes are powers of two from one cache line up to POOL_MAX_BLOCK_BYTES
+constexpr size_t MIN_CLASS_SHIFT = 6;  // 64 bytes
+constexpr size_t MAX_CLASS_SHIFT = 26; // 64 MiB
+constexpr size_t NUM_CLASSES = MAX_CLASS_SHIFT - MIN_CLASS_SHIFT + 1;
+
+static_assert((size_t(1) << MIN_CLASS_SHIFT) == MEMORY_ALIGNMENT,
+              "Smallest size class must equal the alignment");
+static_assert((size_t(1) << MAX_CLASS_SHIFT) == POOL_MAX_BLOCK_BYTES,
+              "Largest size class must equal POOL_MAX_BLOCK_BYTES");
+
+// Index of the smallest class that holds bytes
+size_t size_class(size_t bytes) {
+    size_t shift = MIN_CLASS_SHIFT;
+    while ((size_t(1) << shift) < bytes) {
+        ++shift;
+    }
+    return shift - MIN_CLASS_SHIFT;
+}
+
+size_t class_bytes(size_t index) {
+    return size_t(1) << (index + MIN_CLASS_SHIFT);
+}
+
+void* system_allocate(size_t bytes) {
+    // aligned_alloc requires the size to be a multiple of the alignment
+    bytes = (bytes + MEMORY_ALIGNMENT - 1) / MEMORY_ALIGNMENT * MEMORY_ALIGNMENT;
+    void* ptr = std::aligned_alloc(MEMORY_ALIGNMENT, bytes);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+// Bytes cached by all threads, bounded by POOL_MAX_TOTAL_CACHED_BYTES
+std::atomic<size_t> g_cached_bytes{0};
+
+// Set once the calling thread's cache has been destroyed during thread exit
+// Trivially destructible, so it stays readable when matrices with static or
+// thread storage are released after the cache is gone
+thread_local bool tl_cache_destroyed = false;
+
+// Per-thread free lists, one fixed-capacity stack per size class, so
+// caching a block never allocates
+// Blocks are plain aligned_alloc memory, so a block allocated on one thread
+// may be cached and reused by whichever thread frees it
+class ThreadCache {
+public:
+    ~ThreadCache() {
+        trim();
+        tl_cache_destroyed = true;
+    }
+
+    void* take(size_t index) {
+        if (counts_[index] == 0) {
+            return nullptr;
+        }
+        void* ptr = blocks_[index][--counts_[index]];
+        cached_bytes_ -= class_bytes(index);
+        g_cached_bytes.fetch_sub(class_bytes(index), std::memory_order_relaxed);
+        return ptr;
+    }
+
+    bool put(size_t index, void* ptr) {
+        size_t bytes = class_bytes(index);
+        if (counts_[index] == POOL_CLASS_SLOTS || cached_bytes_ + bytes > POOL_MAX_CACHED_BYTES) {
+            return false;
+        }
+        if (g_cached_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes > POOL_MAX_TOTAL_CACHED_BYTES) {
+            g_cached_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+            return false;
+        }
+        blocks_[index][counts_[index]++] = ptr;
+        cached_bytes_ += bytes;
+        return true;
+    }
+
+    void trim() {
+        for (size_t index = 0; index < NUM_CLASSES; ++index) {
+            for (size_t slot = 0; slot < counts_[index]; ++slot) {
+                std::free(blocks_[index][slot]);
+            }
+            counts_[index] = 0;
+        }
+        g_cached_bytes.fetch_sub(cached_bytes_, std::memory_order_relaxed);
+        cached_bytes_ = 0;
+    }
+
+private:
+    void* blocks_[NUM_CLASSES][POOL_CLASS_SLOTS];
+    size_t counts_[NUM_CLASSES] = {};
+    size_t cached_bytes_ = 0;
+};
+
+// Returns the calling thread's cache, or nullptr during thread teardown
+ThreadCache* thread_cache() {
+    if (tl_cache_destroyed) {
+        return nullptr;
+    }
+    thread_local ThreadCache cache;
+    return &cache;
+}
+
+} // namespace
+
+void* pool_allocate(size_t bytes) {
+    if (bytes == 0) {
+        bytes = 1;
+    }
+    if (bytes > POOL_MAX_BLOCK_BYTES) {
+        return system_allocate(bytes);
+    }
+    size_t index = size_class(bytes);
+    ThreadCache* cache = thread_cache();
+    if (void* ptr = cache ? cache->take(index) : nullptr) {
+        return ptr;
+    }
+    return system_allocate(class_bytes(index));
+}
+
+void pool_deallocate(void* ptr, size_t bytes) noexcept {
+    if (!ptr) {
+        return;
+    }
+    if (bytes == 0) {
+        bytes = 1;
+    }
+    ThreadCache* cache = bytes > POOL_MAX_BLOCK_BYTES ? nullptr : thread_cache();
+    if (!cache || !cache->put(size_class(bytes), ptr)) {
+        std::free(ptr);
+    }
+}
+
+void pool_trim() {
+    if (ThreadCache* cache = thread_cache()) {
+        cache->trim();
+    }
+}
+
+} // namespace ml
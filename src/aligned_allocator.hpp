@@ -0,0 +1,52 @@
+#pragma once
+#include <cstddef>
+
+namespace ml {
+
+// Alignment of every block handed out by the pool allocator
+// One cache line: satisfies AVX (32 bytes) and AVX-512 (64 bytes) aligned
+// loads and keeps neighbouring matrices from sharing a line
+constexpr size_t MEMORY_ALIGNMENT = 64;
+
+// Allocates at least bytes of MEMORY_ALIGNMENT-aligned memory
+// Requests are rounded up to a power-of-two size class; blocks freed on the
+// calling thread are reused before asking the system for new memory
+// Requests above POOL_MAX_BLOCK_BYTES bypass the pool
+// Throws std::bad_alloc when the system allocation fails
+void* pool_allocate(size_t bytes);
+
+// Returns a block obtained from pool_allocate
+// ptr: Block to release (nullptr is ignored)
+// bytes: The size originally requested from pool_allocate
+// The block is cached in the calling thread's free list for its size class,
+// or handed back to the system once that list, the thread's cache or the
+// process-wide budget is full. Never allocates, so it is safe in destructors
+void pool_deallocate(void* ptr, size_t bytes) noexcept;
+
+// Largest request served from size-class free lists
+constexpr size_t POOL_MAX_BLOCK_BYTES = size_t(64) << 20;
+
+// Upper bound on bytes each thread keeps cached in its free lists
+// One largest block: blocks freed on another thread than the one that
+// allocated them (e.g. batching server outputs) collect on the freeing
+// thread, so every thread of a large machine may hold this much
+constexpr size_t POOL_MAX_CACHED_BYTES = size_t(64) << 20;
+
+// Upper bound on bytes cached by all threads together
+constexpr size_t POOL_MAX_TOTAL_CACHED_BYTES = size_t(512) << 20;
+
+// Blocks each thread caches per size class
+constexpr size_t POOL_CLASS_SLOTS = 16;
+
+// Release every block cached by the calling thread back to the system
+void pool_trim();
+
+// Deleter for std::unique_ptr<T[]> storage obtained from pool_allocate
+struct PoolDeleter {
+    size_t bytes = 0; // Size passed to pool_allocate
+
+    template <typename T>
+    void operator()(T* ptr) const noexcept { pool_deallocate(ptr, bytes); }
+};
+
+} // namespace ml
@@ -0,0 +1,171 @@
+#include "batching_server.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+namespace ml {
+
+BatchingServer::BatchingServer(NeuralNetwork& network, BatchingConfig config)
+    : network_(network), config_(config) {
+    if (network.get_layers().empty()) {
+        throw std::invalid_argument("BatchingServer requires a network with at least one layer");
+    }
+    if (config.max_batch_size == 0) {
+        throw std::invalid_argument("max_batch_size must be positive");
+    }
+    input_size_ = network.get_layers().front().input_size();
+    batch_sizes_.assign(config.max_batch_size + 1, 0);
+    latency_window_.reserve(BATCHING_LATENCY_WINDOW);
+    scheduler_ = std::thread([this] { scheduler_loop(); });
+}
+
+BatchingServer::~BatchingServer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    ready_.notify_all();
+    scheduler_.join();
+}
+
+std::shared_future<Matrix> BatchingServer::submit(const Matrix& input) {
+    if (input.cols() != input_size_) {
+        throw std::invalid_argument("Input width must match the network input size");
+    }
+    // Copy constructs an owning matrix, so wrapped caller memory is not
+    // read after this returns
+    Request request{Matrix(input), std::promise<Matrix>(), Clock::now()};
+    std::shared_future<Matrix> future = request.result.get_future().share();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) {
+            throw std::logic_error("BatchingServer is shutting down");
+        }
+        queued_rows_ += request.input.rows();
+        queue_.push_back(std::move(request));
+    }
+    ready_.notify_one();
+    return future;
+}
+
+void BatchingServer::scheduler_loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        ready_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+        if (queue_.empty()) {
+            return; // Stopping with nothing left to run
+        }
+
+        // Wait for a full batch, but never past the oldest request's deadline
+        Clock::time_point deadline = queue_.front().submitted + config_.max_latency;
+        ready_.wait_until(lock, deadline, [this] {
+            return stopping_ || queued_rows_ >= config_.max_batch_size;
+        });
+
+        // Take whole requests up to max_batch_size rows; an oversized request
+        // still runs, on its own
+        std::vector<Request> batch;
+        size_t rows = 0;
+        while (!queue_.empty()) {
+            size_t next = queue_.front().input.rows();
+            if (!batch.empty() && rows + next > config_.max_batch_size) {
+                break;
+            }
+            rows += next;
+            batch.push_back(std::move(queue_.front()));
+            queue_.pop_front();
+        }
+        queued_rows_ -= rows;
+
+        lock.unlock();
+        run_batch(batch, rows);
+        lock.lock();
+    }
+}
+
+void BatchingServer::run_batch(std::vector<Request>& batch, size_t rows) {
+    std::vector<Matrix> inputs;
+    inputs.reserve(batch.size());
+    for (auto& request : batch) {
+        inputs.push_back(std::move(request.input));
+    }
+
+    try {
+        std::vector<Matrix> outputs = network_.forward_many(inputs);
+        // Stats first, so a caller holding its result also sees its batch
+        // counted
+        record(batch, rows, Clock::now());
+        for (size_t i = 0; i < batch.size(); ++i) {
+            batch[i].result.set_value(std::move(outputs[i]));
+        }
+    } catch (...) {
+        for (auto& request : batch) {
+            request.result.set_exception(std::current_exception());
+        }
+    }
+}
+
+void BatchingServer::record(const std::vector<Request>& batch, size_t rows, Clock::time_point finished) {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    ++completed_batches_;
+    completed_requests_ += batch.size();
+    if (rows >= batch_sizes_.size()) {
+        batch_sizes_.resize(rows + 1, 0);
+    }
+    ++batch_sizes_[rows];
+
+    for (const auto& request : batch) {
+        double us = std::chrono::duration<double, std::micro>(finished - request.submitted).count();
+        size_t bucket = 0;
+        while (bucket < 63 && static_cast<double>(uint64_t(2) << bucket) <= us) {
+            ++bucket;
+        }
+        if (bucket >= latency_buckets_.size()) {
+            latency_buckets_.resize(bucket + 1, 0);
+        }
+        ++latency_buckets_[bucket];
+
+        if (latency_window_.size() < BATCHING_LATENCY_WINDOW) {
+            latency_window_.push_back(us);
+        } else {
+            latency_window_[latency_next_] = us;
+        }
+        latency_next_ = (latency_next_ + 1) % BATCHING_LATENCY_WINDOW;
+    }
+}
+
+BatchingStats BatchingServer::stats() const {
+    BatchingStats stats;
+    std::vector<double> latencies;
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        stats.requests = completed_requests_;
+        stats.batches = completed_batches_;
+        stats.batch_size_histogram = batch_sizes_;
+        stats.latency_histogram = latency_buckets_;
+        latencies = latency_window_;
+    }
+    if (!latencies.empty()) {
+        // Nearest-rank percentiles
+        auto percentile = [&](double p) {
+            size_t rank = static_cast<size_t>(p * static_cast<double>(latencies.size() - 1) + 0.5);
+            std::nth_element(latencies.begin(), latencies.begin() + rank, latencies.end());
+            return latencies[rank];
+        };
+        stats.latency_p50_us = percentile(0.50);
+        stats.latency_p99_us = percentile(0.99);
+    }
+    return stats;
+}
+
+void BatchingServer::reset_stats() {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    completed_requests_ = 0;
+    completed_batches_ = 0;
+    std::fill(batch_sizes_.begin(), batch_sizes_.end(), 0);
+    latency_buckets_.clear();
+    latency_window_.clear();
+    latency_next_ = 0;
+}
+
+} // namespace ml
@@ -0,0 +1,97 @@
+#pragma once
+#include "neural.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ml {
+
+// Scheduling limits for BatchingServer
+struct BatchingConfig {
+    size_t max_batch_size = 32;                       // Rows per batch; a batch runs as soon as it is full
+    std::chrono::microseconds max_latency{1000};      // Longest the oldest request waits for company
+};
+
+// Snapshot of BatchingServer counters since construction or reset_stats()
+struct BatchingStats {
+    size_t requests = 0;        // Requests completed
+    size_t batches = 0;         // forward() calls issued
+    double latency_p50_us = 0;  // Submit-to-result latency percentiles over the
+    double latency_p99_us = 0;  // most recent BATCHING_LATENCY_WINDOW requests
+    // [n] = number of batches that contained n rows
+    std::vector<size_t> batch_size_histogram;
+    // [i] = number of requests whose latency fell in [2^i, 2^(i+1)) microseconds
+    std::vector<size_t> latency_histogram;
+};
+
+// Number of recent request latencies kept for the percentile estimates
+constexpr size_t BATCHING_LATENCY_WINDOW = 8192;
+
+// BatchingServer class: Coalesces small inference requests into batches
+// Callers submit a few rows at a time (typically one); a scheduler thread
+// gathers queued requests until max_batch_size rows are waiting or the oldest
+// request has waited max_latency, runs them through one forward_many() call,
+// and fulfils each request's future with its own rows of the output
+class BatchingServer {
+public:
+    // network: Network to serve; must have at least one layer and outlive the server
+    // config: Batch size and latency limits
+    // Throws std::invalid_argument for an empty network or a zero batch size
+    BatchingServer(NeuralNetwork& network, BatchingConfig config = {});
+
+    // Runs every queued request, then stops the scheduler thread
+    ~BatchingServer();
+
+    BatchingServer(const BatchingServer&) = delete;
+    BatchingServer& operator=(const BatchingServer&) = delete;
+
+    // Queue input (rows x input_size of the first layer) for inference
+    // input is copied, so the caller may modify or release it at once
+    // Returns: Future holding the output rows, or the exception forward() threw
+    std::shared_future<Matrix> submit(const Matrix& input);
+
+    const BatchingConfig& config() const { return config_; }
+
+    BatchingStats stats() const;
+    void reset_stats();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Request {
+        Matrix input;
+        std::promise<Matrix> result;
+        Clock::time_point submitted;
+    };
+
+    void scheduler_loop();
+    void run_batch(std::vector<Request>& batch, size_t rows);
+    void record(const std::vector<Request>& batch, size_t rows, Clock::time_point finished);
+
+    NeuralNetwork& network_;
+    BatchingConfig config_;
+    size_t input_size_;
+
+    std::mutex mutex_;               // Guards the queue fields below
+    std::condition_variable ready_;  // Signals new requests or a stop request
+    std::deque<Request> queue_;
+    size_t queued_rows_ = 0;
+    bool stopping_ = false;
+
+    mutable std::mutex stats_mutex_; // Guards the statistics below
+    size_t completed_requests_ = 0;
+    size_t completed_batches_ = 0;
+    std::vector<size_t> batch_sizes_;
+    std::vector<size_t> latency_buckets_;
+    std::vector<double> latency_window_; // Ring buffer of recent latencies (microseconds)
+    size_t latency_next_ = 0;
+
+    std::thread scheduler_; // Started last, after every field it reads
+};
+
+} // namespace ml
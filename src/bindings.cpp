@@ -1,17 +1,116 @@
 
 #include <pybind11/pybind11.h>
 #include <pybind11/numpy.h>
+#include <pybind11/stl.h>
+#include <pybind11/chrono.h>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <future>
+#include <optional>
+#include <string>
+#include <vector>
+#include "batching_server.hpp"
+#include "cpu_dispatch.hpp"
+#include "gemm_tuning.hpp"
+#include "half.hpp"
 #include "matrix.hpp"
+#include "model_io.hpp"
 #include "neural.hpp"
+#include "profiler.hpp"
+#include "quantization.hpp"
+#include "stream_inference.hpp"
+#include "thread_pool.hpp"
+#include "trainer.hpp"
 
 namespace py = pybind11;  // Alias for pybind11 namespace
 
+namespace {
+
+// Build a Matrix from a 1-D (single row) or 2-D NumPy array
+// Writeable, C-contiguous, float-aligned float32 arrays are wrapped without
+// copying and kept alive by the matrix; other dtypes and strided, misaligned
+// or read-only arrays are converted and copied into pooled aligned storage
+ml::Matrix matrix_from_array(const py::array& array, bool copy) {
+    if (array.ndim() != 1 && array.ndim() != 2) {
+        throw py::value_error("Matrix requires a 1-D or 2-D array");
+    }
+    size_t rows = array.ndim() == 2 ? static_cast<size_t>(array.shape(0)) : 1;
+    size_t cols = static_cast<size_t>(array.shape(array.ndim() - 1));
+
+    bool wrappable = !copy
+        && array.dtype().is(py::dtype::of<float>())
+        && (array.flags() & py::array::c_style)
+        && array.writeable()
+        && reinterpret_cast<std::uintptr_t>(array.data()) % alignof(float) == 0;
+    if (wrappable) {
+        // The keep-alive reference is dropped from C++, possibly without the GIL
+        auto* handle = new py::object(array);
+        std::shared_ptr<void> owner(handle, [](void* ptr) {
+            py::gil_scoped_acquire gil;
+            delete static_cast<py::object*>(ptr);
+        });
+        return ml::Matrix::wrap(static_cast<float*>(const_cast<void*>(array.data())),
+                                rows, cols, std::move(owner));
+    }
+
+    auto contiguous = py::array_t<float, py::array::c_style | py::array::forcecast>::ensure(array);
+    if (!contiguous) {
+        throw py::type_error("Matrix requires an array convertible to float32");
+    }
+    ml::Matrix result(rows, cols, ml::Matrix::Uninitialized{});
+    std::memcpy(result.data(), contiguous.data(), rows * cols * sizeof(float));
+    return result;
+}
+
+// Round any float-convertible array to 16-bit values of the same shape,
+// returned as uint16 so the bits survive a round trip through NumPy
+py::array_t<uint16_t> array_to_half(const py::array& array, ml::Precision precision) {
+    auto source = py::array_t<float, py::array::c_style | py::array::forcecast>::ensure(array);
+    if (!source) {
+        throw py::type_error("to_half requires an array convertible to float32");
+    }
+    py::array_t<uint16_t> result(std::vector<py::ssize_t>(source.shape(), source.shape() + source.ndim()));
+    ml::float_to_half(result.mutable_data(), source.data(), static_cast<size_t>(source.size()), precision);
+    return result;
+}
+
+// Widen uint16 bits produced by array_to_half back to float32
+py::array_t<float> array_from_half(const py::array_t<uint16_t, py::array::c_style>& array,
+                                   ml::Precision precision) {
+    py::array_t<float> result(std::vector<py::ssize_t>(array.shape(), array.shape() + array.ndim()));
+    ml::half_to_float(result.mutable_data(), array.data(), static_cast<size_t>(array.size()), precision);
+    return result;
+}
+
+} // namespace
+
 // Define Python module 'mlcpp' and expose C++ classes/functions
 PYBIND11_MODULE(mlcpp, m) {
     // Expose Matrix class to Python
-    py::class_<ml::Matrix>(m, "Matrix")
+    py::class_<ml::Matrix>(m, "Matrix", py::buffer_protocol())
         // Constructor with rows and columns
         .def(py::init<size_t, size_t>())
+        // Constructor from a NumPy array: zero-copy when possible, see
+        // matrix_from_array; copy=True always takes a private copy
+        .def(py::init(&matrix_from_array), py::arg("array"), py::arg("copy") = false)
+        // Buffer protocol: np.asarray(matrix) and memoryview(matrix) share memory
+        .def_buffer([](ml::Matrix& matrix) {
+            return py::buffer_info(
+                matrix.data(), sizeof(float), py::format_descriptor<float>::format(), 2,
+                {matrix.rows(), matrix.cols()},
+                {matrix.cols() * sizeof(float), sizeof(float)});
+        })
+        // Zero-copy NumPy view; the array keeps the matrix alive
+        .def("numpy", [](py::object self) {
+            ml::Matrix& matrix = self.cast<ml::Matrix&>();
+            return py::array_t<float>(
+                {matrix.rows(), matrix.cols()},
+                {matrix.cols() * sizeof(float), sizeof(float)},
+                matrix.data(), self);
+        })
+        // False when the matrix wraps memory owned by a NumPy array
+        .def_property_readonly("owns_data", &ml::Matrix::owns_data)
         // Element access method - returns reference to allow modification
         .def("at", (float& (ml::Matrix::*)(size_t, size_t)) &ml::Matrix::at)
         // Matrix filling method
@@ -20,9 +119,17 @@ PYBIND11_MODULE(mlcpp, m) {
         .def("rows", &ml::Matrix::rows)
         .def("cols", &ml::Matrix::cols)
         // Operator overloads for Python
-        .def("__add__", &ml::Matrix::operator+)  // Matrix addition
-        .def("__sub__", &ml::Matrix::operator-)  // Matrix subtraction
-        .def("__mul__", &ml::Matrix::operator*); // Matrix multiplication
+        // Expressions are evaluated eagerly here since Python holds no lazy nodes
+        // The GIL is released while the kernels run
+        .def("__add__", [](const ml::Matrix& a, const ml::Matrix& b) { return ml::Matrix(a + b); },
+             py::call_guard<py::gil_scoped_release>())  // Matrix addition
+        .def("__sub__", [](const ml::Matrix& a, const ml::Matrix& b) { return ml::Matrix(a - b); },
+             py::call_guard<py::gil_scoped_release>())  // Matrix subtraction
+        .def("__mul__", [](const ml::Matrix& a, const ml::Matrix& b) { return ml::Matrix(a * b); },
+             py::call_guard<py::gil_scoped_release>()); // Matrix multiplication
+
+    // NumPy arrays may be passed wherever a Matrix is expected
+    py::implicitly_convertible<py::array, ml::Matrix>();
 
     // Expose ActivationType enum to Python
     py::enum_<ml::ActivationType>(m, "ActivationType")
@@ -30,12 +137,280 @@ PYBIND11_MODULE(mlcpp, m) {
         .value("Sigmoid", ml::ActivationType::Sigmoid) // Sigmoid activation
         .value("Tanh", ml::ActivationType::Tanh);     // Hyperbolic tangent
 
+    // Weight storage formats and the conversions behind them
+    py::enum_<ml::Precision>(m, "Precision")
+        .value("Float32", ml::Precision::Float32)
+        .value("BFloat16", ml::Precision::BFloat16)
+        .value("Float16", ml::Precision::Float16);
+    m.def("to_half", &array_to_half, py::arg("array"), py::arg("precision"));
+    m.def("from_half", &array_from_half, py::arg("array"), py::arg("precision"));
+
+    // Expose optimizer selection to Python
+    py::enum_<ml::OptimizerType>(m, "OptimizerType")
+        .value("SGD", ml::OptimizerType::SGD)
+        .value("Momentum", ml::OptimizerType::Momentum)
+        .value("Adam", ml::OptimizerType::Adam);
+
+    py::class_<ml::OptimizerConfig>(m, "OptimizerConfig")
+        .def(py::init<>())
+        .def_readwrite("type", &ml::OptimizerConfig::type)
+        .def_readwrite("learning_rate", &ml::OptimizerConfig::learning_rate)
+        .def_readwrite("momentum", &ml::OptimizerConfig::momentum)
+        .def_readwrite("beta1", &ml::OptimizerConfig::beta1)
+        .def_readwrite("beta2", &ml::OptimizerConfig::beta2)
+        .def_readwrite("epsilon", &ml::OptimizerConfig::epsilon);
+
+    // Result handle returned by NeuralNetwork.forward_async
+    using MatrixFuture = std::shared_future<ml::Matrix>;
+    py::class_<MatrixFuture>(m, "MatrixFuture")
+        // True once the result (or an exception) is available
+        .def("done", [](const MatrixFuture& future) {
+            return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+        })
+        // Block until the output is ready, without holding the GIL
+        // Raises TimeoutError when timeout (seconds) expires first, and
+        // re-raises any exception thrown by the forward pass
+        .def("result", [](const MatrixFuture& future, std::optional<double> timeout) {
+            bool ready = true;
+            {
+                py::gil_scoped_release release;
+                if (timeout) {
+                    ready = future.wait_for(std::chrono::duration<double>(*timeout)) == std::future_status::ready;
+                } else {
+                    future.wait();
+                }
+            }
+            if (!ready) {
+                PyErr_SetString(PyExc_TimeoutError, "forward_async result not ready");
+                throw py::error_already_set();
+            }
+            return future.get();
+        }, py::arg("timeout") = py::none());
+
+    // Reusable activation workspace for stateless inference
+    py::class_<ml::InferenceContext>(m, "InferenceContext")
+        .def(py::init<>())
+        .def(py::init<const ml::NeuralNetwork&, size_t>(), py::arg("network"), py::arg("batch_size"))
+        .def("batch_size", &ml::InferenceContext::batch_size)
+        .def("arena_bytes", &ml::InferenceContext::arena_bytes);
+
     // Expose NeuralNetwork class to Python
     py::class_<ml::NeuralNetwork>(m, "NeuralNetwork")
         // Default constructor
         .def(py::init<>())
         // Layer addition method
-        .def("add_layer", &ml::NeuralNetwork::add_layer)
-        // Forward propagation method
-        .def("forward", &ml::NeuralNetwork::forward);
+        .def("add_layer", py::overload_cast<size_t, size_t, ml::ActivationType>(
+                 &ml::NeuralNetwork::add_layer))
+        // Forward propagation method; releases the GIL so Python threads can
+        // run inferences concurrently
+        .def("forward", py::overload_cast<const ml::Matrix&>(&ml::NeuralNetwork::forward),
+             py::call_guard<py::gil_scoped_release>())
+        // Stateless forward into a caller-owned context; the intermediate
+        // activations reuse the context's arena, the output is copied out of
+        // it since the next call with a larger batch frees that arena
+        .def("forward", [](const ml::NeuralNetwork& network, const ml::Matrix& input,
+                           ml::InferenceContext& context) {
+                 return ml::Matrix(network.forward(input, context));
+             }, py::arg("input"), py::arg("context"),
+             py::call_guard<py::gil_scoped_release>())
+        // Several inputs run as one stacked batch, returns a list of outputs
+        .def("forward_many", &ml::NeuralNetwork::forward_many, py::arg("inputs"),
+             py::call_guard<py::gil_scoped_release>())
+        // Queue a forward pass on the network's native work queue
+        .def("forward_async", &ml::NeuralNetwork::forward_async, py::arg("input"))
+        // Backpropagation and weight update for the last forward pass
+        .def("backward", &ml::NeuralNetwork::backward, py::arg("expected"), py::arg("learning_rate"),
+             py::call_guard<py::gil_scoped_release>())
+        .def("set_optimizer", &ml::NeuralNetwork::set_optimizer)
+        .def_static("mse_loss", &ml::NeuralNetwork::mse_loss)
+        // Switch pruned layers to the sparse kernels, see sparse_matrix.hpp
+        .def("sparsify", &ml::NeuralNetwork::sparsify, py::arg("block_rows") = 1, py::arg("block_cols") = 8,
+             py::arg("max_density") = ml::SPARSE_MAX_DENSITY)
+        // bfloat16 / float16 weight storage for inference, see half.hpp
+        .def("set_weight_precision", &ml::NeuralNetwork::set_weight_precision, py::arg("precision"))
+        // Binary model file, see model_io.hpp
+        .def("save", [](const ml::NeuralNetwork& network, const std::string& path) {
+                 ml::save_network(network, path);
+             }, py::arg("path"), py::call_guard<py::gil_scoped_release>());
+
+    // Memory-mapped load; parameters stay views into the shared page cache
+    m.def("load_network", &ml::load_network, py::arg("path"),
+          py::call_guard<py::gil_scoped_release>());
+
+    // Out-of-core batch scoring of a float32 file (raw or .npy) into another
+    py::class_<ml::StreamConfig>(m, "StreamConfig")
+        .def(py::init<>())
+        .def_readwrite("chunk_rows", &ml::StreamConfig::chunk_rows)
+        .def_readwrite("num_workers", &ml::StreamConfig::num_workers)
+        .def_readwrite("max_chunks_in_flight", &ml::StreamConfig::max_chunks_in_flight)
+        .def_readwrite("input_cols", &ml::StreamConfig::input_cols);
+
+    py::class_<ml::StreamStats>(m, "StreamStats")
+        .def_readonly("rows", &ml::StreamStats::rows)
+        .def_readonly("chunks", &ml::StreamStats::chunks)
+        .def_readonly("seconds", &ml::StreamStats::seconds)
+        .def_readonly("compute_seconds", &ml::StreamStats::compute_seconds)
+        .def_readonly("write_seconds", &ml::StreamStats::write_seconds)
+        .def_readonly("writer_wait_seconds", &ml::StreamStats::writer_wait_seconds);
+
+    m.def("stream_inference", &ml::stream_inference, py::arg("network"), py::arg("input_path"),
+          py::arg("output_path"), py::arg("config") = ml::StreamConfig(),
+          py::call_guard<py::gil_scoped_release>());
+
+    // Data-parallel minibatch training, see trainer.hpp
+    py::enum_<ml::TrainingMode>(m, "TrainingMode")
+        .value("Synchronous", ml::TrainingMode::Synchronous)
+        .value("Hogwild", ml::TrainingMode::Hogwild);
+
+    py::class_<ml::TrainerConfig>(m, "TrainerConfig")
+        .def(py::init<>())
+        .def_readwrite("batch_size", &ml::TrainerConfig::batch_size)
+        .def_readwrite("num_workers", &ml::TrainerConfig::num_workers)
+        .def_readwrite("mode", &ml::TrainerConfig::mode)
+        .def_readwrite("deterministic", &ml::TrainerConfig::deterministic)
+        .def_readwrite("shuffle", &ml::TrainerConfig::shuffle)
+        .def_readwrite("seed", &ml::TrainerConfig::seed);
+
+    py::class_<ml::EpochStats>(m, "EpochStats")
+        .def_readonly("loss", &ml::EpochStats::loss)
+        .def_readonly("steps", &ml::EpochStats::steps)
+        .def_readonly("seconds", &ml::EpochStats::seconds);
+
+    py::class_<ml::DataParallelTrainer>(m, "DataParallelTrainer")
+        // The trainer keeps its network alive
+        .def(py::init<ml::NeuralNetwork&, ml::TrainerConfig>(),
+             py::arg("network"), py::arg("config") = ml::TrainerConfig(), py::keep_alive<1, 2>())
+        .def("train_epoch", &ml::DataParallelTrainer::train_epoch, py::arg("inputs"), py::arg("targets"),
+             py::arg("learning_rate"), py::call_guard<py::gil_scoped_release>())
+        .def("config", &ml::DataParallelTrainer::config);
+
+    // Int8 inference: quantize a trained network and measure the accuracy cost
+    py::class_<ml::QuantizedNetwork>(m, "QuantizedNetwork")
+        .def(py::init<const ml::NeuralNetwork&>(), py::arg("network"))
+        .def("forward", &ml::QuantizedNetwork::forward, py::call_guard<py::gil_scoped_release>())
+        .def("weight_bytes", &ml::QuantizedNetwork::weight_bytes);
+
+    py::class_<ml::QuantizationReport>(m, "QuantizationReport")
+        .def_readonly("max_abs_error", &ml::QuantizationReport::max_abs_error)
+        .def_readonly("mean_abs_error", &ml::QuantizationReport::mean_abs_error)
+        .def_readonly("relative_rms_error", &ml::QuantizationReport::relative_rms_error)
+        .def_readonly("top1_agreement", &ml::QuantizationReport::top1_agreement)
+        .def_readonly("float_weight_bytes", &ml::QuantizationReport::float_weight_bytes)
+        .def_readonly("quantized_weight_bytes", &ml::QuantizationReport::quantized_weight_bytes);
+
+    m.def("evaluate_quantization", &ml::evaluate_quantization,
+          py::arg("reference"), py::arg("quantized"), py::arg("input"),
+          py::call_guard<py::gil_scoped_release>());
+
+    // Micro-batching inference server
+    py::class_<ml::BatchingConfig>(m, "BatchingConfig")
+        .def(py::init<>())
+        .def_readwrite("max_batch_size", &ml::BatchingConfig::max_batch_size)
+        .def_readwrite("max_latency", &ml::BatchingConfig::max_latency); // datetime.timedelta
+
+    py::class_<ml::BatchingStats>(m, "BatchingStats")
+        .def_readonly("requests", &ml::BatchingStats::requests)
+        .def_readonly("batches", &ml::BatchingStats::batches)
+        .def_readonly("latency_p50_us", &ml::BatchingStats::latency_p50_us)
+        .def_readonly("latency_p99_us", &ml::BatchingStats::latency_p99_us)
+        .def_readonly("batch_size_histogram", &ml::BatchingStats::batch_size_histogram)
+        .def_readonly("latency_histogram", &ml::BatchingStats::latency_histogram);
+
+    py::class_<ml::BatchingServer>(m, "BatchingServer")
+        // The server keeps its network alive
+        .def(py::init<ml::NeuralNetwork&, ml::BatchingConfig>(),
+             py::arg("network"), py::arg("config") = ml::BatchingConfig(), py::keep_alive<1, 2>())
+        .def("submit", &ml::BatchingServer::submit, py::arg("input"))
+        .def("stats", &ml::BatchingServer::stats)
+        .def("reset_stats", &ml::BatchingServer::reset_stats);
+
+    // Thread pool configuration shared by all kernels
+    m.def("set_num_threads", &ml::set_num_threads, py::arg("num_threads"));
+    m.def("get_num_threads", &ml::get_num_threads);
+    m.def("set_thread_affinity", &ml::set_thread_affinity, py::arg("pin_threads"));
+
+    // Profiler, see profiler.hpp
+    m.def("set_profiling", &ml::set_profiling,
+          py::arg("enabled"), py::arg("hardware_counters") = false);
+    m.def("profiling_enabled", &ml::profiling_enabled);
+    m.def("hardware_counters_available", &ml::hardware_counters_available);
+    m.def("reset_profile", &ml::reset_profile);
+    m.def("profile_dropped_events", &ml::profile_dropped_events);
+    m.def("profile_summary", [] {
+        // {scope name: {calls, total_us, ..., gflops, gbytes_per_s}}, slowest first
+        py::dict summary;
+        for (const ml::ProfileStats& stats : ml::profile_summary()) {
+            double seconds = stats.total_ns * 1e-9;
+            py::dict entry;
+            entry["calls"] = stats.calls;
+            entry["total_us"] = stats.total_ns * 1e-3;
+            entry["mean_us"] = stats.total_ns * 1e-3 / static_cast<double>(stats.calls);
+            entry["min_us"] = stats.min_ns * 1e-3;
+            entry["max_us"] = stats.max_ns * 1e-3;
+            entry["flops"] = stats.flops;
+            entry["bytes"] = stats.bytes;
+            entry["gflops"] = seconds > 0.0 ? stats.flops / seconds * 1e-9 : 0.0;
+            entry["gbytes_per_s"] = seconds > 0.0 ? stats.bytes / seconds * 1e-9 : 0.0;
+            entry["cycles"] = stats.cycles;
+            entry["instructions"] = stats.instructions;
+            summary[py::str(stats.name)] = entry;
+        }
+        return summary;
+    });
+    m.def("profile_events", [] {
+        py::list events;
+        for (const ml::ProfileEvent& event : ml::profile_events()) {
+            py::dict entry;
+            entry["name"] = event.name;
+            entry["index"] = event.index;
+            entry["thread"] = event.thread;
+            entry["start_us"] = event.start_ns * 1e-3;
+            entry["duration_us"] = event.duration_ns * 1e-3;
+            entry["flops"] = event.flops;
+            entry["bytes"] = event.bytes;
+            entry["cycles"] = event.cycles;
+            entry["instructions"] = event.instructions;
+            events.append(entry);
+        }
+        return events;
+    });
+    m.def("chrome_trace", &ml::chrome_trace);
+    m.def("write_chrome_trace", &ml::write_chrome_trace, py::arg("path"),
+          py::call_guard<py::gil_scoped_release>());
+
+    // Kernel instruction-set selection, see cpu_dispatch.hpp
+    m.def("get_kernel_isa", &ml::get_kernel_isa);
+    m.def("set_kernel_isa", &ml::set_kernel_isa, py::arg("isa"));
+    m.def("available_kernel_isas", &ml::available_kernel_isas);
+
+    // GEMM autotuning and its per-host cache, see gemm_tuning.hpp
+    py::class_<ml::GemmBlocking>(m, "GemmBlocking")
+        .def_readonly("mc", &ml::GemmBlocking::mc)
+        .def_readonly("kc", &ml::GemmBlocking::kc)
+        .def_readonly("nc", &ml::GemmBlocking::nc);
+
+    py::class_<ml::GemmPlan>(m, "GemmPlan")
+        .def_readonly("blocking", &ml::GemmPlan::blocking)
+        .def_readonly("m_parts", &ml::GemmPlan::m_parts)
+        .def_readonly("n_parts", &ml::GemmPlan::n_parts)
+        .def_readonly("threads", &ml::GemmPlan::threads);
+
+    py::class_<ml::GemmShape>(m, "GemmShape")
+        .def_readonly("m", &ml::GemmShape::m)
+        .def_readonly("n", &ml::GemmShape::n)
+        .def_readonly("k", &ml::GemmShape::k);
+
+    py::class_<ml::GemmTuneResult>(m, "GemmTuneResult")
+        .def_readonly("plan", &ml::GemmTuneResult::plan)
+        .def_readonly("default_seconds", &ml::GemmTuneResult::default_seconds)
+        .def_readonly("tuned_seconds", &ml::GemmTuneResult::tuned_seconds);
+
+    m.def("tune_gemm", &ml::tune_gemm, py::arg("m"), py::arg("n"), py::arg("k"),
+          py::call_guard<py::gil_scoped_release>());
+    m.def("tune_network", &ml::tune_network, py::arg("network"), py::arg("batch_sizes"),
+          py::arg("training") = false, py::call_guard<py::gil_scoped_release>());
+    m.def("clear_gemm_tuning", &ml::clear_gemm_tuning);
+    m.def("gemm_tuning_cache_path", &ml::gemm_tuning_cache_path);
+    m.def("save_gemm_tuning", &ml::save_gemm_tuning, py::arg("path"));
+    m.def("load_gemm_tuning", &ml::load_gemm_tuning, py::arg("path"));
 }
@@ -0,0 +1,408 @@
+#include "cpu_dispatch.hpp"
+#include "gemm_tuning.hpp"
+#include "int8_gemm.hpp"
+#include "optimizations.hpp"
+#include "profiler.hpp"
+#include "sparse_matrix.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+namespace ml {
+
+namespace {
+
+struct KernelVariant {
+    const char* name;
+    const KernelTable& (*table)();
+    bool (*supported)();
+};
+
+// Besides the instruction sets, each check covers the extensions the variant
+// is compiled with (see CMakeLists.txt)
+bool supports_sse42() {
+    return __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt");
+}
+
+bool supports_avx2() {
+    return supports_sse42() && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") &&
+           __builtin_cpu_supports("f16c");
+}
+
+bool supports_avx512() {
+    return supports_avx2() && __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+           __builtin_cpu_supports("avx512dq") && __builtin_cpu_supports("avx512vl");
+}
+
+// The avx512 kernels, with the int8 ones swapped for the VNNI build where the
+// host has vpdpbusd. Without it (Skylake-SP/X) the int8 GEMM runs the 7-bit
+// vpmaddubsw path as in avx2, and the float kernels stay 16 wide
+const KernelTable& avx512_kernel_table() {
+    static const KernelTable table = [] {
+        KernelTable kernels = avx512::kernel_table();
+        if (__builtin_cpu_supports("avx512vnni")) {
+            kernels.int8_activation_max = &avx512vnni::int8_activation_max;
+            kernels.int8_packed_size = &avx512vnni::int8_packed_size;
+            kernels.pack_int8_weights = &avx512vnni::pack_int8_weights;
+            kernels.quantize_rows = &avx512vnni::quantize_rows;
+            kernels.int8_gemm_bias_activation = &avx512vnni::int8_gemm_bias_activation;
+        }
+        return kernels;
+    }();
+    return table;
+}
+
+// Narrowest first
+const KernelVariant VARIANTS[] = {
+    {"sse42", &sse42::kernel_table, &supports_sse42},
+    {"avx2", &avx2::kernel_table, &supports_avx2},
+    {"avx512", &avx512_kernel_table, &supports_avx512},
+};
+
+const KernelVariant* find_variant(const std::string& name) {
+    for (const KernelVariant& variant : VARIANTS) {
+        if (name == variant.name) {
+            return &variant;
+        }
+    }
+    return nullptr;
+}
+
+const KernelTable* best_kernels() {
+    for (auto it = std::rbegin(VARIANTS); it != std::rend(VARIANTS); ++it) {
+        if (it->supported()) {
+            return &it->table();
+        }
+    }
+    throw std::runtime_error("This CPU lacks SSE4.2, the minimum supported instruction set");
+}
+
+// Best supported variant, unless MLCPP_ISA names another one the host can run
+const KernelTable* initial_kernels() {
+    const char* requested = std::getenv("MLCPP_ISA");
+    if (requested && *requested) {
+        const KernelVariant* variant = find_variant(requested);
+        if (variant && variant->supported()) {
+            return &variant->table();
+        }
+        std::cerr << "mlcpp: ignoring MLCPP_ISA=" << requested
+                  << (variant ? ", not supported by this CPU" : ", unknown instruction set") << std::endl;
+    }
+    return best_kernels();
+}
+
+std::atomic<const KernelTable*> g_kernels{nullptr};
+
+} // namespace
+
+const KernelTable& active_kernels() {
+    const KernelTable* kernels = g_kernels.load(std::memory_order_acquire);
+    if (!kernels) {
+        load_gemm_tuning_cache();
+        // Racing first calls agree on the result, so either store is fine
+        const KernelTable* initial = initial_kernels();
+        g_kernels.compare_exchange_strong(kernels, initial, std::memory_order_acq_rel);
+        kernels = g_kernels.load(std::memory_order_acquire);
+    }
+    return *kernels;
+}
+
+std::string get_kernel_isa() {
+    return active_kernels().isa;
+}
+
+std::vector<std::string> available_kernel_isas() {
+    std::vector<std::string> names;
+    for (const KernelVariant& variant : VARIANTS) {
+        if (variant.supported()) {
+            names.push_back(variant.name);
+        }
+    }
+    return names;
+}
+
+const KernelTable& kernel_table_for(const std::string& isa) {
+    const KernelVariant* variant = find_variant(isa);
+    if (!variant) {
+        throw std::invalid_argument("Unknown kernel instruction set: " + isa);
+    }
+    return variant->table();
+}
+
+void set_kernel_isa(const std::string& isa) {
+    const KernelVariant* variant = find_variant(isa);
+    if (!variant) {
+        throw std::invalid_argument("Unknown kernel instruction set: " + isa);
+    }
+    if (!variant->supported()) {
+        throw std::runtime_error("Kernel instruction set not supported by this CPU: " + isa);
+    }
+    load_gemm_tuning_cache();
+    g_kernels.store(&variant->table(), std::memory_order_release);
+}
+
+// Public entry points, forwarded to the selected variant
+// Each one is a profiler scope carrying its FLOP and byte counts
+
+const GemmBlocking& gemm_blocking() {
+    return active_kernels().gemm_blocking();
+}
+
+void gemm(float* result, const float* a, const float* b,
+          size_t m, size_t n, size_t k) {
+    ProfileScope scope("gemm", 2.0 * m * n * k, 4.0 * (m * k + k * n + m * n));
+    active_kernels().gemm(result, n, a, k, 1, b, n, 1, m, n, k);
+}
+
+void gemm(float* result, const float* a, const float* b,
+          size_t m, size_t n, size_t k, bool trans_a, bool trans_b) {
+    ProfileScope scope("gemm", 2.0 * m * n * k, 4.0 * (m * k + k * n + m * n));
+    // A transposed operand is the same storage read with swapped strides
+    active_kernels().gemm(result, n,
+                          a, trans_a ? 1 : k, trans_a ? m : 1,
+                          b, trans_b ? 1 : n, trans_b ? k : 1, m, n, k);
+}
+
+void gemm_bias_activation(float* result, const float* a, const float* b, const float* bias,
+                          size_t m, size_t n, size_t k, ActivationType activation) {
+    ProfileScope scope("gemm_bias_activation", 2.0 * m * n * k, 4.0 * (m * k + k * n + m * n + n));
+    active_kernels().gemm_bias_activation(result, n, a, k, 1, b, n, 1, bias, m, n, k, activation);
+}
+
+namespace {
+
+void check_gemm_views(MatrixView c, ConstMatrixView a, ConstMatrixView b) {
+    if (a.cols() != b.rows() || c.rows() != a.rows() || c.cols() != b.cols()) {
+        throw std::invalid_argument("Matrix view dimensions don't match for multiplication");
+    }
+}
+
+} // namespace
+
+void gemm(MatrixView c, ConstMatrixView a, ConstMatrixView b) {
+    check_gemm_views(c, a, b);
+    size_t m = c.rows(), n = c.cols(), k = a.cols();
+    ProfileScope scope("gemm", 2.0 * m * n * k, 4.0 * (m * k + k * n + m * n));
+    if (c.unit_col_stride()) {
+        active_kernels().gemm(c.data(), c.row_stride(), a.data(), a.row_stride(), a.col_stride(),
+                              b.data(), b.row_stride(), b.col_stride(), m, n, k);
+    } else if (c.row_stride() == 1 || m <= 1) {
+        // Column-major output: compute c^T = b^T * a^T, whose rows are contiguous
+        active_kernels().gemm(c.data(), c.col_stride(), b.data(), b.col_stride(), b.row_stride(),
+                              a.data(), a.col_stride(), a.row_stride(), n, m, k);
+    } else {
+        throw std::invalid_argument("gemm output view must have unit row or column stride");
+    }
+}
+
+void gemm_bias_activation(MatrixView c, ConstMatrixView a, ConstMatrixView b, const float* bias,
+                          ActivationType activation) {
+    check_gemm_views(c, a, b);
+    if (!c.unit_col_stride()) {
+        throw std::invalid_argument("gemm_bias_activation output view must have unit column stride");
+    }
+    size_t m = c.rows(), n = c.cols(), k = a.cols();
+    ProfileScope scope("gemm_bias_activation", 2.0 * m * n * k, 4.0 * (m * k + k * n + m * n + n));
+    active_kernels().gemm_bias_activation(c.data(), c.row_stride(), a.data(), a.row_stride(), a.col_stride(),
+                                          b.data(), b.row_stride(), b.col_stride(), bias, m, n, k, activation);
+}
+
+void gemm_bias_activation(MatrixView c, ConstMatrixView a, const HalfMatrix& b, const float* bias,
+                          ActivationType activation) {
+    if (a.cols() != b.rows() || c.rows() != a.rows() || c.cols() != b.cols()) {
+        throw std::invalid_argument("Matrix view dimensions don't match for multiplication");
+    }
+    if (!c.unit_col_stride()) {
+        throw std::invalid_argument("gemm_bias_activation output view must have unit column stride");
+    }
+    size_t m = c.rows(), n = c.cols(), k = a.cols();
+    ProfileScope scope("gemm_half_bias_activation", 2.0 * m * n * k, 4.0 * (m * k + m * n + n) + b.bytes());
+    active_kernels().gemm_half_bias_activation(c.data(), c.row_stride(), a.data(), a.row_stride(), a.col_stride(),
+                                               b.data(), b.cols(), 1, b.precision(), bias, m, n, k, activation);
+}
+
+void simd_add(float* a, const float* b, size_t size) {
+    ProfileScope scope("simd_add", size, 12.0 * size);
+    active_kernels().simd_add(a, b, size);
+}
+
+void simd_subtract(float* a, const float* b, size_t size) {
+    ProfileScope scope("simd_subtract", size, 12.0 * size);
+    active_kernels().simd_subtract(a, b, size);
+}
+
+namespace {
+
+// Applies a flat element-wise kernel to two equally shaped views: in one call
+// when both are dense, row by row when rows are contiguous, else per element
+template <typename Kernel, typename Scalar>
+void elementwise_views(MatrixView a, ConstMatrixView b, Kernel kernel, Scalar scalar) {
+    if (a.rows() != b.rows() || a.cols() != b.cols()) {
+        throw std::invalid_argument("Matrix view dimensions don't match for element-wise operation");
+    }
+    if (a.is_contiguous() && b.is_contiguous()) {
+        kernel(a.data(), b.data(), a.rows() * a.cols());
+    } else if (a.unit_col_stride() && b.unit_col_stride()) {
+        for (size_t i = 0; i < a.rows(); ++i) {
+            kernel(a.data() + i * a.row_stride(), b.data() + i * b.row_stride(), a.cols());
+        }
+    } else {
+        for (size_t i = 0; i < a.rows(); ++i) {
+            for (size_t j = 0; j < a.cols(); ++j) {
+                float& x = a.data()[i * a.row_stride() + j * a.col_stride()];
+                x = scalar(x, b.data()[i * b.row_stride() + j * b.col_stride()]);
+            }
+        }
+    }
+}
+
+} // namespace
+
+void simd_add(MatrixView a, ConstMatrixView b) {
+    ProfileScope scope("simd_add", double(a.rows()) * a.cols(), 12.0 * a.rows() * a.cols());
+    elementwise_views(a, b, active_kernels().simd_add, [](float x, float y) { return x + y; });
+}
+
+void simd_subtract(MatrixView a, ConstMatrixView b) {
+    ProfileScope scope("simd_subtract", double(a.rows()) * a.cols(), 12.0 * a.rows() * a.cols());
+    elementwise_views(a, b, active_kernels().simd_subtract, [](float x, float y) { return x - y; });
+}
+
+void simd_multiply(float* result, const float* a, const float* b, size_t m, size_t n, size_t k) {
+    gemm(result, a, b, m, n, k);
+}
+
+void block_multiply(float* result, const float* a, const float* b, size_t m, size_t n, size_t k) {
+    // Packing A and B into contiguous panels sized from L1/L2/L3 replaces the
+    // old fixed 32x32 tiling that walked B column-wise
+    gemm(result, a, b, m, n, k);
+}
+
+void activation_backward(float* delta, const float* gradient, const float* output,
+                         size_t size, ActivationType activation) {
+    ProfileScope scope("activation_backward", 3.0 * size, 12.0 * size);
+    active_kernels().activation_backward(delta, gradient, output, size, activation);
+}
+
+void activation_backward(MatrixView delta, ConstMatrixView gradient, ConstMatrixView output,
+                         ActivationType activation) {
+    if (gradient.rows() != delta.rows() || gradient.cols() != delta.cols() ||
+        output.rows() != delta.rows() || output.cols() != delta.cols()) {
+        throw std::invalid_argument("Matrix view dimensions don't match for activation_backward");
+    }
+    size_t rows = delta.rows(), cols = delta.cols();
+    ProfileScope scope("activation_backward", 3.0 * rows * cols, 12.0 * rows * cols);
+    const KernelTable& kernels = active_kernels();
+    if (delta.is_contiguous() && gradient.is_contiguous() && output.is_contiguous()) {
+        kernels.activation_backward(delta.data(), gradient.data(), output.data(), rows * cols, activation);
+    } else if (delta.unit_col_stride() && gradient.unit_col_stride() && output.unit_col_stride()) {
+        for (size_t i = 0; i < rows; ++i) {
+            kernels.activation_backward(delta.data() + i * delta.row_stride(),
+                                        gradient.data() + i * gradient.row_stride(),
+                                        output.data() + i * output.row_stride(), cols, activation);
+        }
+    } else {
+        for (size_t i = 0; i < rows; ++i) {
+            for (size_t j = 0; j < cols; ++j) {
+                kernels.activation_backward(&delta.at(i, j), &gradient.at(i, j), &output.at(i, j), 1, activation);
+            }
+        }
+    }
+}
+
+void column_sum(float* result, const float* a, size_t rows, size_t cols) {
+    ProfileScope scope("column_sum", static_cast<double>(rows) * cols, 4.0 * (rows + 1) * cols);
+    active_kernels().column_sum(result, a, rows, cols);
+}
+
+void sgd_update(float* params, const float* grads, size_t size, float learning_rate) {
+    ProfileScope scope("sgd_update", 2.0 * size, 12.0 * size);
+    active_kernels().sgd_update(params, grads, size, learning_rate);
+}
+
+void momentum_update(float* params, const float* grads, float* velocity, size_t size,
+                     float learning_rate, float momentum) {
+    ProfileScope scope("momentum_update", 4.0 * size, 20.0 * size);
+    active_kernels().momentum_update(params, grads, velocity, size, learning_rate, momentum);
+}
+
+void adam_update(float* params, const float* grads, float* m, float* v, size_t size,
+                 float learning_rate, float beta1, float beta2, float epsilon, size_t step) {
+    ProfileScope scope("adam_update", 12.0 * size, 28.0 * size);
+    active_kernels().adam_update(params, grads, m, v, size, learning_rate, beta1, beta2, epsilon, step);
+}
+
+int32_t int8_activation_max() {
+    return active_kernels().int8_activation_max();
+}
+
+size_t int8_packed_size(size_t k, size_t n) {
+    return active_kernels().int8_packed_size(k, n);
+}
+
+void pack_int8_weights(int8_t* packed, const int8_t* b, size_t k, size_t n) {
+    active_kernels().pack_int8_weights(packed, b, k, n);
+}
+
+void quantize_rows(uint8_t* qa, float* scales, int32_t* zero_points,
+                   const float* a, size_t m, size_t k) {
+    ProfileScope scope("quantize_rows", 3.0 * m * k, 5.0 * m * k);
+    active_kernels().quantize_rows(qa, scales, zero_points, a, m, k);
+}
+
+void int8_gemm_bias_activation(float* result,
+                               const uint8_t* qa, const float* a_scales, const int32_t* a_zero_points,
+                               const int8_t* packed_b, const int32_t* b_column_sums, const float* b_scales,
+                               const float* bias, size_t m, size_t n, size_t k,
+                               ActivationType activation) {
+    // Integer multiply-adds are counted as FLOPs for comparison with gemm
+    ProfileScope scope("int8_gemm_bias_activation", 2.0 * m * n * k, double(m * k + k * n) + 4.0 * m * n);
+    active_kernels().int8_gemm_bias_activation(result, qa, a_scales, a_zero_points, packed_b,
+                                               b_column_sums, b_scales, bias, m, n, k, activation);
+}
+
+namespace {
+
+// Validates a sparse product and returns a with contiguous rows, copying
+// it into copy when its columns are strided
+ConstMatrixView sparse_operand(MatrixView c, ConstMatrixView a, const SparseMatrix& b,
+                               std::optional<Matrix>& copy) {
+    if (a.cols() != b.rows() || c.rows() != a.rows() || c.cols() != b.cols()) {
+        throw std::invalid_argument("Matrix dimensions don't match for sparse multiplication");
+    }
+    if (!c.unit_col_stride()) {
+        throw std::invalid_argument("Sparse product output view must have unit column stride");
+    }
+    if (a.unit_col_stride() || a.rows() == 0 || a.cols() == 0) {
+        return a;
+    }
+    copy.emplace(a);
+    return std::as_const(*copy).view();
+}
+
+} // namespace
+
+void spmm(MatrixView c, ConstMatrixView a, const SparseMatrix& b) {
+    std::optional<Matrix> copy;
+    a = sparse_operand(c, a, b, copy);
+    size_t m = a.rows();
+    ProfileScope scope("spmm", 2.0 * m * b.stored_values(),
+                       4.0 * (m * b.rows() + m * b.cols()) + b.memory_bytes());
+    active_kernels().spmm(c.data(), c.row_stride(), a.data(), a.row_stride(), b, m);
+}
+
+void spmm_bias_activation(MatrixView c, ConstMatrixView a, const SparseMatrix& b, const float* bias,
+                          ActivationType activation) {
+    std::optional<Matrix> copy;
+    a = sparse_operand(c, a, b, copy);
+    size_t m = a.rows();
+    ProfileScope scope("spmm_bias_activation", 2.0 * m * b.stored_values(),
+                       4.0 * (m * b.rows() + m * b.cols() + b.cols()) + b.memory_bytes());
+    active_kernels().spmm_bias_activation(c.data(), c.row_stride(), a.data(), a.row_stride(), b, bias, m,
+                                          activation);
+}
+
+} // namespace ml
@@ -0,0 +1,163 @@
+#pragma once
+#include "activations.hpp"
+#include "gemm.hpp"
+#include "half.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ml {
+
+class SparseMatrix;
+
+// Runtime CPU dispatch
+// The kernels are compiled into several instruction-set variants:
+//   sse42:  SSE4.2 + POPCNT (baseline for any x86-64 from the last decade)
+//   avx2:   AVX2 + FMA + F16C (Haswell / Zen and newer)
+//   avx512: AVX-512 F/BW/DQ/VL (Skylake-SP / Zen 4 and newer); its int8
+//           kernels use VNNI where the host has it (Cascade Lake / Ice Lake
+//           and newer) and the 7-bit vpmaddubsw path otherwise
+// The best variant the host supports is chosen once, on first use, through
+// cpuid. MLCPP_ISA=sse42|avx2|avx512 in the environment forces a variant,
+// e.g. to test the fallbacks on a wide machine; requests the host cannot run
+// fall back to the best supported variant with a warning
+
+// Entry points of one kernel variant; the public functions in gemm.hpp,
+// optimizations.hpp, int8_gemm.hpp, sparse_matrix.hpp and half.hpp forward to the
+// selected table
+struct KernelTable {
+    const char* isa;
+    const GemmBlocking& (*gemm_blocking)();
+    // GEMMs take explicit strides: element (i, j) of A is a[i * a_rs + j * a_cs],
+    // likewise for B, and row i of the result starts at result + i * ldc
+    void (*gemm)(float* result, size_t ldc, const float* a, size_t a_rs, size_t a_cs,
+                 const float* b, size_t b_rs, size_t b_cs, size_t m, size_t n, size_t k);
+    // gemm with the given plan instead of the tuned or default one
+    void (*gemm_planned)(float* result, size_t ldc, const float* a, size_t a_rs, size_t a_cs,
+                         const float* b, size_t b_rs, size_t b_cs, size_t m, size_t n, size_t k,
+                         const GemmPlan& plan);
+    // Plans consulted by every GEMM of this variant; nullptr clears them
+    // table must stay alive while any kernel may still read it
+    void (*set_gemm_tuning)(const GemmTuningTable* table);
+    void (*gemm_bias_activation)(float* result, size_t ldc, const float* a, size_t a_rs, size_t a_cs,
+                                 const float* b, size_t b_rs, size_t b_cs, const float* bias,
+                                 size_t m, size_t n, size_t k, ActivationType activation);
+    // Same with 16-bit B of the given precision, widened to float as it is packed
+    void (*gemm_half_bias_activation)(float* result, size_t ldc, const float* a, size_t a_rs, size_t a_cs,
+                                      const uint16_t* b, size_t b_rs, size_t b_cs, Precision precision,
+                                      const float* bias, size_t m, size_t n, size_t k,
+                                      ActivationType activation);
+    void (*simd_add)(float* a, const float* b, size_t size);
+    void (*simd_subtract)(float* a, const float* b, size_t size);
+    void (*activation_backward)(float* delta, const float* gradient, const float* output,
+                                size_t size, ActivationType activation);
+    void (*column_sum)(float* result, const float* a, size_t rows, size_t cols);
+    void (*sgd_update)(float* params, const float* grads, size_t size, float learning_rate);
+    void (*momentum_update)(float* params, const float* grads, float* velocity, size_t size,
+                            float learning_rate, float momentum);
+    void (*adam_update)(float* params, const float* grads, float* m, float* v, size_t size,
+                        float learning_rate, float beta1, float beta2, float epsilon, size_t step);
+    int32_t (*int8_activation_max)();
+    size_t (*int8_packed_size)(size_t k, size_t n);
+    void (*pack_int8_weights)(int8_t* packed, const int8_t* b, size_t k, size_t n);
+    void (*quantize_rows)(uint8_t* qa, float* scales, int32_t* zero_points,
+                          const float* a, size_t m, size_t k);
+    void (*int8_gemm_bias_activation)(float* result,
+                                      const uint8_t* qa, const float* a_scales, const int32_t* a_zero_points,
+                                      const int8_t* packed_b, const int32_t* b_column_sums, const float* b_scales,
+                                      const float* bias, size_t m, size_t n, size_t k,
+                                      ActivationType activation);
+    // Sparse products of a dense m x b.rows() matrix with row stride lda
+    void (*spmm)(float* result, size_t ldc, const float* a, size_t lda, const SparseMatrix& b, size_t m);
+    void (*spmm_bias_activation)(float* result, size_t ldc, const float* a, size_t lda, const SparseMatrix& b,
+                                 const float* bias, size_t m, ActivationType activation);
+};
+
+// Variants linked into the library
+namespace sse42 { const KernelTable& kernel_table(); }
+namespace avx2 { const KernelTable& kernel_table(); }
+namespace avx512 { const KernelTable& kernel_table(); }
+
+// Int8 kernels compiled with VNNI on top of the avx512 flags; the avx512
+// table takes them on hosts with vpdpbusd
+namespace avx512vnni {
+int32_t int8_activation_max();
+size_t int8_packed_size(size_t k, size_t n);
+void pack_int8_weights(int8_t* packed, const int8_t* b, size_t k, size_t n);
+void quantize_rows(uint8_t* qa, float* scales, int32_t* zero_points,
+                   const float* a, size_t m, size_t k);
+void int8_gemm_bias_activation(float* result,
+                               const uint8_t* qa, const float* a_scales, const int32_t* a_zero_points,
+                               const int8_t* packed_b, const int32_t* b_column_sums, const float* b_scales,
+                               const float* bias, size_t m, size_t n, size_t k,
+                               ActivationType activation);
+} // namespace avx512vnni
+
+// Table of the selected variant
+const KernelTable& active_kernels();
+
+// Table of the named variant, whether or not the host can run it
+// Throws std::invalid_argument for an unknown name
+const KernelTable& kernel_table_for(const std::string& isa);
+
+// Name of the selected variant
+std::string get_kernel_isa();
+
+// Variants the host can run, from narrowest to widest
+std::vector<std::string> available_kernel_isas();
+
+// Switch to the named variant for all later kernel calls
+// Must not be called while kernels are running on other threads
+// Throws std::invalid_argument for an unknown name and std::runtime_error
+// when the host lacks the instructions the variant needs
+void set_kernel_isa(const std::string& isa);
+
+// Implementations of the variant being compiled, see isa.hpp
+namespace MLCPP_ISA {
+
+const KernelTable& kernel_table();
+
+const GemmBlocking& gemm_blocking();
+void gemm(float* result, size_t ldc, const float* a, size_t a_rs, size_t a_cs,
+          const float* b, size_t b_rs, size_t b_cs, size_t m, size_t n, size_t k);
+void gemm_planned(float* result, size_t ldc, const float* a, size_t a_rs, size_t a_cs,
+                  const float* b, size_t b_rs, size_t b_cs, size_t m, size_t n, size_t k,
+                  const GemmPlan& plan);
+void set_gemm_tuning(const GemmTuningTable* table);
+void gemm_bias_activation(float* result, size_t ldc, const float* a, size_t a_rs, size_t a_cs,
+                          const float* b, size_t b_rs, size_t b_cs, const float* bias,
+                          size_t m, size_t n, size_t k, ActivationType activation);
+void gemm_half_bias_activation(float* result, size_t ldc, const float* a, size_t a_rs, size_t a_cs,
+                               const uint16_t* b, size_t b_rs, size_t b_cs, Precision precision,
+                               const float* bias, size_t m, size_t n, size_t k, ActivationType activation);
+
+void simd_add(float* a, const float* b, size_t size);
+void simd_subtract(float* a, const float* b, size_t size);
+void activation_backward(float* delta, const float* gradient, const float* output,
+                         size_t size, ActivationType activation);
+void column_sum(float* result, const float* a, size_t rows, size_t cols);
+void sgd_update(float* params, const float* grads, size_t size, float learning_rate);
+void momentum_update(float* params, const float* grads, float* velocity, size_t size,
+                     float learning_rate, float momentum);
+void adam_update(float* params, const float* grads, float* m, float* v, size_t size,
+                 float learning_rate, float beta1, float beta2, float epsilon, size_t step);
+
+int32_t int8_activation_max();
+size_t int8_packed_size(size_t k, size_t n);
+void pack_int8_weights(int8_t* packed, const int8_t* b, size_t k, size_t n);
+void quantize_rows(uint8_t* qa, float* scales, int32_t* zero_points,
+                   const float* a, size_t m, size_t k);
+void int8_gemm_bias_activation(float* result,
+                               const uint8_t* qa, const float* a_scales, const int32_t* a_zero_points,
+                               const int8_t* packed_b, const int32_t* b_column_sums, const float* b_scales,
+                               const float* bias, size_t m, size_t n, size_t k,
+                               ActivationType activation);
+
+void spmm(float* result, size_t ldc, const float* a, size_t lda, const SparseMatrix& b, size_t m);
+void spmm_bias_activation(float* result, size_t ldc, const float* a, size_t lda, const SparseMatrix& b,
+                          const float* bias, size_t m, ActivationType activation);
+
+} // namespace MLCPP_ISA
+
+} // namespace ml
@@ -0,0 +1,48 @@
+#pragma once
+#include "activations.hpp"
+#include <immintrin.h>
+#include <cstddef>
+
+namespace ml {
+
+// Store epilogues shared by the dense and sparse float kernels
+// Compiled per instruction-set variant, see isa.hpp
+namespace MLCPP_ISA {
+
+// Epilogue that leaves the finished tile untouched
+struct NoEpilogue {
+    static constexpr bool enabled = false;
+
+    NoEpilogue offset(size_t) const { return *this; }
+    float apply(float x, size_t) const { return x; }
+#if defined(__AVX2__) && defined(__FMA__)
+    __m256 apply(__m256 x, size_t) const { return x; }
+#endif
+#if defined(__AVX512F__) && defined(__AVX512DQ__)
+    __m512 apply(__m512 x, size_t) const { return x; }
+#endif
+};
+
+// Epilogue that adds a per-column bias and applies an activation while the
+// tile is still in registers, so C is written exactly once
+template <ActivationType Act>
+struct BiasActivationEpilogue {
+    static constexpr bool enabled = true;
+    const float* bias; // One entry per column of C
+
+    BiasActivationEpilogue offset(size_t cols) const { return {bias + cols}; }
+    float apply(float x, size_t col) const { return Activation<Act>::apply(x + bias[col]); }
+#if defined(__AVX2__) && defined(__FMA__)
+    __m256 apply(__m256 x, size_t col) const {
+        return Activation<Act>::apply(_mm256_add_ps(x, _mm256_loadu_ps(bias + col)));
+    }
+#endif
+#if defined(__AVX512F__) && defined(__AVX512DQ__)
+    __m512 apply(__m512 x, size_t col) const {
+        return Activation<Act>::apply(_mm512_add_ps(x, _mm512_loadu_ps(bias + col)));
+    }
+#endif
+};
+
+} // namespace MLCPP_ISA
+} // namespace ml
@@ -0,0 +1,86 @@
+#pragma once
+#include "isa.hpp"
+#include <immintrin.h>
+#include <cstddef>
+
+namespace ml {
+
+// Compiled per instruction-set variant, see isa.hpp
+namespace MLCPP_ISA {
+
+// Widest float vector of the variant being compiled, with the handful of
+// operations the element-wise and sparse kernels need
+// Loads and stores are unaligned: on the targeted cores they cost the same as
+// aligned ones on pooled 64-byte aligned matrices, and wrapped external
+// buffers (e.g. NumPy arrays) may only be float-aligned
+#if defined(__AVX512F__) && defined(__AVX512DQ__)
+
+struct FloatVec {
+    static constexpr size_t width = 16;
+    __m512 v;
+
+    static FloatVec load(const float* p) { return {_mm512_loadu_ps(p)}; }
+    static FloatVec set1(float x) { return {_mm512_set1_ps(x)}; }
+    void store(float* p) const { _mm512_storeu_ps(p, v); }
+
+    friend FloatVec operator+(FloatVec a, FloatVec b) { return {_mm512_add_ps(a.v, b.v)}; }
+    friend FloatVec operator-(FloatVec a, FloatVec b) { return {_mm512_sub_ps(a.v, b.v)}; }
+    friend FloatVec operator*(FloatVec a, FloatVec b) { return {_mm512_mul_ps(a.v, b.v)}; }
+    friend FloatVec operator/(FloatVec a, FloatVec b) { return {_mm512_div_ps(a.v, b.v)}; }
+    // a * b + c
+    friend FloatVec fmadd(FloatVec a, FloatVec b, FloatVec c) { return {_mm512_fmadd_ps(a.v, b.v, c.v)}; }
+    friend FloatVec sqrt(FloatVec a) { return {_mm512_sqrt_ps(a.v)}; }
+    // x where y > 0, else 0
+    friend FloatVec where_positive(FloatVec y, FloatVec x) {
+        return {_mm512_maskz_mov_ps(_mm512_cmp_ps_mask(y.v, _mm512_setzero_ps(), _CMP_GT_OQ), x.v)};
+    }
+};
+
+#elif defined(__AVX2__) && defined(__FMA__)
+
+struct FloatVec {
+    static constexpr size_t width = 8;
+    __m256 v;
+
+    static FloatVec load(const float* p) { return {_mm256_loadu_ps(p)}; }
+    static FloatVec set1(float x) { return {_mm256_set1_ps(x)}; }
+    void store(float* p) const { _mm256_storeu_ps(p, v); }
+
+    friend FloatVec operator+(FloatVec a, FloatVec b) { return {_mm256_add_ps(a.v, b.v)}; }
+    friend FloatVec operator-(FloatVec a, FloatVec b) { return {_mm256_sub_ps(a.v, b.v)}; }
+    friend FloatVec operator*(FloatVec a, FloatVec b) { return {_mm256_mul_ps(a.v, b.v)}; }
+    friend FloatVec operator/(FloatVec a, FloatVec b) { return {_mm256_div_ps(a.v, b.v)}; }
+    friend FloatVec fmadd(FloatVec a, FloatVec b, FloatVec c) { return {_mm256_fmadd_ps(a.v, b.v, c.v)}; }
+    friend FloatVec sqrt(FloatVec a) { return {_mm256_sqrt_ps(a.v)}; }
+    friend FloatVec where_positive(FloatVec y, FloatVec x) {
+        return {_mm256_and_ps(x.v, _mm256_cmp_ps(y.v, _mm256_setzero_ps(), _CMP_GT_OQ))};
+    }
+};
+
+#else
+
+// SSE is part of the x86-64 baseline, so even the narrowest variant has
+// 4-wide vectors; without FMA the multiply and add round separately
+struct FloatVec {
+    static constexpr size_t width = 4;
+    __m128 v;
+
+    static FloatVec load(const float* p) { return {_mm_loadu_ps(p)}; }
+    static FloatVec set1(float x) { return {_mm_set1_ps(x)}; }
+    void store(float* p) const { _mm_storeu_ps(p, v); }
+
+    friend FloatVec operator+(FloatVec a, FloatVec b) { return {_mm_add_ps(a.v, b.v)}; }
+    friend FloatVec operator-(FloatVec a, FloatVec b) { return {_mm_sub_ps(a.v, b.v)}; }
+    friend FloatVec operator*(FloatVec a, FloatVec b) { return {_mm_mul_ps(a.v, b.v)}; }
+    friend FloatVec operator/(FloatVec a, FloatVec b) { return {_mm_div_ps(a.v, b.v)}; }
+    friend FloatVec fmadd(FloatVec a, FloatVec b, FloatVec c) { return {_mm_add_ps(_mm_mul_ps(a.v, b.v), c.v)}; }
+    friend FloatVec sqrt(FloatVec a) { return {_mm_sqrt_ps(a.v)}; }
+    friend FloatVec where_positive(FloatVec y, FloatVec x) {
+        return {_mm_and_ps(x.v, _mm_cmpgt_ps(y.v, _mm_setzero_ps()))};
+    }
+};
+
+#endif
+
+} // namespace MLCPP_ISA
+} // namespace ml
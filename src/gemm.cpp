@@ -0,0 +1,576 @@
+#include "cpu_dispatch.hpp"
+#include "epilogue.hpp"
+#include "thread_pool.hpp"
+#include <immintrin.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+namespace ml {
+namespace MLCPP_ISA {
+
+namespace {
+
+// Register tile computed by one micro-kernel invocation
+// Six rows keep 12 accumulators live while leaving registers for the A
+// broadcast and the B loads: 6 x 16 columns with AVX2, 6 x 32 with AVX-512
+constexpr size_t GEMM_MR = 6;
+#if defined(__AVX512F__) && defined(__AVX512DQ__)
+constexpr size_t GEMM_NR = 32;
+#else
+constexpr size_t GEMM_NR = 16;
+#endif
+
+// Round value down to a multiple of step, never below step itself
+size_t round_down(size_t value, size_t step) {
+    return std::max(step, value / step * step);
+}
+
+// Query a cache size through sysconf, returning fallback when unavailable
+size_t query_cache_size(int name, size_t fallback) {
+    long size = sysconf(name);
+    return size > 0 ? static_cast<size_t>(size) : fallback;
+}
+
+GemmBlocking compute_blocking() {
+#if defined(_SC_LEVEL1_DCACHE_SIZE)
+    size_t l1 = query_cache_size(_SC_LEVEL1_DCACHE_SIZE, 32 * 1024);
+    size_t l2 = query_cache_size(_SC_LEVEL2_CACHE_SIZE, 256 * 1024);
+    size_t l3 = query_cache_size(_SC_LEVEL3_CACHE_SIZE, 8 * 1024 * 1024);
+#else
+    size_t l1 = 32 * 1024;
+    size_t l2 = 256 * 1024;
+    size_t l3 = 8 * 1024 * 1024;
+#endif
+
+    GemmBlocking blocking;
+    // A KC x NR sliver of B should use about half of L1, leaving room for A
+    blocking.kc = std::clamp<size_t>(round_down(l1 / 2 / (GEMM_NR * sizeof(float)), 8), 64, 512);
+    // The packed MC x KC block of A should use about half of L2
+    blocking.mc = std::clamp<size_t>(round_down(l2 / 2 / (blocking.kc * sizeof(float)), GEMM_MR),
+                                     GEMM_MR * 4, GEMM_MR * 128);
+    // The packed KC x NC panel of B should use about half of L3
+    blocking.nc = std::clamp<size_t>(round_down(l3 / 2 / (blocking.kc * sizeof(float)), GEMM_NR),
+                                     GEMM_NR * 16, GEMM_NR * 512);
+    return blocking;
+}
+
+// Thread-local 64-byte aligned scratch buffer for packed panels
+// Grows on demand and is reused across calls to avoid per-GEMM allocation
+class PackBuffer {
+public:
+    ~PackBuffer() { std::free(data_); }
+
+    float* reserve(size_t count) {
+        if (count > capacity_) {
+            std::free(data_);
+            size_t bytes = ((count * sizeof(float) + 63) / 64) * 64;
+            data_ = static_cast<float*>(std::aligned_alloc(64, bytes));
+            if (!data_) {
+                capacity_ = 0;
+                throw std::bad_alloc();
+            }
+            capacity_ = bytes / sizeof(float);
+        }
+        return data_;
+    }
+
+private:
+    float* data_ = nullptr;
+    size_t capacity_ = 0;
+};
+
+// Pack an mc x kc block of A into MR-row micro-panels stored depth-major
+// Element (i, p) of the block lives at a[i * rs + p * cs], which covers both
+// row-major A (rs = lda, cs = 1) and a transposed operand (rs = 1, cs = lda)
+// Missing rows are zero-padded
+void pack_a(float* packed, const float* a, size_t rs, size_t cs, size_t mc, size_t kc) {
+    for (size_t ir = 0; ir < mc; ir += GEMM_MR) {
+        size_t mr = std::min(GEMM_MR, mc - ir);
+        const float* src = a + ir * rs;
+        for (size_t p = 0; p < kc; ++p) {
+            size_t i = 0;
+            if (rs == 1) {
+                std::memcpy(packed, src + p * cs, mr * sizeof(float));
+                i = mr;
+            } else {
+                for (; i < mr; ++i) {
+                    packed[i] = src[i * rs + p * cs];
+                }
+            }
+            for (; i < GEMM_MR; ++i) {
+                packed[i] = 0.0f;
+            }
+            packed += GEMM_MR;
+        }
+    }
+}
+
+// Element sources for B: pack_b reads B through one of these, so a 16-bit
+// operand is widened to float while it is packed and the micro-kernels only
+// ever see float panels
+// load widens one element, widen a contiguous run of them
+
+struct Float32Source {
+    using Element = float;
+    static float load(float value) { return value; }
+    static void widen(float* dst, const float* src, size_t count) {
+        std::memcpy(dst, src, count * sizeof(float));
+    }
+};
+
+// bfloat16 is the upper half of a float, so widening is a 16-bit shift
+struct BFloat16Source {
+    using Element = uint16_t;
+    static float load(uint16_t value) { return bfloat16_to_float(value); }
+    static void widen(float* dst, const uint16_t* src, size_t count) {
+        size_t i = 0;
+#if defined(__AVX512F__)
+        for (; i + 16 <= count; i += 16) {
+            __m512i wide = _mm512_cvtepu16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)));
+            _mm512_storeu_ps(dst + i, _mm512_castsi512_ps(_mm512_slli_epi32(wide, 16)));
+        }
+#elif defined(__AVX2__)
+        for (; i + 8 <= count; i += 8) {
+            __m256i wide = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+            _mm256_storeu_ps(dst + i, _mm256_castsi256_ps(_mm256_slli_epi32(wide, 16)));
+        }
+#else
+        // Interleaving zeros below each value shifts it into the upper half
+        for (; i + 8 <= count; i += 8) {
+            __m128i half = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            _mm_storeu_ps(dst + i, _mm_castsi128_ps(_mm_unpacklo_epi16(_mm_setzero_si128(), half)));
+            _mm_storeu_ps(dst + i + 4, _mm_castsi128_ps(_mm_unpackhi_epi16(_mm_setzero_si128(), half)));
+        }
+#endif
+        for (; i < count; ++i) {
+            dst[i] = bfloat16_to_float(src[i]);
+        }
+    }
+};
+
+// float16 widens with the F16C conversion where the variant has it
+struct Float16Source {
+    using Element = uint16_t;
+    static float load(uint16_t value) { return float16_to_float(value); }
+    static void widen(float* dst, const uint16_t* src, size_t count) {
+        size_t i = 0;
+#if defined(__AVX512F__)
+        for (; i + 16 <= count; i += 16) {
+            _mm512_storeu_ps(dst + i, _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i))));
+        }
+#elif defined(__F16C__)
+        for (; i + 8 <= count; i += 8) {
+            _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i))));
+        }
+#endif
+        for (; i < count; ++i) {
+            dst[i] = float16_to_float(src[i]);
+        }
+    }
+};
+
+// Pack a kc x nc block of B into NR-column micro-panels stored depth-major
+// Element (p, j) of the block lives at b[p * rs + j * cs]
+// Missing columns are zero-padded
+template <typename Source>
+void pack_b(float* packed, const typename Source::Element* b, size_t rs, size_t cs, size_t kc, size_t nc) {
+    for (size_t jr = 0; jr < nc; jr += GEMM_NR) {
+        size_t nr = std::min(GEMM_NR, nc - jr);
+        const typename Source::Element* src = b + jr * cs;
+        for (size_t p = 0; p < kc; ++p) {
+            if (cs == 1) {
+                Source::widen(packed, src + p * rs, nr);
+            } else {
+                for (size_t j = 0; j < nr; ++j) {
+                    packed[j] = Source::load(src[p * rs + j * cs]);
+                }
+            }
+            std::fill(packed + nr, packed + GEMM_NR, 0.0f);
+            packed += GEMM_NR;
+        }
+    }
+}
+
+// Element strides of a GEMM operand: element (r, c) is at ptr[r * rs + c * cs]
+struct OperandLayout {
+    size_t rs;
+    size_t cs;
+};
+
+#if defined(__AVX512F__) && defined(__AVX512DQ__)
+
+// 6x32 AVX-512 micro-kernel
+// Same structure as the AVX2 kernel with zmm accumulators, so each broadcast
+// of A feeds 32 columns
+template <typename Epilogue>
+void micro_kernel(size_t kc, const float* a, const float* b,
+                  float* c, size_t ldc, bool accumulate,
+                  const Epilogue& epilogue, size_t col, bool finish) {
+    __m512 c00 = _mm512_setzero_ps(), c01 = _mm512_setzero_ps();
+    __m512 c10 = _mm512_setzero_ps(), c11 = _mm512_setzero_ps();
+    __m512 c20 = _mm512_setzero_ps(), c21 = _mm512_setzero_ps();
+    __m512 c30 = _mm512_setzero_ps(), c31 = _mm512_setzero_ps();
+    __m512 c40 = _mm512_setzero_ps(), c41 = _mm512_setzero_ps();
+    __m512 c50 = _mm512_setzero_ps(), c51 = _mm512_setzero_ps();
+
+    for (size_t p = 0; p < kc; ++p) {
+        __m512 b0 = _mm512_load_ps(b);
+        __m512 b1 = _mm512_load_ps(b + 16);
+        __m512 ai;
+
+        ai = _mm512_set1_ps(a[0]);
+        c00 = _mm512_fmadd_ps(ai, b0, c00); c01 = _mm512_fmadd_ps(ai, b1, c01);
+        ai = _mm512_set1_ps(a[1]);
+        c10 = _mm512_fmadd_ps(ai, b0, c10); c11 = _mm512_fmadd_ps(ai, b1, c11);
+        ai = _mm512_set1_ps(a[2]);
+        c20 = _mm512_fmadd_ps(ai, b0, c20); c21 = _mm512_fmadd_ps(ai, b1, c21);
+        ai = _mm512_set1_ps(a[3]);
+        c30 = _mm512_fmadd_ps(ai, b0, c30); c31 = _mm512_fmadd_ps(ai, b1, c31);
+        ai = _mm512_set1_ps(a[4]);
+        c40 = _mm512_fmadd_ps(ai, b0, c40); c41 = _mm512_fmadd_ps(ai, b1, c41);
+        ai = _mm512_set1_ps(a[5]);
+        c50 = _mm512_fmadd_ps(ai, b0, c50); c51 = _mm512_fmadd_ps(ai, b1, c51);
+
+        a += GEMM_MR;
+        b += GEMM_NR;
+    }
+
+    __m512 rows[GEMM_MR][2] = {
+        {c00, c01}, {c10, c11}, {c20, c21}, {c30, c31}, {c40, c41}, {c50, c51}
+    };
+    for (size_t i = 0; i < GEMM_MR; ++i) {
+        float* row = c + i * ldc;
+        if (accumulate) {
+            rows[i][0] = _mm512_add_ps(rows[i][0], _mm512_loadu_ps(row));
+            rows[i][1] = _mm512_add_ps(rows[i][1], _mm512_loadu_ps(row + 16));
+        }
+        if (Epilogue::enabled && finish) {
+            rows[i][0] = epilogue.apply(rows[i][0], col);
+            rows[i][1] = epilogue.apply(rows[i][1], col + 16);
+        }
+        _mm512_storeu_ps(row, rows[i][0]);
+        _mm512_storeu_ps(row + 16, rows[i][1]);
+    }
+}
+
+#elif defined(__AVX2__) && defined(__FMA__)
+
+// 6x16 AVX2/FMA micro-kernel
+// Computes a MR x NR tile of C from packed A (kc x MR) and packed B (kc x NR)
+// accumulate: Add to the existing contents of C instead of overwriting them
+// finish: This is the last depth block, so the epilogue runs before the store
+// col: Column of C where the tile starts, used to index the epilogue
+template <typename Epilogue>
+void micro_kernel(size_t kc, const float* a, const float* b,
+                  float* c, size_t ldc, bool accumulate,
+                  const Epilogue& epilogue, size_t col, bool finish) {
+    __m256 c00 = _mm256_setzero_ps(), c01 = _mm256_setzero_ps();
+    __m256 c10 = _mm256_setzero_ps(), c11 = _mm256_setzero_ps();
+    __m256 c20 = _mm256_setzero_ps(), c21 = _mm256_setzero_ps();
+    __m256 c30 = _mm256_setzero_ps(), c31 = _mm256_setzero_ps();
+    __m256 c40 = _mm256_setzero_ps(), c41 = _mm256_setzero_ps();
+    __m256 c50 = _mm256_setzero_ps(), c51 = _mm256_setzero_ps();
+
+    for (size_t p = 0; p < kc; ++p) {
+        __m256 b0 = _mm256_load_ps(b);
+        __m256 b1 = _mm256_load_ps(b + 8);
+        __m256 ai;
+
+        ai = _mm256_broadcast_ss(a + 0);
+        c00 = _mm256_fmadd_ps(ai, b0, c00); c01 = _mm256_fmadd_ps(ai, b1, c01);
+        ai = _mm256_broadcast_ss(a + 1);
+        c10 = _mm256_fmadd_ps(ai, b0, c10); c11 = _mm256_fmadd_ps(ai, b1, c11);
+        ai = _mm256_broadcast_ss(a + 2);
+        c20 = _mm256_fmadd_ps(ai, b0, c20); c21 = _mm256_fmadd_ps(ai, b1, c21);
+        ai = _mm256_broadcast_ss(a + 3);
+        c30 = _mm256_fmadd_ps(ai, b0, c30); c31 = _mm256_fmadd_ps(ai, b1, c31);
+        ai = _mm256_broadcast_ss(a + 4);
+        c40 = _mm256_fmadd_ps(ai, b0, c40); c41 = _mm256_fmadd_ps(ai, b1, c41);
+        ai = _mm256_broadcast_ss(a + 5);
+        c50 = _mm256_fmadd_ps(ai, b0, c50); c51 = _mm256_fmadd_ps(ai, b1, c51);
+
+        a += GEMM_MR;
+        b += GEMM_NR;
+    }
+
+    __m256 rows[GEMM_MR][2] = {
+        {c00, c01}, {c10, c11}, {c20, c21}, {c30, c31}, {c40, c41}, {c50, c51}
+    };
+    for (size_t i = 0; i < GEMM_MR; ++i) {
+        float* row = c + i * ldc;
+        if (accumulate) {
+            rows[i][0] = _mm256_add_ps(rows[i][0], _mm256_loadu_ps(row));
+            rows[i][1] = _mm256_add_ps(rows[i][1], _mm256_loadu_ps(row + 8));
+        }
+        if (Epilogue::enabled && finish) {
+            rows[i][0] = epilogue.apply(rows[i][0], col);
+            rows[i][1] = epilogue.apply(rows[i][1], col + 8);
+        }
+        _mm256_storeu_ps(row, rows[i][0]);
+        _mm256_storeu_ps(row + 8, rows[i][1]);
+    }
+}
+
+#else
+
+// Portable micro-kernel used when the target lacks AVX2/FMA
+// Plain loops over a fixed-size tile, which the compiler vectorizes for SSE
+template <typename Epilogue>
+void micro_kernel(size_t kc, const float* a, const float* b,
+                  float* c, size_t ldc, bool accumulate,
+                  const Epilogue& epilogue, size_t col, bool finish) {
+    float tile[GEMM_MR][GEMM_NR] = {};
+    for (size_t p = 0; p < kc; ++p) {
+        for (size_t i = 0; i < GEMM_MR; ++i) {
+            float ai = a[i];
+            for (size_t j = 0; j < GEMM_NR; ++j) {
+                tile[i][j] += ai * b[j];
+            }
+        }
+        a += GEMM_MR;
+        b += GEMM_NR;
+    }
+    for (size_t i = 0; i < GEMM_MR; ++i) {
+        for (size_t j = 0; j < GEMM_NR; ++j) {
+            float value = accumulate ? c[i * ldc + j] + tile[i][j] : tile[i][j];
+            if (Epilogue::enabled && finish) {
+                value = epilogue.apply(value, col + j);
+            }
+            c[i * ldc + j] = value;
+        }
+    }
+}
+
+#endif
+
+// Run the micro-kernel on a possibly partial tile
+// Full tiles are written straight to C; edge tiles go through a local
+// buffer and only the valid mr x nr corner is copied back (scalar epilogue)
+template <typename Epilogue>
+void compute_tile(size_t kc, const float* a, const float* b, float* c, size_t ldc,
+                  size_t mr, size_t nr, bool accumulate,
+                  const Epilogue& epilogue, size_t col, bool finish) {
+    if (mr == GEMM_MR && nr == GEMM_NR) {
+        micro_kernel(kc, a, b, c, ldc, accumulate, epilogue, col, finish);
+        return;
+    }
+
+    alignas(64) float tile[GEMM_MR * GEMM_NR];
+    micro_kernel(kc, a, b, tile, GEMM_NR, false, NoEpilogue{}, 0, false);
+    for (size_t i = 0; i < mr; ++i) {
+        float* row = c + i * ldc;
+        const float* src = tile + i * GEMM_NR;
+        for (size_t j = 0; j < nr; ++j) {
+            float value = accumulate ? row[j] + src[j] : src[j];
+            if (Epilogue::enabled && finish) {
+                value = epilogue.apply(value, col + j);
+            }
+            row[j] = value;
+        }
+    }
+}
+
+// Single-threaded engine over a sub-problem with explicit operand strides
+// Source: Element type of B and how it is widened, see pack_b
+template <typename Source, typename Epilogue>
+void gemm_serial(float* result, const float* a, const typename Source::Element* b,
+                 size_t m, size_t n, size_t k,
+                 OperandLayout la, OperandLayout lb, size_t ldc,
+                 const GemmBlocking& blocking, const Epilogue& epilogue) {
+    thread_local PackBuffer a_buffer;
+    thread_local PackBuffer b_buffer;
+
+    size_t kc_max = std::min(blocking.kc, k);
+    size_t mc_max = std::min(blocking.mc, (m + GEMM_MR - 1) / GEMM_MR * GEMM_MR);
+    size_t nc_max = std::min(blocking.nc, (n + GEMM_NR - 1) / GEMM_NR * GEMM_NR);
+    float* packed_a = a_buffer.reserve(mc_max * kc_max);
+    float* packed_b = b_buffer.reserve(kc_max * nc_max);
+
+    for (size_t jc = 0; jc < n; jc += blocking.nc) {
+        size_t nc = std::min(blocking.nc, n - jc);
+
+        for (size_t pc = 0; pc < k; pc += blocking.kc) {
+            size_t kc = std::min(blocking.kc, k - pc);
+            // The first depth block overwrites C, later ones accumulate,
+            // and the epilogue runs with the last one
+            bool accumulate = pc != 0;
+            bool finish = pc + kc == k;
+            pack_b<Source>(packed_b, b + pc * lb.rs + jc * lb.cs, lb.rs, lb.cs, kc, nc);
+
+            for (size_t ic = 0; ic < m; ic += blocking.mc) {
+                size_t mc = std::min(blocking.mc, m - ic);
+                pack_a(packed_a, a + ic * la.rs + pc * la.cs, la.rs, la.cs, mc, kc);
+
+                for (size_t jr = 0; jr < nc; jr += GEMM_NR) {
+                    size_t nr = std::min(GEMM_NR, nc - jr);
+                    const float* bp = packed_b + jr * kc;
+
+                    for (size_t ir = 0; ir < mc; ir += GEMM_MR) {
+                        size_t mr = std::min(GEMM_MR, mc - ir);
+                        const float* ap = packed_a + ir * kc;
+                        float* c = result + (ic + ir) * ldc + jc + jr;
+                        compute_tile(kc, ap, bp, c, ldc, mr, nr, accumulate,
+                                     epilogue, jc + jr, finish);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Plans installed by set_gemm_tuning(), nullptr when nothing is tuned
+std::atomic<const GemmTuningTable*> g_gemm_tuning{nullptr};
+
+// Block sizes of plan, rounded to the register tile
+GemmBlocking planned_blocking(const GemmPlan& plan) {
+    return {round_down(plan.blocking.mc, GEMM_MR), std::max<size_t>(plan.blocking.kc, 1),
+            round_down(plan.blocking.nc, GEMM_NR)};
+}
+
+// Shared driver: handles degenerate shapes and splits large problems into
+// M/N macro-tiles across the thread pool
+// la, lb: Operand strides; transposed and sub-block operands are read in
+// place, the packing routines gather them into contiguous panels
+// ldc: Row stride of result, whose rows are contiguous
+// plan: Blocking and split to use; nullptr looks the shape up in the tuned
+// plans and falls back to the cache-derived defaults
+template <typename Source, typename Epilogue>
+void gemm_driver(float* result, size_t ldc, const float* a, OperandLayout la,
+                 const typename Source::Element* b, OperandLayout lb, size_t m, size_t n, size_t k,
+                 const Epilogue& epilogue, const GemmPlan* plan = nullptr) {
+    if (m == 0 || n == 0) {
+        return;
+    }
+    if (k == 0) {
+        for (size_t i = 0; i < m; ++i) {
+            for (size_t j = 0; j < n; ++j) {
+                result[i * ldc + j] = epilogue.apply(0.0f, j);
+            }
+        }
+        return;
+    }
+
+    if (!plan) {
+        const GemmTuningTable* tuning = g_gemm_tuning.load(std::memory_order_acquire);
+        plan = tuning ? tuning->find(m, n, k) : nullptr;
+    }
+    GemmBlocking blocking = plan ? planned_blocking(*plan) : gemm_blocking();
+    ThreadPool& pool = ThreadPool::instance();
+    size_t threads = pool.num_threads();
+    bool planned_split = plan && plan->threads == threads;
+    bool serial = planned_split ? plan->m_parts * plan->n_parts <= 1 : m * n * k < PARALLEL_GEMM_MIN_FLOPS;
+    if (threads == 1 || serial) {
+        gemm_serial<Source>(result, a, b, m, n, k, la, lb, ldc, blocking, epilogue);
+        return;
+    }
+
+    // Split C into a grid of macro-tiles in units of the register tile
+    // Untuned shapes follow the aspect ratio of C so that skinny inference
+    // shapes (small m) are divided along N and tall training shapes along M
+    size_t m_units = (m + GEMM_MR - 1) / GEMM_MR;
+    size_t n_units = (n + GEMM_NR - 1) / GEMM_NR;
+    size_t m_parts, n_parts;
+    if (planned_split) {
+        m_parts = std::clamp<size_t>(plan->m_parts, 1, m_units);
+        n_parts = std::clamp<size_t>(plan->n_parts, 1, n_units);
+    } else {
+        double ratio = static_cast<double>(m) / static_cast<double>(n);
+        m_parts = static_cast<size_t>(std::lround(std::sqrt(threads * ratio)));
+        m_parts = std::clamp<size_t>(m_parts, 1, std::min(threads, m_units));
+        n_parts = std::clamp<size_t>(threads / m_parts, 1, n_units);
+    }
+
+    size_t m_step = (m_units + m_parts - 1) / m_parts * GEMM_MR;
+    size_t n_step = (n_units + n_parts - 1) / n_parts * GEMM_NR;
+    m_parts = (m + m_step - 1) / m_step;
+    n_parts = (n + n_step - 1) / n_step;
+
+    pool.parallel_for(m_parts * n_parts, [&](size_t task) {
+        size_t i0 = (task / n_parts) * m_step;
+        size_t j0 = (task % n_parts) * n_step;
+        size_t mb = std::min(m_step, m - i0);
+        size_t nb = std::min(n_step, n - j0);
+        gemm_serial<Source>(result + i0 * ldc + j0, a + i0 * la.rs, b + j0 * lb.cs, mb, nb, k, la, lb, ldc,
+                    blocking, epilogue.offset(j0));
+    });
+}
+
+// Fused bias + activation GEMM over any B source
+// The activation is resolved here once, so the micro-kernel is instantiated
+// per activation with no per-element dispatch
+template <typename Source>
+void gemm_bias_activation_from(float* result, size_t ldc, const float* a, OperandLayout la,
+                               const typename Source::Element* b, OperandLayout lb, const float* bias,
+                               size_t m, size_t n, size_t k, ActivationType activation) {
+    switch (activation) {
+        case ActivationType::ReLU:
+            gemm_driver<Source>(result, ldc, a, la, b, lb, m, n, k,
+                                BiasActivationEpilogue<ActivationType::ReLU>{bias});
+            break;
+        case ActivationType::Sigmoid:
+            gemm_driver<Source>(result, ldc, a, la, b, lb, m, n, k,
+                                BiasActivationEpilogue<ActivationType::Sigmoid>{bias});
+            break;
+        case ActivationType::Tanh:
+            gemm_driver<Source>(result, ldc, a, la, b, lb, m, n, k,
+                                BiasActivationEpilogue<ActivationType::Tanh>{bias});
+            break;
+        default:
+            throw std::runtime_error("Unknown activation function");
+    }
+}
+
+} // namespace
+
+const GemmBlocking& gemm_blocking() {
+    static const GemmBlocking blocking = compute_blocking();
+    return blocking;
+}
+
+void gemm(float* result, size_t ldc, const float* a, size_t a_rs, size_t a_cs,
+          const float* b, size_t b_rs, size_t b_cs, size_t m, size_t n, size_t k) {
+    gemm_driver<Float32Source>(result, ldc, a, {a_rs, a_cs}, b, {b_rs, b_cs}, m, n, k, NoEpilogue{});
+}
+
+void gemm_planned(float* result, size_t ldc, const float* a, size_t a_rs, size_t a_cs,
+                  const float* b, size_t b_rs, size_t b_cs, size_t m, size_t n, size_t k,
+                  const GemmPlan& plan) {
+    gemm_driver<Float32Source>(result, ldc, a, {a_rs, a_cs}, b, {b_rs, b_cs}, m, n, k, NoEpilogue{}, &plan);
+}
+
+void set_gemm_tuning(const GemmTuningTable* table) {
+    g_gemm_tuning.store(table, std::memory_order_release);
+}
+
+void gemm_bias_activation(float* result, size_t ldc, const float* a, size_t a_rs, size_t a_cs,
+                          const float* b, size_t b_rs, size_t b_cs, const float* bias,
+                          size_t m, size_t n, size_t k, ActivationType activation) {
+    gemm_bias_activation_from<Float32Source>(result, ldc, a, {a_rs, a_cs}, b, {b_rs, b_cs}, bias,
+                                             m, n, k, activation);
+}
+
+void gemm_half_bias_activation(float* result, size_t ldc, const float* a, size_t a_rs, size_t a_cs,
+                               const uint16_t* b, size_t b_rs, size_t b_cs, Precision precision,
+                               const float* bias, size_t m, size_t n, size_t k, ActivationType activation) {
+    switch (precision) {
+        case Precision::BFloat16:
+            gemm_bias_activation_from<BFloat16Source>(result, ldc, a, {a_rs, a_cs}, b, {b_rs, b_cs}, bias,
+                                                      m, n, k, activation);
+            break;
+        case Precision::Float16:
+            gemm_bias_activation_from<Float16Source>(result, ldc, a, {a_rs, a_cs}, b, {b_rs, b_cs}, bias,
+                                                     m, n, k, activation);
+            break;
+        default:
+            throw std::invalid_argument("Half-precision GEMM needs BFloat16 or Float16 weights");
+    }
+}
+
+} // namespace MLCPP_ISA
+} // namespace ml
@@ -0,0 +1,120 @@
+#pragma once
+#include "activations.hpp"
+#include "matrix_view.hpp"
+#include <cstddef>
+#include <vector>
+
+namespace ml {
+
+// Packed, register-blocked single-precision GEMM engine
+// Follows the classic Goto/BLIS decomposition: B is packed into KC x NC panels
+// that stay resident in L3, A into MC x KC panels that stay resident in L2,
+// and a MR x NR micro-kernel streams KC x NR slivers of B through L1
+// The pointer overloads take dense row-major matrices; the view overloads
+// accept any strided operands (see matrix_view.hpp)
+// The engine is compiled per instruction set and selected at runtime (see
+// cpu_dispatch.hpp); the register tile is MR x NR = 6 x 16 for AVX2 and
+// 6 x 32 for AVX-512
+
+// Cache block sizes used by the engine
+// mc: Rows of A packed per L2 block (multiple of MR)
+// kc: Depth of each packed panel (shared by A and B)
+// nc: Columns of B packed per L3 block (multiple of NR)
+struct GemmBlocking {
+    size_t mc;
+    size_t kc;
+    size_t nc;
+};
+
+// Returns the selected kernel's block sizes, derived from the host's L1/L2/L3
+// data cache sizes
+// Detected once on first use; falls back to conservative defaults when the
+// cache hierarchy cannot be queried
+const GemmBlocking& gemm_blocking();
+
+// Execution plan for one product: block sizes and the grid of macro-tiles C
+// is split into across the thread pool
+// The kernels round mc and nc to multiples of their register tile
+struct GemmPlan {
+    GemmBlocking blocking;
+    size_t m_parts;  // Row blocks of C run in parallel; 1 x 1 runs on the calling thread
+    size_t n_parts;  // Column blocks of C
+    size_t threads;  // Pool size the split was chosen for; other sizes keep the default split
+};
+
+// GemmTuningTable class: Tuned plans of one kernel variant by shape bucket
+// Every dimension maps to a power-of-two bucket, so the batch sizes 5 to 8
+// share a plan, as do widths 513 to 1024. Shapes without a plan use the
+// cache-derived blocking and the aspect-ratio thread split. Tables are
+// immutable once handed to the kernels, see gemm_tuning.hpp
+class GemmTuningTable {
+public:
+    struct Entry {
+        size_t m_bucket;
+        size_t n_bucket;
+        size_t k_bucket;
+        GemmPlan plan;
+    };
+
+    // Buckets per dimension; sizes above 2^(BUCKETS - 1) share the last
+    static constexpr size_t BUCKETS = 16;
+
+    // Bucket of a dimension: sizes in (2^(b-1), 2^b] map to b
+    static size_t bucket(size_t size);
+
+    // Plan for an m x n x k product, or nullptr if its bucket is untuned
+    const GemmPlan* find(size_t m, size_t n, size_t k) const;
+
+    // Add or replace the plan of entry's bucket
+    // Throws std::invalid_argument for a bucket out of range or an empty plan
+    void set(const Entry& entry);
+
+    const std::vector<Entry>& entries() const { return entries_; }
+
+private:
+    std::vector<Entry> entries_; // Sorted by (m, n, k) bucket
+};
+
+// Computes result = a * b
+// result: Output matrix (m x n), overwritten
+// a: First input matrix (m x k)
+// b: Second input matrix (k x n)
+// m, n, k: Matrix dimensions
+void gemm(float* result, const float* a, const float* b,
+          size_t m, size_t n, size_t k);
+
+// Computes result = op(a) * op(b), where op(x) is x or its transpose
+// Transposed operands are read in place by the packing routines; no
+// transposed copy is ever materialized
+// a: m x k matrix, or k x m matrix read as its transpose when trans_a is set
+// b: k x n matrix, or n x k matrix read as its transpose when trans_b is set
+// Used for backprop: dW = X^T * delta (trans_a) and dX = delta * W^T (trans_b)
+void gemm(float* result, const float* a, const float* b,
+          size_t m, size_t n, size_t k, bool trans_a, bool trans_b);
+
+// Computes result = activation(a * b + bias) with the bias add and activation
+// fused into the store of the final depth block, so no separate bias or
+// activation pass over result is needed
+// result: Output matrix (m x n), overwritten
+// a: First input matrix (m x k)
+// b: Second input matrix (k x n)
+// bias: Row vector of n biases added to every row
+// activation: Applied element-wise using the approximations in activations.hpp
+void gemm_bias_activation(float* result, const float* a, const float* b, const float* bias,
+                          size_t m, size_t n, size_t k, ActivationType activation);
+
+// Computes c = a * b on strided views without copying any operand
+// a and b may be sub-blocks or transposes of larger matrices; c must have a
+// unit row or column stride so its tiles can be stored directly
+// Throws std::invalid_argument if the shapes don't match or c is strided
+// in both dimensions
+void gemm(MatrixView c, ConstMatrixView a, ConstMatrixView b);
+
+// Computes c = activation(a * b + bias) on strided views
+// bias: Row vector of c.cols() biases added to every row
+// Throws std::invalid_argument if the shapes don't match or c's rows are
+// not contiguous
+void gemm_bias_activation(MatrixView c, ConstMatrixView a, ConstMatrixView b, const float* bias,
+                          ActivationType activation);
+
+} // namespace ml
@@ -0,0 +1,429 @@
+#include "gemm_tuning.hpp"
+#include "cpu_dispatch.hpp"
+#include "matrix.hpp"
+#include "neural.hpp"
+#include "thread_pool.hpp"
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+
+namespace ml {
+
+namespace {
+
+constexpr const char* CACHE_MAGIC = "mlcpp-gemm-tuning";
+constexpr int CACHE_VERSION = 1;
+
+// Time spent per candidate, at least MIN_RUNS runs of which the fastest counts
+constexpr double CANDIDATE_SECONDS = 0.01;
+constexpr int MIN_RUNS = 3;
+constexpr int MAX_RUNS = 100;
+
+// A candidate must beat the incumbent by this factor to replace it
+constexpr double IMPROVEMENT = 0.97;
+
+// Published tables of every kernel variant
+// Tables are never freed: kernels on other threads may still be reading one
+// that has been replaced, so replaced tables are retired, not deleted. The
+// registry itself is leaked for the same reason at exit
+struct TuningRegistry {
+    std::mutex mutex;
+    std::map<std::string, const GemmTuningTable*> current; // By kernel variant
+    std::vector<std::unique_ptr<GemmTuningTable>> tables;
+};
+
+TuningRegistry& registry() {
+    static TuningRegistry* instance = new TuningRegistry;
+    return *instance;
+}
+
+// Install table for isa; the registry must be locked
+// isa is taken by value: callers pass keys of reg.current, which erase() frees
+void publish(TuningRegistry& reg, std::string isa, std::unique_ptr<GemmTuningTable> table) {
+    const GemmTuningTable* published = table.get();
+    if (table) {
+        reg.tables.push_back(std::move(table));
+        reg.current[isa] = published;
+    } else {
+        reg.current.erase(isa);
+    }
+    kernel_table_for(isa).set_gemm_tuning(published);
+}
+
+std::tuple<size_t, size_t, size_t> bucket_key(const GemmTuningTable::Entry& entry) {
+    return {entry.m_bucket, entry.n_bucket, entry.k_bucket};
+}
+
+// CPU model from /proc/cpuinfo, so a cache on a shared home directory is
+// only used by the machines it was tuned on
+std::string cpu_model() {
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(cpuinfo, line)) {
+        if (line.compare(0, 10, "model name") == 0) {
+            size_t colon = line.find(':');
+            if (colon != std::string::npos) {
+                size_t begin = line.find_first_not_of(" \t", colon + 1);
+                return begin == std::string::npos ? "unknown" : line.substr(begin);
+            }
+        }
+    }
+    return "unknown";
+}
+
+double seconds_per_run(const KernelTable& kernels, Matrix& c, const Matrix& a, const Matrix& b,
+                       const GemmPlan& plan) {
+    size_t m = a.rows(), k = a.cols(), n = b.cols();
+    auto run = [&] {
+        kernels.gemm_planned(c.data(), n, a.data(), k, 1, b.data(), n, 1, m, n, k, plan);
+    };
+    run(); // Warm the caches and the pack buffers
+    double best = 0.0, total = 0.0;
+    for (int runs = 0; runs < MAX_RUNS && (runs < MIN_RUNS || total < CANDIDATE_SECONDS); ++runs) {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        best = runs == 0 ? seconds : std::min(best, seconds);
+        total += seconds;
+    }
+    return best;
+}
+
+// Candidates for one block size, ascending; values past the first that
+// covers the whole dimension behave alike and are dropped
+std::vector<size_t> block_candidates(std::initializer_list<size_t> values, size_t dimension) {
+    std::vector<size_t> candidates;
+    for (size_t value : values) {
+        if (value == 0) {
+            continue;
+        }
+        candidates.push_back(value);
+        if (value >= dimension) {
+            break;
+        }
+    }
+    return candidates;
+}
+
+} // namespace
+
+size_t GemmTuningTable::bucket(size_t size) {
+    size_t bucket = 0;
+    while (bucket + 1 < BUCKETS && (size_t{1} << bucket) < size) {
+        ++bucket;
+    }
+    return bucket;
+}
+
+const GemmPlan* GemmTuningTable::find(size_t m, size_t n, size_t k) const {
+    Entry key{bucket(m), bucket(n), bucket(k), {}};
+    auto it = std::lower_bound(entries_.begin(), entries_.end(), key, [](const Entry& a, const Entry& b) {
+        return bucket_key(a) < bucket_key(b);
+    });
+    return it != entries_.end() && bucket_key(*it) == bucket_key(key) ? &it->plan : nullptr;
+}
+
+void GemmTuningTable::set(const Entry& entry) {
+    if (entry.m_bucket >= BUCKETS || entry.n_bucket >= BUCKETS || entry.k_bucket >= BUCKETS) {
+        throw std::invalid_argument("GEMM tuning bucket out of range");
+    }
+    const GemmPlan& plan = entry.plan;
+    if (plan.blocking.mc == 0 || plan.blocking.kc == 0 || plan.blocking.nc == 0) {
+        throw std::invalid_argument("GEMM plan block sizes must be positive");
+    }
+    auto it = std::lower_bound(entries_.begin(), entries_.end(), entry, [](const Entry& a, const Entry& b) {
+        return bucket_key(a) < bucket_key(b);
+    });
+    if (it != entries_.end() && bucket_key(*it) == bucket_key(entry)) {
+        *it = entry;
+    } else {
+        entries_.insert(it, entry);
+    }
+}
+
+GemmTuneResult tune_gemm(size_t m, size_t n, size_t k) {
+    if (m == 0 || n == 0 || k == 0) {
+        throw std::invalid_argument("GEMM dimensions to tune must be positive");
+    }
+    const KernelTable& kernels = active_kernels();
+    Matrix a(m, k), b(k, n), c(m, n);
+    for (size_t i = 0; i < m * k; ++i) a.data()[i] = static_cast<float>(i % 17) * 0.0625f - 0.5f;
+    for (size_t i = 0; i < k * n; ++i) b.data()[i] = static_cast<float>(i % 13) * 0.0625f - 0.375f;
+
+    // The default plan: cache-derived blocking, and a thread count no pool
+    // has, so the kernels keep their own split
+    size_t threads = get_num_threads();
+    const GemmBlocking defaults = kernels.gemm_blocking();
+    GemmPlan best{defaults, 0, 0, 0};
+    double default_seconds = seconds_per_run(kernels, c, a, b, best);
+    double best_seconds = default_seconds;
+    auto consider = [&](const GemmPlan& candidate) {
+        double seconds = seconds_per_run(kernels, c, a, b, candidate);
+        if (seconds < best_seconds * IMPROVEMENT) {
+            best = candidate;
+            best_seconds = seconds;
+        }
+    };
+
+    // Serial, then every even split of the pool into m_parts x n_parts; a
+    // single-threaded pool has nothing to split
+    std::vector<std::pair<size_t, size_t>> splits;
+    for (size_t m_parts = 1; threads > 1 && m_parts <= threads; ++m_parts) {
+        if (m_parts == 1) {
+            splits.emplace_back(1, 1);
+        }
+        if (threads % m_parts == 0) {
+            splits.emplace_back(m_parts, threads / m_parts);
+        }
+    }
+    for (const auto& [m_parts, n_parts] : splits) {
+        consider({defaults, m_parts, n_parts, threads});
+    }
+
+    GemmPlan incumbent = best;
+    for (size_t kc : block_candidates({64, 128, 192, 256, 384, 512, 768}, k)) {
+        if (kc != incumbent.blocking.kc) {
+            GemmPlan candidate = incumbent;
+            candidate.blocking.kc = kc;
+            consider(candidate);
+        }
+    }
+    incumbent = best;
+    size_t mc = incumbent.blocking.mc;
+    for (size_t candidate_mc : block_candidates({mc / 8, mc / 4, mc / 2, mc * 2, mc * 4}, m)) {
+        GemmPlan candidate = incumbent;
+        candidate.blocking.mc = candidate_mc;
+        consider(candidate);
+    }
+    incumbent = best;
+    size_t nc = incumbent.blocking.nc;
+    for (size_t candidate_nc : block_candidates({nc / 16, nc / 4, nc / 2, nc * 2}, n)) {
+        GemmPlan candidate = incumbent;
+        candidate.blocking.nc = candidate_nc;
+        consider(candidate);
+    }
+
+    TuningRegistry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    auto it = reg.current.find(kernels.isa);
+    auto table = it != reg.current.end() ? std::make_unique<GemmTuningTable>(*it->second)
+                                         : std::make_unique<GemmTuningTable>();
+    table->set({GemmTuningTable::bucket(m), GemmTuningTable::bucket(n), GemmTuningTable::bucket(k), best});
+    publish(reg, kernels.isa, std::move(table));
+    return {best, default_seconds, best_seconds};
+}
+
+std::vector<GemmShape> network_gemm_shapes(const NeuralNetwork& network, const std::vector<size_t>& batch_sizes,
+                                           bool training) {
+    std::vector<GemmShape> shapes;
+    for (size_t batch : batch_sizes) {
+        for (const Layer& layer : network.get_layers()) {
+            size_t inputs = layer.input_size(), outputs = layer.output_size();
+            shapes.push_back({batch, outputs, inputs});
+            if (training) {
+                shapes.push_back({inputs, outputs, batch});
+                shapes.push_back({batch, inputs, outputs});
+            }
+        }
+    }
+    return shapes;
+}
+
+std::vector<std::pair<GemmShape, GemmTuneResult>> tune_network(const NeuralNetwork& network,
+                                                               const std::vector<size_t>& batch_sizes,
+                                                               bool training) {
+    std::vector<std::pair<GemmShape, GemmTuneResult>> results;
+    std::set<std::tuple<size_t, size_t, size_t>> tuned;
+    for (const GemmShape& shape : network_gemm_shapes(network, batch_sizes, training)) {
+        auto key = std::make_tuple(GemmTuningTable::bucket(shape.m), GemmTuningTable::bucket(shape.n),
+                                   GemmTuningTable::bucket(shape.k));
+        if (tuned.insert(key).second) {
+            results.emplace_back(shape, tune_gemm(shape.m, shape.n, shape.k));
+        }
+    }
+    return results;
+}
+
+const GemmPlan* find_gemm_plan(size_t m, size_t n, size_t k) {
+    const KernelTable& kernels = active_kernels();
+    TuningRegistry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    auto it = reg.current.find(kernels.isa);
+    return it != reg.current.end() ? it->second->find(m, n, k) : nullptr;
+}
+
+void clear_gemm_tuning() {
+    // The host cache loads on first use; loading it now keeps it from
+    // replacing this later
+    load_gemm_tuning_cache();
+    TuningRegistry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    while (!reg.current.empty()) {
+        publish(reg, reg.current.begin()->first, nullptr);
+    }
+}
+
+std::string gemm_tuning_cache_path() {
+    const char* configured = std::getenv("MLCPP_GEMM_TUNING");
+    if (configured && *configured) {
+        return std::strcmp(configured, "off") == 0 ? std::string() : std::string(configured);
+    }
+    std::string directory;
+    if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg) {
+        directory = xdg;
+    } else if (const char* home = std::getenv("HOME"); home && *home) {
+        directory = std::string(home) + "/.cache";
+    } else {
+        return std::string();
+    }
+    char host[256] = "localhost";
+    if (gethostname(host, sizeof(host) - 1) != 0) {
+        std::strcpy(host, "localhost");
+    }
+    return directory + "/mlcpp/gemm_tuning_" + host + ".txt";
+}
+
+void save_gemm_tuning(const std::string& path) {
+    if (path.empty()) {
+        throw std::invalid_argument("No GEMM tuning cache path");
+    }
+    load_gemm_tuning_cache();
+    std::filesystem::path parent = std::filesystem::path(path).parent_path();
+    std::error_code error;
+    if (!parent.empty()) {
+        std::filesystem::create_directories(parent, error);
+    }
+
+    // Written beside the target and renamed over it, so processes loading
+    // the cache concurrently never see a partial file
+    std::string temporary = path + ".tmp" + std::to_string(getpid());
+    {
+        std::ofstream file(temporary, std::ios::trunc);
+        if (!file) {
+            throw std::runtime_error("Cannot open GEMM tuning cache for writing: " + path);
+        }
+        file << CACHE_MAGIC << ' ' << CACHE_VERSION << '\n' << "cpu " << cpu_model() << '\n';
+        TuningRegistry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        for (const auto& [isa, table] : reg.current) {
+            for (const GemmTuningTable::Entry& entry : table->entries()) {
+                const GemmPlan& plan = entry.plan;
+                file << isa << ' ' << entry.m_bucket << ' ' << entry.n_bucket << ' ' << entry.k_bucket << ' '
+                     << plan.blocking.mc << ' ' << plan.blocking.kc << ' ' << plan.blocking.nc << ' '
+                     << plan.m_parts << ' ' << plan.n_parts << ' ' << plan.threads << '\n';
+            }
+        }
+        if (!file.flush()) {
+            std::remove(temporary.c_str());
+            throw std::runtime_error("Failed to write GEMM tuning cache: " + path);
+        }
+    }
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        throw std::runtime_error("Cannot replace GEMM tuning cache: " + path);
+    }
+}
+
+namespace {
+
+// load_gemm_tuning without the host cache load, which calls it
+size_t read_gemm_tuning(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("Cannot open GEMM tuning cache: " + path);
+    }
+    std::string magic, line;
+    int version = 0;
+    if (!(file >> magic >> version) || magic != CACHE_MAGIC || version != CACHE_VERSION) {
+        throw std::runtime_error("Not a GEMM tuning cache of this version: " + path);
+    }
+    std::getline(file, line);
+    if (!std::getline(file, line) || line.compare(0, 4, "cpu ") != 0) {
+        throw std::runtime_error("GEMM tuning cache " + path + " lacks its CPU model");
+    }
+    if (line.substr(4) != cpu_model()) {
+        throw std::runtime_error("GEMM tuning cache " + path + " was tuned on another CPU: " + line.substr(4));
+    }
+
+    std::map<std::string, std::unique_ptr<GemmTuningTable>> tables;
+    size_t loaded = 0;
+    for (size_t number = 3; std::getline(file, line); ++number) {
+        if (line.empty()) {
+            continue;
+        }
+        std::istringstream fields(line);
+        std::string isa;
+        GemmTuningTable::Entry entry{};
+        GemmPlan& plan = entry.plan;
+        std::string extra;
+        if (!(fields >> isa >> entry.m_bucket >> entry.n_bucket >> entry.k_bucket >> plan.blocking.mc >>
+              plan.blocking.kc >> plan.blocking.nc >> plan.m_parts >> plan.n_parts >> plan.threads) ||
+            (fields >> extra)) {
+            throw std::runtime_error("GEMM tuning cache " + path + ": malformed line " + std::to_string(number));
+        }
+        try {
+            kernel_table_for(isa);
+        } catch (const std::invalid_argument&) {
+            continue; // A variant this build does not have
+        }
+        auto& table = tables[isa];
+        if (!table) {
+            table = std::make_unique<GemmTuningTable>();
+        }
+        try {
+            table->set(entry);
+        } catch (const std::invalid_argument& e) {
+            throw std::runtime_error("GEMM tuning cache " + path + ": line " + std::to_string(number) + ": " +
+                                     e.what());
+        }
+        ++loaded;
+    }
+
+    TuningRegistry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    while (!reg.current.empty()) {
+        publish(reg, reg.current.begin()->first, nullptr);
+    }
+    for (auto& [isa, table] : tables) {
+        publish(reg, isa, std::move(table));
+    }
+    return loaded;
+}
+
+} // namespace
+
+size_t load_gemm_tuning(const std::string& path) {
+    load_gemm_tuning_cache();
+    return read_gemm_tuning(path);
+}
+
+void load_gemm_tuning_cache() {
+    static std::once_flag once;
+    std::call_once(once, [] {
+        std::string path = gemm_tuning_cache_path();
+        std::error_code error;
+        if (path.empty() || !std::filesystem::exists(path, error)) {
+            return;
+        }
+        try {
+            read_gemm_tuning(path);
+        } catch (const std::exception& e) {
+            std::cerr << "mlcpp: ignoring GEMM tuning cache: " << e.what() << std::endl;
+        }
+    });
+}
+
+} // namespace ml
@@ -0,0 +1,88 @@
+#pragma once
+#include "gemm.hpp"
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ml {
+
+class NeuralNetwork;
+
+// GEMM autotuning
+// The engine derives its block sizes from the cache hierarchy and splits C
+// across threads by its aspect ratio. That suits square products, but skinny
+// inference products (a few rows x 1024) and large training products each
+// have their own best blocking and split, and those move between CPU
+// generations. tune_gemm() times candidate plans for a shape on this host
+// and installs the fastest for the shape's bucket (see GemmTuningTable), so
+// every later product in that bucket uses it.
+// Plans persist in a per-host cache file that is loaded on the first kernel
+// call. Its path is $MLCPP_GEMM_TUNING when set (MLCPP_GEMM_TUNING=off
+// disables the cache), else gemm_tuning_<hostname>.txt under
+// $XDG_CACHE_HOME/mlcpp or ~/.cache/mlcpp. The file records the CPU model
+// and is ignored on any other CPU
+
+// One product: m x k times k x n
+struct GemmShape {
+    size_t m;
+    size_t n;
+    size_t k;
+};
+
+// Outcome of tune_gemm()
+struct GemmTuneResult {
+    GemmPlan plan;           // Fastest plan found, now installed
+    double default_seconds;  // Best time of the default plan
+    double tuned_seconds;    // Best time of plan
+};
+
+// Time candidate plans for an m x n x k product with the active kernels and
+// thread pool, and install the fastest for its bucket
+// Starting from the default plan, the thread split is tuned first, then kc,
+// mc and nc in turn; a candidate replaces the incumbent only when it is
+// clearly faster, so noise does not displace the defaults
+// Must not run while kernels are running on other threads
+// Throws std::invalid_argument for a zero dimension
+GemmTuneResult tune_gemm(size_t m, size_t n, size_t k);
+
+// Products a network runs for the given batch sizes: one forward product per
+// layer, and with training the dW = X^T * delta and dX = delta * W^T products
+std::vector<GemmShape> network_gemm_shapes(const NeuralNetwork& network, const std::vector<size_t>& batch_sizes,
+                                           bool training = false);
+
+// tune_gemm() the first shape of every bucket among network_gemm_shapes()
+// Returns: The shapes tuned, with their results in the same order
+std::vector<std::pair<GemmShape, GemmTuneResult>> tune_network(const NeuralNetwork& network,
+                                                               const std::vector<size_t>& batch_sizes,
+                                                               bool training = false);
+
+// Plan the active kernels use for a shape, or nullptr if its bucket is untuned
+const GemmPlan* find_gemm_plan(size_t m, size_t n, size_t k);
+
+// Drop the tuned plans of every kernel variant
+void clear_gemm_tuning();
+
+// Cache file of this host, or an empty string when the cache is disabled or
+// no cache directory is known
+std::string gemm_tuning_cache_path();
+
+// Write the plans of every kernel variant to path, creating its directory
+// Throws std::invalid_argument for an empty path, std::runtime_error when
+// the file cannot be written
+void save_gemm_tuning(const std::string& path);
+
+// Replace all tuned plans with those in the file at path
+// Plans for kernel variants this build lacks are skipped
+// Throws std::runtime_error when the file cannot be read, is malformed or
+// was tuned on a different CPU model
+// Returns: Number of plans loaded
+size_t load_gemm_tuning(const std::string& path);
+
+// Load the host's cache file once per process; the kernel dispatcher calls
+// this on first use, and so do clear/save/load_gemm_tuning, so plans they set
+// before any GEMM runs are not replaced by the cache later
+// A missing file is skipped, a bad one reported on stderr
+void load_gemm_tuning_cache();
+
+} // namespace ml
@@ -0,0 +1,65 @@
+#include "half.hpp"
+#include "aligned_allocator.hpp"
+#include <stdexcept>
+
+namespace ml {
+
+namespace {
+
+void check_half_precision(Precision precision) {
+    if (precision == Precision::Float32) {
+        throw std::invalid_argument("Half-precision conversion needs BFloat16 or Float16");
+    }
+}
+
+} // namespace
+
+void float_to_half(uint16_t* dst, const float* src, size_t count, Precision precision) {
+    check_half_precision(precision);
+    if (precision == Precision::BFloat16) {
+        for (size_t i = 0; i < count; ++i) {
+            dst[i] = float_to_bfloat16(src[i]);
+        }
+    } else {
+        for (size_t i = 0; i < count; ++i) {
+            dst[i] = float_to_float16(src[i]);
+        }
+    }
+}
+
+void half_to_float(float* dst, const uint16_t* src, size_t count, Precision precision) {
+    check_half_precision(precision);
+    if (precision == Precision::BFloat16) {
+        for (size_t i = 0; i < count; ++i) {
+            dst[i] = bfloat16_to_float(src[i]);
+        }
+    } else {
+        for (size_t i = 0; i < count; ++i) {
+            dst[i] = float16_to_float(src[i]);
+        }
+    }
+}
+
+HalfMatrix::HalfMatrix(const Matrix& source, Precision precision)
+    : rows_(source.rows()), cols_(source.cols()), precision_(precision) {
+    check_half_precision(precision);
+    size_t bytes = rows_ * cols_ * sizeof(uint16_t);
+    uint16_t* data = static_cast<uint16_t*>(pool_allocate(bytes));
+    data_ = std::shared_ptr<const uint16_t>(data, PoolDeleter{bytes});
+    float_to_half(data, source.data(), rows_ * cols_, precision);
+}
+
+HalfMatrix HalfMatrix::wrap(const uint16_t* data, size_t rows, size_t cols, Precision precision,
+                            std::shared_ptr<void> owner) {
+    check_half_precision(precision);
+    // Aliasing constructor: shares ownership with owner, points at data
+    return HalfMatrix(std::shared_ptr<const uint16_t>(std::move(owner), data), rows, cols, precision);
+}
+
+Matrix HalfMatrix::to_float() const {
+    Matrix result(rows_, cols_);
+    half_to_float(result.data(), data_.get(), rows_ * cols_, precision_);
+    return result;
+}
+
+} // namespace ml
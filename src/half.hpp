@@ -0,0 +1,162 @@
+#pragma once
+#include "activations.hpp"
+#include "isa.hpp"
+#include "matrix.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+namespace ml {
+
+// Storage formats for layer weights
+// Half-precision weights are widened to float as the GEMM packs them and
+// every product accumulates in float, so only storage precision is reduced
+enum class Precision {
+    Float32,  // IEEE single precision
+    BFloat16, // Upper 16 bits of a float: 8-bit exponent, 7-bit mantissa
+    Float16   // IEEE half precision: 5-bit exponent, 10-bit mantissa, max 65504
+};
+
+// Bytes per element of a format
+inline size_t precision_bytes(Precision precision) {
+    return precision == Precision::Float32 ? sizeof(float) : sizeof(uint16_t);
+}
+
+// Compiled per instruction-set variant, see isa.hpp
+namespace MLCPP_ISA {
+
+// Scalar conversions; narrowing rounds to nearest even
+// bfloat16 keeps the float range, so only NaNs need care (kept quiet). float16
+// overflows to infinity above 65504 and keeps subnormals down to 2^-24
+
+inline uint16_t float_to_bfloat16(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    if ((bits & 0x7fffffffu) > 0x7f800000u) {
+        return static_cast<uint16_t>((bits >> 16) | 0x40u);
+    }
+    bits += 0x7fffu + ((bits >> 16) & 1u);
+    return static_cast<uint16_t>(bits >> 16);
+}
+
+inline float bfloat16_to_float(uint16_t value) {
+    uint32_t bits = static_cast<uint32_t>(value) << 16;
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+inline uint16_t float_to_float16(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000u);
+    bits &= 0x7fffffffu;
+    if (bits >= 0x7f800000u) {
+        // Infinity stays infinity, NaN stays a quiet NaN
+        return sign | (bits > 0x7f800000u ? 0x7e00u : 0x7c00u);
+    }
+    if (bits >= 0x477ff000u) {
+        // 65520 and above round past the largest finite half
+        return sign | 0x7c00u;
+    }
+    if (bits < 0x38800000u) {
+        // Below 2^-14 the result is subnormal: a count of 2^-24 steps. The
+        // scaling is exact and the float-to-int conversion rounds to even;
+        // a count of 1024 is the encoding of the smallest normal
+        float magnitude;
+        std::memcpy(&magnitude, &bits, sizeof(magnitude));
+        float steps = magnitude * 16777216.0f;
+        uint32_t count = static_cast<uint32_t>(steps);
+        float rest = steps - static_cast<float>(count);
+        count += rest > 0.5f || (rest == 0.5f && (count & 1u));
+        return sign | static_cast<uint16_t>(count);
+    }
+    // Rebias the exponent from 127 to 15 and round off 13 mantissa bits; a
+    // mantissa carry correctly bumps the exponent
+    bits -= 0x38000000u;
+    bits += 0x0fffu + ((bits >> 13) & 1u);
+    return sign | static_cast<uint16_t>(bits >> 13);
+}
+
+inline float float16_to_float(uint16_t value) {
+    uint32_t sign = static_cast<uint32_t>(value & 0x8000u) << 16;
+    uint32_t exponent = (value >> 10) & 0x1fu;
+    uint32_t mantissa = value & 0x3ffu;
+    uint32_t bits;
+    if (exponent == 0x1fu) {
+        bits = sign | 0x7f800000u | (mantissa << 13);
+    } else if (exponent == 0) {
+        // Zero or subnormal: mantissa * 2^-24, exact in float
+        float magnitude = static_cast<float>(mantissa) * 5.9604644775390625e-8f;
+        return sign ? -magnitude : magnitude;
+    } else {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+} // namespace MLCPP_ISA
+
+using MLCPP_ISA::bfloat16_to_float;
+using MLCPP_ISA::float16_to_float;
+using MLCPP_ISA::float_to_bfloat16;
+using MLCPP_ISA::float_to_float16;
+
+// Convert count floats to a 16-bit format
+// Throws std::invalid_argument for Precision::Float32
+void float_to_half(uint16_t* dst, const float* src, size_t count, Precision precision);
+
+// Widen count 16-bit values to float
+// Throws std::invalid_argument for Precision::Float32
+void half_to_float(float* dst, const uint16_t* src, size_t count, Precision precision);
+
+// HalfMatrix class: Immutable row-major matrix of bfloat16 or float16 values
+// Used for weight storage only; arithmetic happens in float after widening.
+// Copies share the same storage
+class HalfMatrix {
+public:
+    // Round source to precision (BFloat16 or Float16)
+    // Throws std::invalid_argument for Precision::Float32
+    HalfMatrix(const Matrix& source, Precision precision);
+
+    // View existing 16-bit values without copying
+    // owner: Kept alive as long as any copy of the matrix exists
+    static HalfMatrix wrap(const uint16_t* data, size_t rows, size_t cols, Precision precision,
+                           std::shared_ptr<void> owner);
+
+    size_t rows() const { return rows_; }
+    size_t cols() const { return cols_; }
+    Precision precision() const { return precision_; }
+    const uint16_t* data() const { return data_.get(); }
+
+    // Bytes of element storage
+    size_t bytes() const { return rows_ * cols_ * sizeof(uint16_t); }
+
+    // Widen to a new float matrix
+    Matrix to_float() const;
+
+private:
+    HalfMatrix(std::shared_ptr<const uint16_t> data, size_t rows, size_t cols, Precision precision)
+        : data_(std::move(data)), rows_(rows), cols_(cols), precision_(precision) {}
+
+    std::shared_ptr<const uint16_t> data_;
+    size_t rows_;
+    size_t cols_;
+    Precision precision_;
+};
+
+// Computes c = activation(a * b + bias) with half-precision b
+// b is widened to float while the GEMM packs it into its cache panels (F16C
+// for float16 and a 16-bit shift for bfloat16 where available) and products
+// accumulate in float, so only the weight reads shrink
+// c: Output view (a.rows() x b.cols()) with contiguous rows, overwritten
+// a: Input view (m x b.rows())
+// bias: Row vector of b.cols() biases added to every row
+// Throws std::invalid_argument if the shapes don't match
+void gemm_bias_activation(MatrixView c, ConstMatrixView a, const HalfMatrix& b, const float* bias,
+                          ActivationType activation);
+
+} // namespace ml
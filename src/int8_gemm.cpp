@@ -0,0 +1,265 @@
+#include "cpu_dispatch.hpp"
+#include "int8_gemm.hpp"
+#include "thread_pool.hpp"
+#include <immintrin.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace ml {
+namespace MLCPP_ISA {
+
+namespace {
+
+// Largest quantized activation value of this variant
+// vpdpbusd accumulates in 32 bits, so VNNI targets use the full 8-bit range.
+// vpmaddubsw adds pairs of u8 * s8 products into saturating 16-bit lanes, so
+// other targets quantize activations to 7 bits: 2 * 127 * 127 < 32767
+#if defined(__AVX512VNNI__) && defined(__AVX512BW__)
+constexpr int32_t ACTIVATION_MAX = 255;
+#else
+constexpr int32_t ACTIVATION_MAX = 127;
+#endif
+
+// Bytes of one depth group (4 values) across a packed column block
+constexpr size_t GROUP_BYTES = 4 * INT8_GEMM_NR;
+
+#if defined(__AVX2__)
+// The four activations of one depth group, broadcast as a single int32
+int32_t load_group(const uint8_t* ptr) {
+    int32_t value;
+    std::memcpy(&value, ptr, sizeof(value));
+    return value;
+}
+#endif
+
+// Accumulate an INT8_GEMM_MR x INT8_GEMM_NR tile over groups depth groups
+// rows[r] points at the quantized activations of tile row r
+// panel: One packed column block of the weights
+#if defined(__AVX512VNNI__) && defined(__AVX512BW__)
+
+void accumulate_tile(int32_t acc[INT8_GEMM_MR][INT8_GEMM_NR],
+                     const uint8_t* const rows[INT8_GEMM_MR], const int8_t* panel, size_t groups) {
+    __m512i c0 = _mm512_setzero_si512();
+    __m512i c1 = _mm512_setzero_si512();
+    __m512i c2 = _mm512_setzero_si512();
+    __m512i c3 = _mm512_setzero_si512();
+    for (size_t g = 0; g < groups; ++g) {
+        __m512i b = _mm512_load_si512(panel + g * GROUP_BYTES);
+        c0 = _mm512_dpbusd_epi32(c0, _mm512_set1_epi32(load_group(rows[0] + 4 * g)), b);
+        c1 = _mm512_dpbusd_epi32(c1, _mm512_set1_epi32(load_group(rows[1] + 4 * g)), b);
+        c2 = _mm512_dpbusd_epi32(c2, _mm512_set1_epi32(load_group(rows[2] + 4 * g)), b);
+        c3 = _mm512_dpbusd_epi32(c3, _mm512_set1_epi32(load_group(rows[3] + 4 * g)), b);
+    }
+    _mm512_storeu_si512(acc[0], c0);
+    _mm512_storeu_si512(acc[1], c1);
+    _mm512_storeu_si512(acc[2], c2);
+    _mm512_storeu_si512(acc[3], c3);
+}
+
+#elif defined(__AVX2__)
+
+void accumulate_tile(int32_t acc[INT8_GEMM_MR][INT8_GEMM_NR],
+                     const uint8_t* const rows[INT8_GEMM_MR], const int8_t* panel, size_t groups) {
+    // vpmaddubsw forms 16-bit sums of adjacent u8 * s8 products, and
+    // vpmaddwd against ones widens the two pairs of a group into one int32
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i c[INT8_GEMM_MR][2];
+    for (size_t r = 0; r < INT8_GEMM_MR; ++r) {
+        c[r][0] = _mm256_setzero_si256();
+        c[r][1] = _mm256_setzero_si256();
+    }
+    for (size_t g = 0; g < groups; ++g) {
+        __m256i b0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(panel + g * GROUP_BYTES));
+        __m256i b1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(panel + g * GROUP_BYTES + 32));
+        for (size_t r = 0; r < INT8_GEMM_MR; ++r) {
+            __m256i a = _mm256_set1_epi32(load_group(rows[r] + 4 * g));
+            c[r][0] = _mm256_add_epi32(c[r][0], _mm256_madd_epi16(_mm256_maddubs_epi16(a, b0), ones));
+            c[r][1] = _mm256_add_epi32(c[r][1], _mm256_madd_epi16(_mm256_maddubs_epi16(a, b1), ones));
+        }
+    }
+    for (size_t r = 0; r < INT8_GEMM_MR; ++r) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc[r]), c[r][0]);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc[r] + 8), c[r][1]);
+    }
+}
+
+#else
+
+// Portable kernel over the same packed layout
+void accumulate_tile(int32_t acc[INT8_GEMM_MR][INT8_GEMM_NR],
+                     const uint8_t* const rows[INT8_GEMM_MR], const int8_t* panel, size_t groups) {
+    for (size_t r = 0; r < INT8_GEMM_MR; ++r) {
+        for (size_t j = 0; j < INT8_GEMM_NR; ++j) {
+            acc[r][j] = 0;
+        }
+    }
+    for (size_t g = 0; g < groups; ++g) {
+        const int8_t* b = panel + g * GROUP_BYTES;
+        for (size_t r = 0; r < INT8_GEMM_MR; ++r) {
+            const uint8_t* a = rows[r] + 4 * g;
+            for (size_t j = 0; j < INT8_GEMM_NR; ++j) {
+                acc[r][j] += a[0] * b[4 * j] + a[1] * b[4 * j + 1] +
+                             a[2] * b[4 * j + 2] + a[3] * b[4 * j + 3];
+            }
+        }
+    }
+}
+
+#endif
+
+// Operands shared by every tile of one int8 GEMM
+struct Int8GemmArgs {
+    float* result;
+    const uint8_t* qa;
+    const float* a_scales;
+    const int32_t* a_zero_points;
+    const int8_t* packed_b;
+    const int32_t* b_column_sums;
+    const float* b_scales;
+    const float* bias;
+    size_t m, n, k;
+};
+
+// Compute the tile at row block ib and column block jb, then dequantize,
+// add the bias and apply the activation while storing it
+template <ActivationType Act>
+void compute_tile(const Int8GemmArgs& args, size_t ib, size_t jb) {
+    size_t kp = int8_padded_depth(args.k);
+    size_t i0 = ib * INT8_GEMM_MR;
+    size_t j0 = jb * INT8_GEMM_NR;
+    size_t rows = std::min(INT8_GEMM_MR, args.m - i0);
+    size_t cols = std::min(INT8_GEMM_NR, args.n - j0);
+
+    // Edge tiles repeat their last row rather than reading past the input
+    const uint8_t* row_ptrs[INT8_GEMM_MR];
+    for (size_t r = 0; r < INT8_GEMM_MR; ++r) {
+        row_ptrs[r] = args.qa + (i0 + std::min(r, rows - 1)) * kp;
+    }
+    alignas(64) int32_t acc[INT8_GEMM_MR][INT8_GEMM_NR];
+    accumulate_tile(acc, row_ptrs, args.packed_b + jb * kp * INT8_GEMM_NR, kp / 4);
+
+    const int32_t* sums = args.b_column_sums + j0;
+    const float* scales = args.b_scales + j0;
+    const float* bias = args.bias + j0;
+    for (size_t r = 0; r < rows; ++r) {
+        float* out = args.result + (i0 + r) * args.n + j0;
+        float a_scale = args.a_scales[i0 + r];
+        int32_t zero_point = args.a_zero_points[i0 + r];
+        size_t j = 0;
+#if defined(__AVX2__) && defined(__FMA__)
+        for (; j + 8 <= cols; j += 8) {
+            __m256i corrected = _mm256_sub_epi32(
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc[r] + j)),
+                _mm256_mullo_epi32(_mm256_set1_epi32(zero_point),
+                                   _mm256_loadu_si256(reinterpret_cast<const __m256i*>(sums + j))));
+            __m256 scale = _mm256_mul_ps(_mm256_set1_ps(a_scale), _mm256_loadu_ps(scales + j));
+            __m256 value = _mm256_fmadd_ps(_mm256_cvtepi32_ps(corrected), scale, _mm256_loadu_ps(bias + j));
+            _mm256_storeu_ps(out + j, Activation<Act>::apply(value));
+        }
+#endif
+        for (; j < cols; ++j) {
+            float value = static_cast<float>(acc[r][j] - zero_point * sums[j]) * (a_scale * scales[j]) + bias[j];
+            out[j] = Activation<Act>::apply(value);
+        }
+    }
+}
+
+template <ActivationType Act>
+void int8_gemm_driver(const Int8GemmArgs& args) {
+    size_t row_blocks = (args.m + INT8_GEMM_MR - 1) / INT8_GEMM_MR;
+    size_t col_blocks = (args.n + INT8_GEMM_NR - 1) / INT8_GEMM_NR;
+    auto run = [&](size_t begin, size_t end) {
+        // Consecutive tiles walk along a row block, reusing its activations
+        for (size_t tile = begin; tile < end; ++tile) {
+            compute_tile<Act>(args, tile / col_blocks, tile % col_blocks);
+        }
+    };
+    size_t tiles = row_blocks * col_blocks;
+    if (args.m * args.n * args.k < PARALLEL_GEMM_MIN_FLOPS) {
+        run(0, tiles);
+    } else {
+        ThreadPool::instance().parallel_range(tiles, 1, run);
+    }
+}
+
+} // namespace
+
+int32_t int8_activation_max() {
+    return ACTIVATION_MAX;
+}
+
+size_t int8_packed_size(size_t k, size_t n) {
+    size_t col_blocks = (n + INT8_GEMM_NR - 1) / INT8_GEMM_NR;
+    return col_blocks * int8_padded_depth(k) * INT8_GEMM_NR;
+}
+
+void pack_int8_weights(int8_t* packed, const int8_t* b, size_t k, size_t n) {
+    size_t kp = int8_padded_depth(k);
+    for (size_t j0 = 0; j0 < n; j0 += INT8_GEMM_NR) {
+        for (size_t p0 = 0; p0 < kp; p0 += 4) {
+            for (size_t j = 0; j < INT8_GEMM_NR; ++j) {
+                for (size_t t = 0; t < 4; ++t) {
+                    size_t p = p0 + t;
+                    size_t col = j0 + j;
+                    *packed++ = (p < k && col < n) ? b[p * n + col] : int8_t(0);
+                }
+            }
+        }
+    }
+}
+
+void quantize_rows(uint8_t* qa, float* scales, int32_t* zero_points,
+                   const float* a, size_t m, size_t k) {
+    size_t kp = int8_padded_depth(k);
+    for (size_t i = 0; i < m; ++i) {
+        const float* row = a + i * k;
+        float lo = 0.0f;
+        float hi = 0.0f;
+        for (size_t p = 0; p < k; ++p) {
+            lo = std::min(lo, row[p]);
+            hi = std::max(hi, row[p]);
+        }
+        float scale = (hi - lo) / static_cast<float>(ACTIVATION_MAX);
+        if (scale == 0.0f) {
+            scale = 1.0f;
+        }
+        int32_t zero_point = static_cast<int32_t>(std::lrint(-lo / scale));
+        zero_point = std::clamp<int32_t>(zero_point, 0, ACTIVATION_MAX);
+
+        float inverse = 1.0f / scale;
+        uint8_t* out = qa + i * kp;
+        for (size_t p = 0; p < k; ++p) {
+            int32_t q = static_cast<int32_t>(std::lrint(row[p] * inverse)) + zero_point;
+            out[p] = static_cast<uint8_t>(std::clamp<int32_t>(q, 0, ACTIVATION_MAX));
+        }
+        std::fill(out + k, out + kp, uint8_t(0));
+        scales[i] = scale;
+        zero_points[i] = zero_point;
+    }
+}
+
+void int8_gemm_bias_activation(float* result,
+                               const uint8_t* qa, const float* a_scales, const int32_t* a_zero_points,
+                               const int8_t* packed_b, const int32_t* b_column_sums, const float* b_scales,
+                               const float* bias, size_t m, size_t n, size_t k,
+                               ActivationType activation) {
+    Int8GemmArgs args{result, qa, a_scales, a_zero_points, packed_b, b_column_sums, b_scales, bias, m, n, k};
+    switch (activation) {
+        case ActivationType::ReLU:
+            int8_gemm_driver<ActivationType::ReLU>(args);
+            break;
+        case ActivationType::Sigmoid:
+            int8_gemm_driver<ActivationType::Sigmoid>(args);
+            break;
+        case ActivationType::Tanh:
+            int8_gemm_driver<ActivationType::Tanh>(args);
+            break;
+        default:
+            throw std::runtime_error("Unknown activation function");
+    }
+}
+
+} // namespace MLCPP_ISA
+} // namespace ml
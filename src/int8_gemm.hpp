@@ -0,0 +1,66 @@
+#pragma once
+#include "activations.hpp"
+#include <cstddef>
+#include <cstdint>
+
+namespace ml {
+
+// Integer GEMM engine for quantized inference
+// Activations are quantized per row to unsigned 8-bit with an affine zero
+// point; weights are signed 8-bit, symmetric per output channel, and packed
+// once into blocks of INT8_GEMM_NR columns in which every 32-bit lane holds
+// four consecutive depth values of one column. That is the operand layout of
+// both AVX-512 VNNI vpdpbusd and the AVX2 vpmaddubsw + vpmaddwd sequence
+
+// Columns per packed weight block
+constexpr size_t INT8_GEMM_NR = 16;
+
+// Rows of the activation matrix computed per micro-kernel call
+constexpr size_t INT8_GEMM_MR = 4;
+
+// Largest quantized activation value of the selected kernel variant
+// vpdpbusd accumulates in 32 bits, so on VNNI hosts the avx512 variant uses
+// the full 8-bit range. vpmaddubsw adds pairs of u8 * s8 products into saturating 16-bit
+// lanes, so the other variants quantize activations to 7 bits:
+// 2 * 127 * 127 < 32767
+int32_t int8_activation_max();
+
+// Largest magnitude of a quantized weight (symmetric, so -128 is unused)
+constexpr int32_t INT8_WEIGHT_MAX = 127;
+
+// Depth rounded up to the 4-value groups consumed per instruction
+inline size_t int8_padded_depth(size_t k) { return (k + 3) / 4 * 4; }
+
+// Bytes needed by pack_int8_weights for a k x n weight matrix
+size_t int8_packed_size(size_t k, size_t n);
+
+// Pack a row-major k x n int8 matrix into the kernel layout
+// Missing depth values and columns are zero-padded
+// packed: int8_packed_size(k, n) bytes, 64-byte aligned
+void pack_int8_weights(int8_t* packed, const int8_t* b, size_t k, size_t n);
+
+// Quantize each row of a float matrix to [0, int8_activation_max()]
+// x = scale * (q - zero_point), with the row's range widened to include 0
+// so that zero is represented exactly
+// qa: m x int8_padded_depth(k) bytes; padding bytes are set to zero
+// scales, zero_points: m entries each
+// a: Row-major m x k input
+void quantize_rows(uint8_t* qa, float* scales, int32_t* zero_points,
+                   const float* a, size_t m, size_t k);
+
+// Computes result = activation(dequantize(qa * b) + bias)
+// Each int32 accumulator is corrected for the row's zero point with the
+// weight column sums, then scaled by a_scales[row] * b_scales[col]
+// result: Output matrix (m x n), overwritten
+// qa, a_scales, a_zero_points: Activations from quantize_rows
+// packed_b: Weights from pack_int8_weights
+// b_column_sums: Sum of each column of the unpacked int8 weights
+// b_scales: Per-column weight scales
+// bias: Row vector of n biases
+void int8_gemm_bias_activation(float* result,
+                               const uint8_t* qa, const float* a_scales, const int32_t* a_zero_points,
+                               const int8_t* packed_b, const int32_t* b_column_sums, const float* b_scales,
+                               const float* bias, size_t m, size_t n, size_t k,
+                               ActivationType activation);
+
+} // namespace ml
@@ -0,0 +1,23 @@
+#pragma once
+
+// Instruction-set variant being compiled
+// The kernel sources (gemm.cpp, optimizations.cpp, int8_gemm.cpp, spmm.cpp and
+// kernel_table.cpp) are built once per variant with -DMLCPP_ISA=<name> and the
+// matching -m flags, see CMakeLists.txt. Everything they define, including the
+// inline helpers of activations.hpp, epilogue.hpp, float_vec.hpp and half.hpp, lives in
+// namespace ml::MLCPP_ISA so the copies never merge at link time;
+// cpu_dispatch.cpp selects one at load
+// Translation units built without a variant see the name "generic", with a
+// suffix for the vector flags they are compiled with. The inline helpers
+// differ with those flags, so e.g. an application built with -march=native
+// linked against library sources built for the baseline gets two sets of
+// symbols instead of one picked at random. The conditions match float_vec.hpp
+#ifndef MLCPP_ISA
+#if defined(__AVX512F__) && defined(__AVX512DQ__)
+#define MLCPP_ISA generic_avx512
+#elif defined(__AVX2__) && defined(__FMA__)
+#define MLCPP_ISA generic_avx2
+#else
+#define MLCPP_ISA generic
+#endif
+#endif
@@ -0,0 +1,37 @@
+#include "cpu_dispatch.hpp"
+
+namespace ml {
+namespace MLCPP_ISA {
+
+#define MLCPP_STRINGIFY_NAME(name) #name
+#define MLCPP_STRINGIFY(name) MLCPP_STRINGIFY_NAME(name)
+
+const KernelTable& kernel_table() {
+    static const KernelTable table = {
+        MLCPP_STRINGIFY(MLCPP_ISA),
+        &gemm_blocking,
+        &gemm,
+        &gemm_planned,
+        &set_gemm_tuning,
+        &gemm_bias_activation,
+        &gemm_half_bias_activation,
+        &simd_add,
+        &simd_subtract,
+        &activation_backward,
+        &column_sum,
+        &sgd_update,
+        &momentum_update,
+        &adam_update,
+        &int8_activation_max,
+        &int8_packed_size,
+        &pack_int8_weights,
+        &quantize_rows,
+        &int8_gemm_bias_activation,
+        &spmm,
+        &spmm_bias_activation,
+    };
+    return table;
+}
+
+} // namespace MLCPP_ISA
+} // namespace ml
@@ -1,6 +1,7 @@
 #include "matrix.hpp"
 #include "optimizations.hpp"
 #include <algorithm>
+#include <cstdint>
 
 namespace ml {
 
@@ -9,31 +10,91 @@ Matrix::Matrix(size_t rows, size_t cols)
     if (rows == 0 || cols == 0) {
         throw std::invalid_argument("Matrix dimensions must be positive");
     }
-    size_t size = get_aligned_size();
-    data_ = std::make_unique<float[]>(size);
+    allocate();
     std::fill_n(data_.get(), rows_ * cols_, 0.0f);
 }
 
+Matrix::Matrix(size_t rows, size_t cols, Uninitialized)
+    : rows_(rows), cols_(cols) {
+    if (rows == 0 || cols == 0) {
+        throw std::invalid_argument("Matrix dimensions must be positive");
+    }
+    allocate();
+}
+
 Matrix::Matrix(const Matrix& other) 
     : rows_(other.rows_), cols_(other.cols_) {
-    size_t size = get_aligned_size();
-    data_ = std::make_unique<float[]>(size);
+    allocate();
     std::memcpy(data_.get(), other.data_.get(), rows_ * cols_ * sizeof(float));
 }
 
+Matrix::Matrix(ConstMatrixView view)
+    : Matrix(view.rows(), view.cols(), Uninitialized{}) {
+    if (view.is_contiguous()) {
+        std::memcpy(data_.get(), view.data(), rows_ * cols_ * sizeof(float));
+        return;
+    }
+    for (size_t i = 0; i < rows_; ++i) {
+        float* dst = data_.get() + i * cols_;
+        const float* src = view.data() + i * view.row_stride();
+        if (view.unit_col_stride()) {
+            std::memcpy(dst, src, cols_ * sizeof(float));
+        } else {
+            for (size_t j = 0; j < cols_; ++j) {
+                dst[j] = src[j * view.col_stride()];
+            }
+        }
+    }
+}
+
 Matrix& Matrix::operator=(const Matrix& other) {
     if (this != &other) {
-        if (rows_ != other.rows_ || cols_ != other.cols_) {
-            rows_ = other.rows_;
-            cols_ = other.cols_;
-            size_t size = get_aligned_size();
-            data_ = std::make_unique<float[]>(size);
+        size_t old_size = get_aligned_size();
+        bool owned = owns_data();
+        rows_ = other.rows_;
+        cols_ = other.cols_;
+        // Keep the existing buffer when it is pooled and the padded size is
+        // unchanged; wrapped memory is detached rather than written through
+        if (!owned || get_aligned_size() != old_size) {
+            allocate();
         }
         std::memcpy(data_.get(), other.data_.get(), rows_ * cols_ * sizeof(float));
     }
     return *this;
 }
 
+Matrix Matrix::wrap(float* data, size_t rows, size_t cols, std::shared_ptr<void> owner) {
+    if (rows == 0 || cols == 0) {
+        throw std::invalid_argument("Matrix dimensions must be positive");
+    }
+    if (!data || reinterpret_cast<std::uintptr_t>(data) % alignof(float) != 0) {
+        throw std::invalid_argument("Wrapped matrix data must be non-null and float-aligned");
+    }
+    Matrix result;
+    result.rows_ = rows;
+    result.cols_ = cols;
+    result.data_ = std::unique_ptr<float[], MatrixDeleter>(
+        data, MatrixDeleter{0, false, std::move(owner)});
+    return result;
+}
+
+Matrix::Matrix(Matrix&& other) noexcept
+    : rows_(other.rows_), cols_(other.cols_), data_(std::move(other.data_)) {
+    other.rows_ = 0;
+    other.cols_ = 0;
+}
+
+Matrix& Matrix::operator=(Matrix&& other) noexcept {
+    if (this != &other) {
+        // The old buffer goes back to other and is released (and pooled)
+        // when other is destroyed
+        std::swap(rows_, other.rows_);
+        std::swap(cols_, other.cols_);
+        std::swap(data_, other.data_);
+    }
+    return *this;
+}
+
 Matrix::~Matrix() = default;
 
 float& Matrix::at(size_t row, size_t col) {
@@ -54,27 +115,31 @@ void Matrix::fill(float value) {
     std::fill_n(data_.get(), rows_ * cols_, value);
 }
 
-Matrix Matrix::operator+(const Matrix& other) {
+Matrix& Matrix::operator+=(const Matrix& other) {
+    add_optimized(other);
+    return *this;
+}
+
+Matrix& Matrix::operator-=(const Matrix& other) {
+    subtract_optimized(other);
+    return *this;
+}
+
+void Matrix::add_optimized(const Matrix& other) {
     validate_dimensions(other);
-    Matrix result(rows_, cols_);
-    result.add_optimized(other);
-    return result;
+    simd_add(data(), other.data(), rows_ * cols_);
 }
 
-Matrix Matrix::operator-(const Matrix& other) {
+void Matrix::subtract_optimized(const Matrix& other) {
     validate_dimensions(other);
-    Matrix result(rows_, cols_);
-    result.subtract_optimized(other);
-    return result;
+    simd_subtract(data(), other.data(), rows_ * cols_);
 }
 
-Matrix Matrix::operator*(const Matrix& other) {
-    if (cols_ != other.rows_) {
-        throw std::invalid_argument("Invalid matrix dimensions for multiplication");
-    }
-    Matrix result(rows_, other.cols_);
-    result.multiply_optimized(other);
-    return result;
+void Matrix::multiply_optimized(const Matrix& other) {
+    // In-place product: this = this * other, reshaping to rows x other.cols
+    // The product reads this matrix, so it lands in fresh storage that is
+    // then moved into place
+    *this = *this * other;
 }
 
 void Matrix::validate_dimensions(const Matrix& other) const {
@@ -84,8 +149,17 @@ void Matrix::validate_dimensions(const Matrix& other) const {
 }
 
 size_t Matrix::get_aligned_size() const {
-    // Align to 32-byte boundary for AVX
-    return ((rows_ * cols_ * sizeof(float) + 31) / 32) * 32 / sizeof(float);
+    // Pad to a whole number of cache lines so neighbouring matrices never
+    // share a line
+    constexpr size_t line = MEMORY_ALIGNMENT;
+    return ((rows_ * cols_ * sizeof(float) + line - 1) / line) * line / sizeof(float);
+}
+
+void Matrix::allocate() {
+    size_t bytes = get_aligned_size() * sizeof(float);
+    data_.reset();
+    data_ = std::unique_ptr<float[], MatrixDeleter>(
+        static_cast<float*>(pool_allocate(bytes)), MatrixDeleter{bytes, true, nullptr});
 }
 
 } // namespace ml
@@ -4,36 +4,109 @@
 #include <memory>
 #include <stdexcept>
 #include <cstring>
+#include <type_traits>
+#include "aligned_allocator.hpp"
+#include "matrix_view.hpp"
 
 namespace ml {
 
+// Releases Matrix storage
+// Pooled blocks go back to the pool allocator; wrapped external buffers only
+// drop their keep-alive reference (if any) and are never freed here
+struct MatrixDeleter {
+    size_t bytes = 0;            // Size passed to pool_allocate
+    bool pooled = true;          // False for wrapped external memory
+    std::shared_ptr<void> owner; // Keeps wrapped memory alive
+
+    void operator()(float* ptr) const {
+        if (pooled) {
+            pool_deallocate(ptr, bytes);
+        }
+    }
+};
+
+namespace detail {
+// True for the lazy expression node types defined in matrix_expr.hpp
+template <typename T>
+struct is_expression_node : std::false_type {};
+} // namespace detail
+
 // Matrix class: Core implementation of matrix operations optimized for SIMD/AVX2
-// All memory is aligned to 32-byte boundaries for optimal AVX operations
+// All memory is aligned to 64-byte (cache line) boundaries, which satisfies the
+// 32-byte requirement of aligned AVX loads/stores
+// Storage comes from the pooled allocator, so short-lived temporaries reuse
+// blocks freed earlier on the same thread instead of hitting malloc
 class Matrix {
 public:
     // Creates a new matrix with specified dimensions
-    // Memory is allocated with 32-byte alignment for AVX2 SIMD operations
+    // Memory is allocated with 64-byte alignment for AVX2 SIMD operations
     // rows: Number of matrix rows
     // cols: Number of matrix columns
     Matrix(size_t rows, size_t cols);
+
+    // Tag for constructing a matrix whose elements are left unset
+    // Only for callers that overwrite every element right away (e.g. GEMM output)
+    struct Uninitialized {};
+    Matrix(size_t rows, size_t cols, Uninitialized);
     
     // Deep copy constructor - creates exact duplicate of source matrix
-    // Maintains 32-byte memory alignment of the original
+    // Maintains 64-byte memory alignment of the original
     // other: Source matrix to copy from
     Matrix(const Matrix& other);
     
+    // Wrap existing memory as a matrix without copying (non-owning view)
+    // data: rows * cols contiguous row-major floats; at least float-aligned
+    // owner: Kept alive for as long as the matrix references data; may be
+    //        null when the caller guarantees the memory outlives the matrix
+    // Element writes go straight to data. Copying the matrix produces an
+    // owning deep copy, and assignment to a wrapped matrix detaches it into
+    // pooled storage instead of writing through
+    static Matrix wrap(float* data, size_t rows, size_t cols,
+                       std::shared_ptr<void> owner = nullptr);
+
+    // Whether the matrix owns pooled storage (false for wrapped memory)
+    bool owns_data() const { return data_.get_deleter().pooled; }
+
+    // Deep copy of a possibly strided view into new dense storage
+    // Throws std::invalid_argument for an empty view
+    explicit Matrix(ConstMatrixView view);
+
+    // Strided views of this matrix's storage (see matrix_view.hpp)
+    // Valid until the matrix is destroyed, moved from or reassigned
+    MatrixView view() { return MatrixView(data(), rows_, cols_); }
+    ConstMatrixView view() const { return ConstMatrixView(data(), rows_, cols_); }
+
+    // Move constructor - takes over the buffer of other without copying
+    // other is left as an empty 0 x 0 matrix that may only be assigned or destroyed
+    Matrix(Matrix&& other) noexcept;
+
     // Assignment operator - performs deep copy while keeping alignment
     // Returns reference to allow chained assignments (a = b = c)
     Matrix& operator=(const Matrix& other);
+
+    // Move assignment - swaps buffers instead of copying elements
+    Matrix& operator=(Matrix&& other) noexcept;
+
+    // Evaluate a lazy matrix expression (see matrix_expr.hpp) into new storage
+    // The whole expression is computed in a single pass over the destination
+    template <typename Expr,
+              typename = std::enable_if_t<detail::is_expression_node<Expr>::value>>
+    Matrix(const Expr& expr);
+
+    // Evaluate a lazy matrix expression into this matrix
+    // Reuses the existing buffer when it is pooled, the shape matches and the
+    // expression does not feed this matrix into a product
+    template <typename Expr,
+              typename = std::enable_if_t<detail::is_expression_node<Expr>::value>>
+    Matrix& operator=(const Expr& expr);
     
     // Cleanup memory - automatically handles aligned deallocation
     ~Matrix();
 
-    // Mathematical Operations - all return new matrices
-    // const qualifier ensures these don't modify the original matrices
-    Matrix operator+(const Matrix& other) const; // Element-wise matrix addition
-    Matrix operator-(const Matrix& other) const; // Element-wise matrix subtraction
-    Matrix operator*(const Matrix& other) const; // Matrix multiplication
+    // Mathematical Operations: a + b, a - b and a * b are free operators
+    // (matrix_expr.hpp) that build lazy expressions; nothing is computed until
+    // the expression is assigned to a Matrix, so a * b + c - d runs one GEMM
+    // into the destination followed by one fused element-wise pass
 
     // In-place operations - modify the current matrix
     // Returns reference to allow operation chaining (a += b += c)
@@ -63,13 +136,19 @@ public:
     void multiply_optimized(const Matrix& other); // AVX2 vectorized multiplication
 
 private:
+    // Empty 0 x 0 matrix, the state of a moved-from matrix
+    Matrix() : rows_(0), cols_(0) {}
+
     size_t rows_;    // Number of matrix rows
     size_t cols_;    // Number of matrix columns
-    std::unique_ptr<float[]> data_; // Aligned memory buffer for matrix elements
+    std::unique_ptr<float[], MatrixDeleter> data_; // Aligned memory buffer for matrix elements
     
     // Internal helper methods
     void validate_dimensions(const Matrix& other) const; // Check matrix compatibility
     size_t get_aligned_size() const; // Calculate size with padding for AVX2
+    void allocate(); // Acquire pooled storage for get_aligned_size() elements
 };
 
 } // namespace ml
+
+#include "matrix_expr.hpp"
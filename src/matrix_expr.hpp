@@ -0,0 +1,246 @@
+#pragma once
+// Lazy matrix expressions - included at the end of matrix.hpp
+#include "matrix.hpp"
+#include "optimizations.hpp"
+#include "thread_pool.hpp"
+#include <cstring>
+#include <optional>
+#include <type_traits>
+
+namespace ml {
+
+namespace detail {
+
+// Operands are either Matrix leaves (held by reference) or expression nodes
+// (held by value, they are small)
+template <typename T>
+constexpr bool is_operand_v = std::is_same_v<T, Matrix> || is_expression_node<T>::value;
+
+template <typename T>
+using operand_storage_t = std::conditional_t<std::is_same_v<T, Matrix>, const Matrix&, T>;
+
+// Whether an operand contains a matrix product somewhere below it
+template <typename T>
+struct contains_product : std::false_type {};
+
+// Leaf handling: a Matrix needs no preparation and is read directly
+inline void prepare_operand(const Matrix&, float*, bool&) {}
+template <typename E>
+void prepare_operand(const E& expr, float* dst, bool& dst_taken) { expr.prepare(dst, dst_taken); }
+
+inline float eval_operand(const Matrix& m, size_t i) { return m.data()[i]; }
+template <typename E>
+float eval_operand(const E& expr, size_t i) { return expr.eval(i); }
+
+inline bool operand_references(const Matrix& m, const float* ptr) { return m.data() == ptr; }
+template <typename E>
+bool operand_references(const E& expr, const float* ptr) { return expr.references(ptr); }
+
+// Each op in scalar form for the element sweep, and as the dispatched
+// in-place kernel a Op= b for whole arrays
+struct AddOp {
+    static float apply(float a, float b) { return a + b; }
+    static void apply(float* a, const float* b, size_t size) { simd_add(a, b, size); }
+};
+struct SubtractOp {
+    static float apply(float a, float b) { return a - b; }
+    static void apply(float* a, const float* b, size_t size) { simd_subtract(a, b, size); }
+};
+
+} // namespace detail
+
+// Element-wise binary node: lhs Op rhs, evaluated one element at a time
+template <typename L, typename R, typename Op>
+class ElementwiseExpr {
+public:
+    ElementwiseExpr(const L& lhs, const R& rhs) : lhs_(lhs), rhs_(rhs) {
+        if (lhs.rows() != rhs.rows() || lhs.cols() != rhs.cols()) {
+            throw std::invalid_argument("Matrix dimensions must match");
+        }
+    }
+
+    size_t rows() const { return lhs_.rows(); }
+    size_t cols() const { return lhs_.cols(); }
+
+    // Run any products below this node; the first one writes straight into dst
+    void prepare(float* dst, bool& dst_taken) const {
+        detail::prepare_operand(lhs_, dst, dst_taken);
+        detail::prepare_operand(rhs_, dst, dst_taken);
+    }
+
+    float eval(size_t i) const {
+        return Op::apply(detail::eval_operand(lhs_, i), detail::eval_operand(rhs_, i));
+    }
+
+    // Whether any Matrix leaf of this expression owns the buffer at ptr
+    bool references(const float* ptr) const {
+        return detail::operand_references(lhs_, ptr) || detail::operand_references(rhs_, ptr);
+    }
+
+    const L& lhs() const { return lhs_; }
+    const R& rhs() const { return rhs_; }
+
+private:
+    detail::operand_storage_t<L> lhs_;
+    detail::operand_storage_t<R> rhs_;
+};
+
+// Matrix product node
+// Evaluated by a GEMM during prepare(): into the destination buffer when it is
+// the first product of the expression, otherwise into a pooled temporary
+template <typename L, typename R>
+class ProductExpr {
+public:
+    ProductExpr(const L& lhs, const R& rhs) : lhs_(lhs), rhs_(rhs) {
+        if (lhs.cols() != rhs.rows()) {
+            throw std::invalid_argument("Invalid matrix dimensions for multiplication");
+        }
+    }
+
+    size_t rows() const { return lhs_.rows(); }
+    size_t cols() const { return rhs_.cols(); }
+
+    void prepare(float* dst, bool& dst_taken) const {
+        const Matrix& a = materialize(lhs_, lhs_value_);
+        const Matrix& b = materialize(rhs_, rhs_value_);
+        float* out = dst;
+        if (dst_taken) {
+            result_.emplace(rows(), cols(), Matrix::Uninitialized{});
+            out = result_->data();
+        }
+        dst_taken = true;
+        block_multiply(out, a.data(), b.data(), a.rows(), b.cols(), a.cols());
+        data_ = out;
+    }
+
+    float eval(size_t i) const { return data_[i]; }
+
+    bool references(const float* ptr) const {
+        return detail::operand_references(lhs_, ptr) || detail::operand_references(rhs_, ptr);
+    }
+
+private:
+    // Operands of a GEMM must be dense matrices; nested expressions are
+    // evaluated into a temporary first
+    static const Matrix& materialize(const Matrix& m, std::optional<Matrix>&) { return m; }
+    template <typename E>
+    static const Matrix& materialize(const E& expr, std::optional<Matrix>& storage) {
+        storage.emplace(expr);
+        return *storage;
+    }
+
+    detail::operand_storage_t<L> lhs_;
+    detail::operand_storage_t<R> rhs_;
+    mutable std::optional<Matrix> lhs_value_;
+    mutable std::optional<Matrix> rhs_value_;
+    mutable std::optional<Matrix> result_;
+    mutable const float* data_ = nullptr;
+};
+
+namespace detail {
+
+template <typename L, typename R, typename Op>
+struct is_expression_node<ElementwiseExpr<L, R, Op>> : std::true_type {};
+template <typename L, typename R>
+struct is_expression_node<ProductExpr<L, R>> : std::true_type {};
+
+template <typename L, typename R, typename Op>
+struct contains_product<ElementwiseExpr<L, R, Op>>
+    : std::bool_constant<contains_product<L>::value || contains_product<R>::value> {};
+template <typename L, typename R>
+struct contains_product<ProductExpr<L, R>> : std::true_type {};
+
+template <typename T>
+struct is_product : std::false_type {};
+template <typename L, typename R>
+struct is_product<ProductExpr<L, R>> : std::true_type {};
+
+// A single element-wise node between two matrices, e.g. a + b
+template <typename T>
+struct is_matrix_pair : std::false_type {};
+template <typename Op>
+struct is_matrix_pair<ElementwiseExpr<Matrix, Matrix, Op>> : std::true_type {
+    using op = Op;
+};
+
+// Compute expr into dst (expr.rows() x expr.cols() elements)
+template <typename Expr>
+void evaluate(const Expr& expr, float* dst) {
+    bool dst_taken = false;
+    expr.prepare(dst, dst_taken);
+    if constexpr (is_product<Expr>::value) {
+        // A bare product is complete once its GEMM has written dst
+        return;
+    }
+
+    size_t size = expr.rows() * expr.cols();
+    if constexpr (is_matrix_pair<Expr>::value) {
+        // a + b or a - b: copy a and run the dispatched kernel rather than the
+        // sweep below, which is built for the including file's baseline ISA.
+        // The sweep still serves dst == b, which the copy would overwrite
+        const float* a = expr.lhs().data();
+        const float* b = expr.rhs().data();
+        if (b != dst) {
+            if (a != dst && size > 0) {
+                std::memcpy(dst, a, size * sizeof(float));
+            }
+            is_matrix_pair<Expr>::op::apply(dst, b, size);
+            return;
+        }
+    }
+
+    auto sweep = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            dst[i] = expr.eval(i);
+        }
+    };
+    if (size < PARALLEL_ELEMENTWISE_MIN) {
+        sweep(0, size);
+    } else {
+        ThreadPool::instance().parallel_range(size, 16, sweep);
+    }
+}
+
+template <typename L, typename R>
+using enable_if_operands_t = std::enable_if_t<is_operand_v<L> && is_operand_v<R>>;
+
+} // namespace detail
+
+// Expression-building operators for Matrix and expression operands
+template <typename L, typename R, typename = detail::enable_if_operands_t<L, R>>
+ElementwiseExpr<L, R, detail::AddOp> operator+(const L& lhs, const R& rhs) {
+    return {lhs, rhs};
+}
+
+template <typename L, typename R, typename = detail::enable_if_operands_t<L, R>>
+ElementwiseExpr<L, R, detail::SubtractOp> operator-(const L& lhs, const R& rhs) {
+    return {lhs, rhs};
+}
+
+template <typename L, typename R, typename = detail::enable_if_operands_t<L, R>>
+ProductExpr<L, R> operator*(const L& lhs, const R& rhs) {
+    return {lhs, rhs};
+}
+
+template <typename Expr, typename>
+Matrix::Matrix(const Expr& expr)
+    : Matrix(expr.rows(), expr.cols(), Uninitialized{}) {
+    detail::evaluate(expr, data());
+}
+
+template <typename Expr, typename>
+Matrix& Matrix::operator=(const Expr& expr) {
+    bool reusable = rows_ == expr.rows() && cols_ == expr.cols() && owns_data();
+    // A GEMM writing into this buffer while also reading it would corrupt
+    // its own input, so such expressions go through fresh storage, as do
+    // wrapped matrices (see Matrix::wrap)
+    bool aliased = detail::contains_product<Expr>::value && expr.references(data());
+    if (reusable && !aliased) {
+        detail::evaluate(expr, data());
+    } else {
+        *this = Matrix(expr);
+    }
+    return *this;
+}
+
+} // namespace ml
@@ -0,0 +1,96 @@
+#pragma once
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+
+namespace ml {
+
+// BasicMatrixView class: Non-owning window onto strided float storage
+// Element (i, j) lives at data[i * row_stride + j * col_stride], so row and
+// column ranges, sub-blocks and transposes of a matrix are all views of the
+// same memory; the offset of a sub-view is folded into its data pointer.
+// A view never allocates or frees; the viewed storage must outlive it
+// T: float for a writable view, const float for a read-only one
+template <typename T>
+class BasicMatrixView {
+public:
+    BasicMatrixView() = default;
+
+    // data: Element (0, 0)
+    // rows, cols: Shape of the view
+    // row_stride, col_stride: Distance in elements between neighbouring
+    //                         rows and columns
+    BasicMatrixView(T* data, size_t rows, size_t cols, size_t row_stride, size_t col_stride)
+        : data_(data), rows_(rows), cols_(cols), row_stride_(row_stride), col_stride_(col_stride) {}
+
+    // Dense row-major view of rows x cols elements
+    BasicMatrixView(T* data, size_t rows, size_t cols)
+        : BasicMatrixView(data, rows, cols, cols, 1) {}
+
+    // A writable view converts to a read-only one
+    template <typename U, typename = std::enable_if_t<std::is_same_v<U, float> && std::is_const_v<T>>>
+    BasicMatrixView(const BasicMatrixView<U>& other)
+        : BasicMatrixView(other.data(), other.rows(), other.cols(), other.row_stride(), other.col_stride()) {}
+
+    T* data() const { return data_; }
+    size_t rows() const { return rows_; }
+    size_t cols() const { return cols_; }
+    size_t row_stride() const { return row_stride_; }
+    size_t col_stride() const { return col_stride_; }
+
+    // Element access with bounds checking
+    // Throws std::out_of_range if indices are invalid
+    T& at(size_t row, size_t col) const {
+        if (row >= rows_ || col >= cols_) {
+            throw std::out_of_range("Matrix view index out of bounds");
+        }
+        return data_[row * row_stride_ + col * col_stride_];
+    }
+
+    // Rows [begin, end)
+    // Throws std::out_of_range if the range exceeds the view
+    BasicMatrixView row_range(size_t begin, size_t end) const {
+        return block(begin, 0, end - begin, cols_, begin <= end);
+    }
+
+    // Columns [begin, end)
+    BasicMatrixView col_range(size_t begin, size_t end) const {
+        return block(0, begin, rows_, end - begin, begin <= end);
+    }
+
+    // rows x cols sub-block whose top-left element is (row, col)
+    BasicMatrixView block(size_t row, size_t col, size_t rows, size_t cols) const {
+        return block(row, col, rows, cols, true);
+    }
+
+    // The transpose, sharing this view's memory
+    BasicMatrixView transposed() const {
+        return BasicMatrixView(data_, cols_, rows_, col_stride_, row_stride_);
+    }
+
+    // Whether each row is a contiguous run of cols() elements
+    bool unit_col_stride() const { return col_stride_ == 1 || cols_ <= 1; }
+
+    // Whether the view is dense row-major storage of rows() * cols() elements
+    bool is_contiguous() const { return unit_col_stride() && (row_stride_ == cols_ || rows_ <= 1); }
+
+private:
+    BasicMatrixView block(size_t row, size_t col, size_t rows, size_t cols, bool ordered) const {
+        if (!ordered || row > rows_ || col > cols_ || rows > rows_ - row || cols > cols_ - col) {
+            throw std::out_of_range("Matrix view range out of bounds");
+        }
+        return BasicMatrixView(data_ + row * row_stride_ + col * col_stride_, rows, cols,
+                               row_stride_, col_stride_);
+    }
+
+    T* data_ = nullptr;
+    size_t rows_ = 0;
+    size_t cols_ = 0;
+    size_t row_stride_ = 0;
+    size_t col_stride_ = 1;
+};
+
+using MatrixView = BasicMatrixView<float>;
+using ConstMatrixView = BasicMatrixView<const float>;
+
+} // namespace ml
@@ -0,0 +1,63 @@
+#include "memory_planner.hpp"
+#include "aligned_allocator.hpp"
+#include <algorithm>
+#include <numeric>
+
+namespace ml {
+
+namespace {
+
+size_t align_up(size_t bytes) {
+    return (bytes + MEMORY_ALIGNMENT - 1) / MEMORY_ALIGNMENT * MEMORY_ALIGNMENT;
+}
+
+bool lifetimes_overlap(const BufferLifetime& a, const BufferLifetime& b) {
+    return a.first_use <= b.last_use && b.first_use <= a.last_use;
+}
+
+} // namespace
+
+MemoryPlan plan_memory(const std::vector<BufferLifetime>& buffers) {
+    MemoryPlan plan;
+    plan.offsets.assign(buffers.size(), 0);
+
+    std::vector<size_t> order(buffers.size());
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return buffers[a].bytes > buffers[b].bytes;
+    });
+
+    // Byte ranges [begin, end) of placed buffers that are live alongside the
+    // buffer being placed
+    std::vector<std::pair<size_t, size_t>> conflicts;
+    std::vector<size_t> placed;
+    placed.reserve(buffers.size());
+    for (size_t index : order) {
+        const BufferLifetime& buffer = buffers[index];
+        size_t size = align_up(buffer.bytes);
+
+        conflicts.clear();
+        for (size_t other : placed) {
+            if (lifetimes_overlap(buffer, buffers[other])) {
+                conflicts.emplace_back(plan.offsets[other], plan.offsets[other] + align_up(buffers[other].bytes));
+            }
+        }
+        std::sort(conflicts.begin(), conflicts.end());
+
+        // First gap between live buffers that is large enough
+        size_t offset = 0;
+        for (const auto& range : conflicts) {
+            if (range.first >= offset + size) {
+                break;
+            }
+            offset = std::max(offset, range.second);
+        }
+
+        plan.offsets[index] = offset;
+        plan.arena_bytes = std::max(plan.arena_bytes, offset + size);
+        placed.push_back(index);
+    }
+    return plan;
+}
+
+} // namespace ml
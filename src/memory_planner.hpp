@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+namespace ml {
+
+// Size and lifetime of one intermediate buffer of a forward pass
+// Steps are the positions of the operations that touch the buffer; a buffer
+// must keep its contents from first_use through last_use (inclusive)
+struct BufferLifetime {
+    size_t bytes;
+    size_t first_use;
+    size_t last_use;
+};
+
+// Placement of every buffer inside one arena
+// offsets[i]: Byte offset of buffer i, a multiple of MEMORY_ALIGNMENT
+// arena_bytes: Size of the arena needed to hold all buffers
+struct MemoryPlan {
+    std::vector<size_t> offsets;
+    size_t arena_bytes = 0;
+};
+
+// Assign arena offsets so that buffers whose lifetimes intersect never share
+// memory, while buffers with disjoint lifetimes may reuse the same bytes
+// Greedy by size: the largest buffers are placed first, each at the lowest
+// aligned offset that does not collide with an already placed buffer that is
+// live at the same time. For a chain of layers this yields the two ping-pong
+// buffers, sized for the largest even and odd activations
+MemoryPlan plan_memory(const std::vector<BufferLifetime>& buffers);
+
+} // namespace ml
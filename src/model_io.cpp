@@ -0,0 +1,214 @@
+#include "model_io.hpp"
+#include "aligned_allocator.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace ml {
+
+namespace {
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "Model files are little-endian");
+
+size_t align_up(size_t value) {
+    return (value + MEMORY_ALIGNMENT - 1) / MEMORY_ALIGNMENT * MEMORY_ALIGNMENT;
+}
+
+// Copy-on-write mapping of a whole file: pages are shared through the page
+// cache until written, and writes never reach the file
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot open model file " + path + ": " + std::strerror(errno));
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            int error = errno;
+            close(fd);
+            throw std::runtime_error("Cannot stat model file " + path + ": " + std::strerror(error));
+        }
+        size_ = static_cast<size_t>(info.st_size);
+        if (size_ < sizeof(ModelFileHeader)) {
+            close(fd);
+            throw std::runtime_error("Model file " + path + " is truncated");
+        }
+        void* data = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        int error = errno;
+        close(fd);
+        if (data == MAP_FAILED) {
+            throw std::runtime_error("Cannot map model file " + path + ": " + std::strerror(error));
+        }
+        data_ = static_cast<char*>(data);
+    }
+
+    ~MappedFile() { munmap(data_, size_); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+bool valid_precision(uint32_t value) {
+    switch (static_cast<Precision>(value)) {
+        case Precision::Float32:
+        case Precision::BFloat16:
+        case Precision::Float16:
+            return true;
+    }
+    return false;
+}
+
+bool valid_activation(uint32_t value) {
+    switch (static_cast<ActivationType>(value)) {
+        case ActivationType::ReLU:
+        case ActivationType::Sigmoid:
+        case ActivationType::Tanh:
+            return true;
+    }
+    return false;
+}
+
+// Whether a blob of count elements of element_bytes each at offset lies
+// inside the file and is aligned
+bool valid_blob(uint64_t offset, uint64_t count, size_t element_bytes, size_t file_bytes) {
+    if (offset % MEMORY_ALIGNMENT != 0 || offset > file_bytes) {
+        return false;
+    }
+    return count <= (file_bytes - offset) / element_bytes;
+}
+
+} // namespace
+
+void save_network(const NeuralNetwork& network, const std::string& path) {
+    const auto& layers = network.get_layers();
+
+    // Lay out the blobs after the header and layer table
+    std::vector<ModelLayerRecord> records(layers.size());
+    size_t offset = align_up(sizeof(ModelFileHeader) + layers.size() * sizeof(ModelLayerRecord));
+    for (size_t i = 0; i < layers.size(); ++i) {
+        const Layer& layer = layers[i];
+        ModelLayerRecord& record = records[i];
+        std::memset(&record, 0, sizeof(record));
+        record.input_size = layer.input_size();
+        record.output_size = layer.output_size();
+        record.activation = static_cast<uint32_t>(layer.get_activation());
+        record.precision = static_cast<uint32_t>(layer.get_weight_precision());
+        record.weights_offset = offset;
+        offset = align_up(offset + layer.input_size() * layer.output_size() *
+                                       precision_bytes(layer.get_weight_precision()));
+        record.biases_offset = offset;
+        offset = align_up(offset + layer.output_size() * sizeof(float));
+    }
+
+    ModelFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, MODEL_FILE_MAGIC, sizeof(header.magic));
+    header.version = MODEL_FILE_VERSION;
+    header.layer_count = static_cast<uint32_t>(layers.size());
+    header.file_bytes = offset;
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        throw std::runtime_error("Cannot open model file for writing: " + path);
+    }
+    static const char zeros[MEMORY_ALIGNMENT] = {};
+    size_t written = 0;
+    auto write = [&](const void* data, size_t bytes) {
+        file.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+        written += bytes;
+    };
+    auto pad_to = [&](size_t target) { write(zeros, target - written); };
+
+    write(&header, sizeof(header));
+    write(records.data(), records.size() * sizeof(ModelLayerRecord));
+    for (size_t i = 0; i < layers.size(); ++i) {
+        const Layer& layer = layers[i];
+        pad_to(records[i].weights_offset);
+        if (const HalfMatrix* half = layer.get_half_weights()) {
+            write(half->data(), half->bytes());
+        } else {
+            write(layer.get_weights().data(), layer.input_size() * layer.output_size() * sizeof(float));
+        }
+        pad_to(records[i].biases_offset);
+        write(layer.get_biases().data(), layer.output_size() * sizeof(float));
+    }
+    pad_to(offset);
+    if (!file.flush()) {
+        throw std::runtime_error("Failed to write model file: " + path);
+    }
+}
+
+std::unique_ptr<NeuralNetwork> load_network(const std::string& path) {
+    auto mapping = std::make_shared<MappedFile>(path);
+    const char* base = mapping->data();
+    size_t file_bytes = mapping->size();
+
+    ModelFileHeader header;
+    std::memcpy(&header, base, sizeof(header));
+    if (std::memcmp(header.magic, MODEL_FILE_MAGIC, sizeof(header.magic)) != 0) {
+        throw std::runtime_error(path + " is not a model file");
+    }
+    if (header.version == 0 || header.version > MODEL_FILE_VERSION) {
+        throw std::runtime_error(path + " has unsupported model file version " +
+                                 std::to_string(header.version));
+    }
+    if (header.file_bytes != file_bytes ||
+        header.layer_count > (file_bytes - sizeof(header)) / sizeof(ModelLayerRecord)) {
+        throw std::runtime_error("Model file " + path + " is truncated or corrupt");
+    }
+
+    auto network = std::make_unique<NeuralNetwork>();
+    for (uint32_t i = 0; i < header.layer_count; ++i) {
+        ModelLayerRecord record;
+        std::memcpy(&record, base + sizeof(header) + i * sizeof(record), sizeof(record));
+        // The size bounds keep input_size * output_size from overflowing
+        size_t weight_bytes = precision_bytes(static_cast<Precision>(record.precision));
+        uint64_t max_weights = file_bytes / weight_bytes;
+        bool valid = record.input_size > 0 && record.output_size > 0 &&
+                     record.output_size <= max_weights && record.input_size <= max_weights / record.output_size &&
+                     valid_activation(record.activation) && valid_precision(record.precision) &&
+                     valid_blob(record.weights_offset, record.input_size * record.output_size, weight_bytes,
+                                file_bytes) &&
+                     valid_blob(record.biases_offset, record.output_size, sizeof(float), file_bytes);
+        if (!valid) {
+            throw std::runtime_error("Model file " + path + " has a corrupt record for layer " +
+                                     std::to_string(i));
+        }
+
+        // Every view shares ownership of the mapping
+        char* weights = mapping->data() + record.weights_offset;
+        auto* biases = reinterpret_cast<float*>(mapping->data() + record.biases_offset);
+        auto precision = static_cast<Precision>(record.precision);
+        auto activation = static_cast<ActivationType>(record.activation);
+        Matrix bias_view = Matrix::wrap(biases, 1, record.output_size, mapping);
+        Layer layer = precision == Precision::Float32
+            ? Layer(Matrix::wrap(reinterpret_cast<float*>(weights), record.input_size, record.output_size, mapping),
+                    std::move(bias_view), activation)
+            : Layer(HalfMatrix::wrap(reinterpret_cast<const uint16_t*>(weights), record.input_size,
+                                     record.output_size, precision, mapping),
+                    std::move(bias_view), activation);
+        try {
+            network->add_layer(std::move(layer));
+        } catch (const std::invalid_argument&) {
+            throw std::runtime_error("Model file " + path + ": layer " + std::to_string(i) +
+                                     " does not connect to the previous layer");
+        }
+    }
+    return network;
+}
+
+} // namespace ml
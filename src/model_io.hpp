@@ -0,0 +1,67 @@
+#pragma once
+#include "neural.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace ml {
+
+// Binary model format
+// Little-endian; all offsets are in bytes from the start of the file
+//
+//   ModelFileHeader                  (64 bytes)
+//   ModelLayerRecord[layer_count]    (48 bytes each)
+//   weight and bias blobs            (row-major, each 64-byte aligned)
+//
+// Biases are float32; weights are float32, bfloat16 or float16 as recorded
+// per layer (see Layer::set_weight_precision)
+//
+// Blob alignment matches MEMORY_ALIGNMENT, so a mapped file can be read by
+// the GEMM kernels in place exactly like pooled matrices
+
+// "MLCPPNN" followed by a NUL
+constexpr char MODEL_FILE_MAGIC[8] = {'M', 'L', 'C', 'P', 'P', 'N', 'N', '\0'};
+
+// Bumped whenever the layout changes; loaders read this and earlier
+// versions and reject newer ones
+// Version 2 added the per-layer weight precision; version 1 files are all float32
+constexpr uint32_t MODEL_FILE_VERSION = 2;
+
+struct ModelFileHeader {
+    char magic[8];          // MODEL_FILE_MAGIC
+    uint32_t version;       // MODEL_FILE_VERSION
+    uint32_t layer_count;
+    uint64_t file_bytes;    // Total size, to detect truncation
+    uint8_t reserved[40];   // Zero
+};
+
+struct ModelLayerRecord {
+    uint64_t input_size;
+    uint64_t output_size;
+    uint32_t activation;    // ActivationType value
+    uint32_t precision;     // Precision value of the weights (zero, Float32, before version 2)
+    uint64_t weights_offset; // input_size x output_size weights
+    uint64_t biases_offset;  // output_size floats
+    uint64_t reserved2;     // Zero
+};
+
+static_assert(sizeof(ModelFileHeader) == 64, "Model header layout changed");
+static_assert(sizeof(ModelLayerRecord) == 48, "Model layer record layout changed");
+
+// Write network's topology and parameters to path
+// Throws std::runtime_error when the file cannot be written
+void save_network(const NeuralNetwork& network, const std::string& path);
+
+// Load a network saved by save_network
+// The file is memory-mapped copy-on-write and every weight and bias matrix
+// is a view into the mapping (Matrix::owns_data() is false; half-precision
+// weights are HalfMatrix views), so loading does
+// no parameter copies and processes loading the same file share its pages
+// through the page cache. Training a loaded network writes to private
+// copies of the touched pages; the file itself is never modified. The
+// mapping is released when the last matrix viewing it is destroyed
+// Throws std::runtime_error if the file cannot be mapped or is not a valid
+// model file of this or an earlier version
+std::unique_ptr<NeuralNetwork> load_network(const std::string& path);
+
+} // namespace ml
@@ -1,11 +1,18 @@
 #include "neural.hpp"
+#include "gemm.hpp"
+#include "memory_planner.hpp"
+#include "optimizations.hpp"
+#include "profiler.hpp"
 #include <cmath>
+#include <cstring>
 #include <random>
+#include <string>
+#include <utility>
 
 namespace ml {
 
 Layer::Layer(size_t input_size, size_t output_size, ActivationType activation)
-    : weights_(input_size, output_size)
+    : weights_(std::in_place, input_size, output_size)
     , biases_(1, output_size)
     , last_input_(1, input_size)
     , last_output_(1, output_size)
@@ -19,7 +26,7 @@ Layer::Layer(size_t input_size, size_t output_size, ActivationType activation)
     
     for (size_t i = 0; i < input_size; ++i) {
         for (size_t j = 0; j < output_size; ++j) {
-            weights_.at(i, j) = dis(gen);
+            weights_->at(i, j) = dis(gen);
         }
     }
     
@@ -28,73 +35,470 @@ Layer::Layer(size_t input_size, size_t output_size, ActivationType activation)
     }
 }
 
-std::function<float(float)> Layer::get_activation_function() {
-    switch (activation_) {
-        case ActivationType::ReLU:
-            return [](float x) { return x > 0 ? x : 0; };
-        case ActivationType::Sigmoid:
-            return [](float x) { return 1.0f / (1.0f + std::exp(-x)); };
-        case ActivationType::Tanh:
-            return [](float x) { return std::tanh(x); };
-        default:
-            throw std::runtime_error("Unknown activation function");
+Layer::Layer(Matrix weights, Matrix biases, ActivationType activation)
+    : weights_(std::move(weights))
+    , biases_(std::move(biases))
+    , last_input_(1, weights_->rows())
+    , last_output_(1, weights_->cols())
+    , activation_(activation) {
+    if (biases_.rows() != 1 || biases_.cols() != weights_->cols()) {
+        throw std::invalid_argument("Biases must be a 1 x output_size row vector");
     }
 }
 
-std::function<float(float)> Layer::get_activation_derivative() {
-    switch (activation_) {
-        case ActivationType::ReLU:
-            return [](float x) { return x > 0 ? 1.0f : 0.0f; };
-        case ActivationType::Sigmoid:
-            return [](float x) {
-                float s = 1.0f / (1.0f + std::exp(-x));
-                return s * (1.0f - s);
-            };
-        case ActivationType::Tanh:
-            return [](float x) {
-                float t = std::tanh(x);
-                return 1.0f - t * t;
-            };
-        default:
-            throw std::runtime_error("Unknown activation function");
+Layer::Layer(HalfMatrix weights, Matrix biases, ActivationType activation)
+    : half_weights_(std::move(weights))
+    , biases_(std::move(biases))
+    , last_input_(1, half_weights_->rows())
+    , last_output_(1, half_weights_->cols())
+    , activation_(activation) {
+    if (biases_.rows() != 1 || biases_.cols() != half_weights_->cols()) {
+        throw std::invalid_argument("Biases must be a 1 x output_size row vector");
     }
 }
 
-Matrix Layer::forward(const Matrix& input) {
-    last_input_ = input;
-    Matrix output = input * weights_;
-    
-    // Add biases
-    for (size_t i = 0; i < output.rows(); ++i) {
-        for (size_t j = 0; j < output.cols(); ++j) {
-            output.at(i, j) += biases_.at(0, j);
-        }
+const Matrix& Layer::get_weights() const {
+    require_float_weights("get_weights");
+    return *weights_;
+}
+
+Matrix& Layer::get_weights() {
+    require_float_weights("get_weights");
+    return *weights_;
+}
+
+void Layer::require_float_weights(const char* operation) const {
+    if (half_weights_) {
+        throw std::logic_error(std::string(operation) +
+                               " needs float weights; the layer stores half precision");
     }
-    
-    // Apply activation function
-    auto activation = get_activation_function();
-    for (size_t i = 0; i < output.rows(); ++i) {
-        for (size_t j = 0; j < output.cols(); ++j) {
-            output.at(i, j) = activation(output.at(i, j));
-        }
+}
+
+const Matrix& Layer::forward(const Matrix& input) {
+    if (input.cols() != input_size()) {
+        throw std::invalid_argument("Invalid matrix dimensions for multiplication");
     }
-    
-    last_output_ = output;
-    return output;
+    // Copy assignment reuses the cache buffer when the shape is unchanged
+    // The GEMM reads the copy, so input may alias last_output_
+    {
+        ProfileScope scope("Layer::cache_input", 0.0, 8.0 * input.rows() * input.cols());
+        last_input_ = input;
+    }
+    if (last_output_.rows() != input.rows()) {
+        last_output_ = Matrix(input.rows(), output_size(), Matrix::Uninitialized{});
+    }
+    forward(last_input_, last_output_);
+    return last_output_;
+}
+
+void Layer::forward(const Matrix& input, Matrix& output) const {
+    forward(input.view(), output.view());
 }
 
-NeuralNetwork::NeuralNetwork() = default;
+void Layer::forward(ConstMatrixView input, MatrixView output) const {
+    if (input.cols() != input_size()) {
+        throw std::invalid_argument("Invalid matrix dimensions for multiplication");
+    }
+    if (output.rows() != input.rows() || output.cols() != output_size()) {
+        throw std::invalid_argument("Output dimensions must be batch_size x output_size");
+    }
+    // Dense, sparse or half-precision product with the bias add and
+    // activation fused into its store epilogue
+    if (sparse_weights_) {
+        spmm_bias_activation(output, input, *sparse_weights_, biases_.data(), activation_);
+    } else if (half_weights_) {
+        gemm_bias_activation(output, input, *half_weights_, biases_.data(), activation_);
+    } else {
+        gemm_bias_activation(output, input, std::as_const(*weights_).view(), biases_.data(), activation_);
+    }
+}
+
+bool Layer::sparsify(size_t block_rows, size_t block_cols, double max_density) {
+    require_float_weights("sparsify");
+    SparseMatrix sparse(*weights_, block_rows, block_cols);
+    if (sparse.density() > max_density) {
+        sparse_weights_.reset();
+        return false;
+    }
+    sparse_weights_ = std::move(sparse);
+    return true;
+}
+
+void Layer::set_weight_precision(Precision precision) {
+    if (precision == get_weight_precision()) {
+        return;
+    }
+    if (precision == Precision::Float32) {
+        weights_.emplace(half_weights_->to_float());
+        half_weights_.reset();
+        return;
+    }
+    // Converting between the two half formats goes through float, which
+    // represents both exactly
+    HalfMatrix half(half_weights_ ? half_weights_->to_float() : *weights_, precision);
+    half_weights_.emplace(std::move(half));
+    weights_.reset();
+    sparse_weights_.reset();
+    weight_gradients_.reset();
+    bias_gradients_.reset();
+    optimizer_state_.reset();
+}
+
+Matrix Layer::backward(const Matrix& gradient) {
+    require_float_weights("backward");
+    size_t batch = last_output_.rows();
+    size_t inputs = weights_->rows();
+    size_t outputs = weights_->cols();
+    if (gradient.rows() != batch || gradient.cols() != outputs) {
+        throw std::invalid_argument("Gradient dimensions must match the last layer output");
+    }
+
+    Matrix delta(batch, outputs, Matrix::Uninitialized{});
+    activation_backward(delta.data(), gradient.data(), last_output_.data(),
+                        batch * outputs, activation_);
+
+    if (!weight_gradients_) {
+        weight_gradients_.emplace(inputs, outputs);
+        bias_gradients_.emplace(1, outputs);
+    }
+    // dW = X^T * delta, reading the cached input as its transpose
+    gemm(weight_gradients_->data(), last_input_.data(), delta.data(),
+         inputs, outputs, batch, true, false);
+    column_sum(bias_gradients_->data(), delta.data(), batch, outputs);
+
+    // dX = delta * W^T, reading the weights as their transpose
+    Matrix input_gradient(batch, inputs, Matrix::Uninitialized{});
+    gemm(input_gradient.data(), delta.data(), weights_->data(),
+         batch, inputs, outputs, false, true);
+    return input_gradient;
+}
+
+void Layer::update_weights(float learning_rate) {
+    OptimizerConfig config;
+    config.learning_rate = learning_rate;
+    update_weights(config);
+}
+
+void Layer::update_weights(const OptimizerConfig& config) {
+    require_float_weights("update_weights");
+    if (!weight_gradients_) {
+        throw std::logic_error("update_weights called before backward");
+    }
+    update_weights(config, weight_gradients_->data(), bias_gradients_->data());
+}
+
+void Layer::update_weights(const OptimizerConfig& config, const float* weight_gradients,
+                           const float* bias_gradients) {
+    require_float_weights("update_weights");
+    // The sparse copy would go stale; training updates every weight
+    sparse_weights_.reset();
+    size_t weight_count = weights_->rows() * weights_->cols();
+    size_t bias_count = biases_.cols();
+
+    if (config.type == OptimizerType::SGD) {
+        sgd_update(weights_->data(), weight_gradients, weight_count, config.learning_rate);
+        sgd_update(biases_.data(), bias_gradients, bias_count, config.learning_rate);
+        return;
+    }
+
+    if (!optimizer_state_ || optimizer_state_->type != config.type) {
+        optimizer_state_.emplace(OptimizerState{
+            config.type,
+            Matrix(weights_->rows(), weights_->cols()), Matrix(weights_->rows(), weights_->cols()),
+            Matrix(1, bias_count), Matrix(1, bias_count), 0});
+    }
+    OptimizerState& state = *optimizer_state_;
+    ++state.step;
+
+    if (config.type == OptimizerType::Momentum) {
+        momentum_update(weights_->data(), weight_gradients, state.weight_m.data(),
+                        weight_count, config.learning_rate, config.momentum);
+        momentum_update(biases_.data(), bias_gradients, state.bias_m.data(),
+                        bias_count, config.learning_rate, config.momentum);
+    } else {
+        adam_update(weights_->data(), weight_gradients, state.weight_m.data(),
+                    state.weight_v.data(), weight_count, config.learning_rate,
+                    config.beta1, config.beta2, config.epsilon, state.step);
+        adam_update(biases_.data(), bias_gradients, state.bias_m.data(),
+                    state.bias_v.data(), bias_count, config.learning_rate,
+                    config.beta1, config.beta2, config.epsilon, state.step);
+    }
+}
+
+const Matrix& Layer::get_weight_gradients() const {
+    if (!weight_gradients_) {
+        throw std::logic_error("No gradients: backward has not been called");
+    }
+    return *weight_gradients_;
+}
+
+const Matrix& Layer::get_bias_gradients() const {
+    if (!bias_gradients_) {
+        throw std::logic_error("No gradients: backward has not been called");
+    }
+    return *bias_gradients_;
+}
+
+InferenceContext::InferenceContext(const NeuralNetwork& network, size_t batch_size) {
+    prepare(network, batch_size);
+}
+
+void InferenceContext::prepare(const NeuralNetwork& network, size_t batch_size) {
+    const auto& layers = network.get_layers();
+    bool matches = batch_size == batch_size_ && activations_.size() == layers.size();
+    for (size_t i = 0; matches && i < layers.size(); ++i) {
+        matches = activations_[i].cols() == layers[i].output_size();
+    }
+    if (matches) {
+        return;
+    }
+    ProfileScope scope("InferenceContext::prepare");
+    if (batch_size == 0) {
+        throw std::invalid_argument("Batch size must be positive");
+    }
+
+    // Layer i writes its output at step i and layer i + 1 reads it at step
+    // i + 1; the final output stays live past the last layer
+    std::vector<BufferLifetime> lifetimes;
+    lifetimes.reserve(layers.size());
+    for (size_t i = 0; i < layers.size(); ++i) {
+        lifetimes.push_back({batch_size * layers[i].output_size() * sizeof(float), i, i + 1});
+    }
+    MemoryPlan plan = plan_memory(lifetimes);
+
+    activations_.clear();
+    if (plan.arena_bytes > arena_capacity_) {
+        arena_.reset();
+        arena_ = std::unique_ptr<float[], PoolDeleter>(
+            static_cast<float*>(pool_allocate(plan.arena_bytes)), PoolDeleter{plan.arena_bytes});
+        arena_capacity_ = plan.arena_bytes;
+    }
+    activations_.reserve(layers.size());
+    for (size_t i = 0; i < layers.size(); ++i) {
+        float* buffer = arena_.get() + plan.offsets[i] / sizeof(float);
+        activations_.push_back(Matrix::wrap(buffer, batch_size, layers[i].output_size()));
+    }
+    batch_size_ = batch_size;
+}
+
+NeuralNetwork::NeuralNetwork()
+    : last_input_(1, 1), sync_(std::make_unique<SyncState>()) {}
+
+NeuralNetwork::NeuralNetwork(const NeuralNetwork& other)
+    : last_input_(1, 1), sync_(std::make_unique<SyncState>()) {
+    std::lock_guard<std::mutex> lock(other.sync_->mutex);
+    layers_ = other.layers_;
+    last_input_ = other.last_input_;
+    optimizer_ = other.optimizer_;
+}
+
+NeuralNetwork::NeuralNetwork(NeuralNetwork&& other)
+    : last_input_(1, 1), sync_(std::make_unique<SyncState>()) {
+    other.reset_sync();
+    layers_ = std::move(other.layers_);
+    std::swap(last_input_, other.last_input_);
+    optimizer_ = other.optimizer_;
+    other.layers_.clear();
+}
+
+NeuralNetwork& NeuralNetwork::operator=(const NeuralNetwork& other) {
+    if (this != &other) {
+        *this = NeuralNetwork(other);
+    }
+    return *this;
+}
+
+NeuralNetwork& NeuralNetwork::operator=(NeuralNetwork&& other) {
+    if (this != &other) {
+        reset_sync();
+        other.reset_sync();
+        layers_ = std::move(other.layers_);
+        std::swap(last_input_, other.last_input_);
+        optimizer_ = other.optimizer_;
+        other.layers_.clear();
+    }
+    return *this;
+}
+
+NeuralNetwork::~NeuralNetwork() {
+    // Pending tasks finish before the layers are destroyed
+    if (sync_) {
+        sync_->async_queue.reset();
+    }
+}
+
+void NeuralNetwork::reset_sync() {
+    sync_->async_queue.reset();
+    sync_ = std::make_unique<SyncState>();
+}
 
 void NeuralNetwork::add_layer(size_t input_size, size_t output_size, ActivationType activation) {
     layers_.emplace_back(input_size, output_size, activation);
 }
 
+void NeuralNetwork::add_layer(Layer layer) {
+    if (!layers_.empty() && layers_.back().output_size() != layer.input_size()) {
+        throw std::invalid_argument("Layer input size must match the previous layer's output size");
+    }
+    layers_.push_back(std::move(layer));
+}
+
 Matrix NeuralNetwork::forward(const Matrix& input) {
-    Matrix current = input;
-    for (auto& layer : layers_) {
-        current = layer.forward(current);
+    std::lock_guard<std::mutex> lock(sync_->mutex);
+    ProfileScope scope("NeuralNetwork::forward");
+    if (layers_.empty()) {
+        return input;
+    }
+    // Each layer reads the previous layer's cached output in place; only
+    // the returned result is copied
+    const Matrix* current = &input;
+    for (size_t i = 0; i < layers_.size(); ++i) {
+        ProfileScope layer_scope("Layer::forward", 0.0, 0.0, static_cast<int64_t>(i));
+        current = &layers_[i].forward(*current);
+    }
+    ProfileScope copy_scope("NeuralNetwork::copy_output", 0.0, 8.0 * current->rows() * current->cols());
+    return *current;
+}
+
+const Matrix& NeuralNetwork::forward(const Matrix& input, InferenceContext& context) const {
+    ProfileScope scope("NeuralNetwork::forward");
+    if (layers_.empty()) {
+        // The output must live in context, never alias the caller's input
+        throw std::logic_error("Cannot run an empty network");
+    }
+    context.prepare(*this, input.rows());
+    const Matrix* current = &input;
+    for (size_t i = 0; i < layers_.size(); ++i) {
+        ProfileScope layer_scope("Layer::forward", 0.0, 0.0, static_cast<int64_t>(i));
+        layers_[i].forward(*current, context.activations_[i]);
+        current = &context.activations_[i];
+    }
+    return *current;
+}
+
+ConstMatrixView NeuralNetwork::forward(ConstMatrixView input, InferenceContext& context) const {
+    ProfileScope scope("NeuralNetwork::forward");
+    if (layers_.empty()) {
+        // The output must live in context, never alias the caller's input
+        throw std::logic_error("Cannot run an empty network");
+    }
+    context.prepare(*this, input.rows());
+    ConstMatrixView current = input;
+    for (size_t i = 0; i < layers_.size(); ++i) {
+        ProfileScope layer_scope("Layer::forward", 0.0, 0.0, static_cast<int64_t>(i));
+        layers_[i].forward(current, context.activations_[i].view());
+        current = context.activations_[i].view();
     }
     return current;
 }
 
+std::vector<Matrix> NeuralNetwork::forward_many(const std::vector<Matrix>& inputs) const {
+    if (inputs.empty()) {
+        return {};
+    }
+    size_t cols = inputs.front().cols();
+    size_t total_rows = 0;
+    for (const auto& input : inputs) {
+        if (input.cols() != cols) {
+            throw std::invalid_argument("All batched inputs must have the same number of columns");
+        }
+        total_rows += input.rows();
+    }
+
+    Matrix stacked(total_rows, cols, Matrix::Uninitialized{});
+    {
+        ProfileScope scope("forward_many::stack", 0.0, 8.0 * total_rows * cols);
+        float* dst = stacked.data();
+        for (const auto& input : inputs) {
+            std::memcpy(dst, input.data(), input.rows() * cols * sizeof(float));
+            dst += input.rows() * cols;
+        }
+    }
+
+    InferenceContext context;
+    const Matrix& output = forward(stacked, context);
+    ProfileScope scope("forward_many::split", 0.0, 8.0 * total_rows * output.cols());
+    std::vector<Matrix> results;
+    results.reserve(inputs.size());
+    const float* src = output.data();
+    for (const auto& input : inputs) {
+        results.emplace_back(input.rows(), output.cols(), Matrix::Uninitialized{});
+        std::memcpy(results.back().data(), src, input.rows() * output.cols() * sizeof(float));
+        src += input.rows() * output.cols();
+    }
+    return results;
+}
+
+std::shared_future<Matrix> NeuralNetwork::forward_async(const Matrix& input) {
+    SyncState& sync = *sync_;
+    std::call_once(sync.async_queue_started, [&sync] { sync.async_queue = std::make_unique<WorkQueue>(); });
+    // Copy constructs an owning matrix, so wrapped caller memory is not
+    // read after this returns
+    return sync.async_queue->enqueue([this, owned = Matrix(input)] { return forward(owned); }).share();
+}
+
+void NeuralNetwork::backward(const Matrix& expected, float learning_rate) {
+    std::lock_guard<std::mutex> lock(sync_->mutex);
+    ProfileScope scope("NeuralNetwork::backward");
+    if (layers_.empty()) {
+        throw std::logic_error("Cannot train an empty network");
+    }
+    const Matrix& output = layers_.back().get_last_output();
+    if (expected.rows() != output.rows() || expected.cols() != output.cols()) {
+        throw std::invalid_argument("Expected output dimensions must match network output");
+    }
+
+    // dL/dy = (y - t) / batch_size for L = 1/(2 * batch_size) * sum((y - t)^2)
+    Matrix gradient(output.rows(), output.cols(), Matrix::Uninitialized{});
+    float scale = 1.0f / static_cast<float>(output.rows());
+    const float* y = output.data();
+    const float* t = expected.data();
+    float* g = gradient.data();
+    for (size_t i = 0; i < output.rows() * output.cols(); ++i) {
+        g[i] = (y[i] - t[i]) * scale;
+    }
+
+    for (size_t i = layers_.size(); i-- > 0;) {
+        ProfileScope layer_scope("Layer::backward", 0.0, 0.0, static_cast<int64_t>(i));
+        gradient = layers_[i].backward(gradient);
+    }
+
+    OptimizerConfig config = optimizer_;
+    config.learning_rate = learning_rate;
+    for (size_t i = 0; i < layers_.size(); ++i) {
+        ProfileScope layer_scope("Layer::update_weights", 0.0, 0.0, static_cast<int64_t>(i));
+        layers_[i].update_weights(config);
+    }
+}
+
+float NeuralNetwork::mse_loss(const Matrix& output, const Matrix& expected) {
+    if (expected.rows() != output.rows() || expected.cols() != output.cols()) {
+        throw std::invalid_argument("Matrix dimensions must match");
+    }
+    double sum = 0.0;
+    const float* y = output.data();
+    const float* t = expected.data();
+    for (size_t i = 0; i < output.rows() * output.cols(); ++i) {
+        double d = static_cast<double>(y[i]) - t[i];
+        sum += d * d;
+    }
+    return static_cast<float>(sum / (2.0 * output.rows()));
+}
+
+size_t NeuralNetwork::sparsify(size_t block_rows, size_t block_cols, double max_density) {
+    std::lock_guard<std::mutex> lock(sync_->mutex);
+    size_t sparse = 0;
+    for (auto& layer : layers_) {
+        sparse += layer.sparsify(block_rows, block_cols, max_density) ? 1 : 0;
+    }
+    return sparse;
+}
+
+void NeuralNetwork::set_weight_precision(Precision precision) {
+    std::lock_guard<std::mutex> lock(sync_->mutex);
+    for (auto& layer : layers_) {
+        layer.set_weight_precision(precision);
+    }
+}
+
 } // namespace ml
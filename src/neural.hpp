@@ -1,16 +1,34 @@
 
 #pragma once
 #include "matrix.hpp"
-#include <functional>
+#include "activations.hpp"
+#include "aligned_allocator.hpp"
+#include "half.hpp"
+#include "sparse_matrix.hpp"
+#include "work_queue.hpp"
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <vector>
 
 namespace ml {
 
-// Enumeration of supported activation functions for neural network layers
-enum class ActivationType {
-    ReLU,    // Rectified Linear Unit f(x) = max(0,x) - Good for hidden layers
-    Sigmoid, // Logistic function f(x) = 1/(1+e^(-x)) - Good for binary classification
-    Tanh     // Hyperbolic tangent f(x) = tanh(x) - Alternative to sigmoid
+// Enumeration of supported weight update rules
+enum class OptimizerType {
+    SGD,      // Plain gradient descent
+    Momentum, // Gradient descent with a velocity term
+    Adam      // Adaptive moment estimation
+};
+
+// Hyperparameters for weight updates
+struct OptimizerConfig {
+    OptimizerType type = OptimizerType::SGD;
+    float learning_rate = 0.01f;
+    float momentum = 0.9f;   // Momentum only
+    float beta1 = 0.9f;      // Adam only: decay of the first moment
+    float beta2 = 0.999f;    // Adam only: decay of the second moment
+    float epsilon = 1e-8f;   // Adam only: denominator guard
 };
 
 // Layer class: Represents a single neural network layer
@@ -23,66 +41,283 @@ public:
     // activation: Type of activation function to use
     Layer(size_t input_size, size_t output_size, ActivationType activation);
 
-    // Compute layer output for given input
+    // Build a layer around existing parameters, e.g. views into a mapped
+    // model file (see model_io.hpp); no copy is made
+    // weights: input_size x output_size
+    // biases: 1 x output_size
+    // Throws std::invalid_argument if the shapes do not match
+    Layer(Matrix weights, Matrix biases, ActivationType activation);
+
+    // Build an inference-only layer around half-precision weights, see
+    // set_weight_precision()
+    // Throws std::invalid_argument if the shapes do not match
+    Layer(HalfMatrix weights, Matrix biases, ActivationType activation);
+
+    // Compute layer output for given input and cache it for backward()
+    // The cache buffers are reused while the batch size stays the same
     // input: Matrix of input values (batch_size x input_size)
-    // Returns: Matrix of output values (batch_size x output_size)
-    Matrix forward(const Matrix& input);
+    // Returns: Matrix of output values (batch_size x output_size), owned by
+    // the layer and valid until its next forward()
+    const Matrix& forward(const Matrix& input);
+
+    // Stateless forward: writes activation(input * weights + biases) into output
+    // Nothing is cached, so concurrent calls on one layer are safe
+    // input: Matrix of input values (batch_size x input_size)
+    // output: Preallocated batch_size x output_size matrix, overwritten
+    void forward(const Matrix& input, Matrix& output) const;
+
+    // Stateless forward on views, e.g. a row range of a larger batch
+    // input: batch_size x input_size view; its columns may be strided
+    // output: batch_size x output_size view with contiguous rows, overwritten
+    void forward(ConstMatrixView input, MatrixView output) const;
     
     // Compute gradients for backpropagation
-    // gradient: Gradient from next layer
-    // Returns: Gradient to pass to previous layer
+    // Uses the input and output cached by the last forward() call
+    // Stores dL/dW = input^T * delta and dL/db = column sums of delta, where
+    // delta = gradient * f'(output), using transposed GEMMs without copies
+    // gradient: Gradient from next layer (batch_size x output_size)
+    // Returns: Gradient to pass to previous layer (batch_size x input_size)
     Matrix backward(const Matrix& gradient);
     
     // Update layer weights using computed gradients
     // learning_rate: Step size for gradient descent
     void update_weights(float learning_rate);
 
+    // Update layer weights with the given optimizer
+    // Momentum/Adam state is allocated on first use and reset when the
+    // optimizer type changes
+    void update_weights(const OptimizerConfig& config);
+
+    // Update with gradients computed outside backward(), e.g. reduced across
+    // the workers of a DataParallelTrainer; shares the optimizer state above
+    // weight_gradients: input_size x output_size, row-major
+    // bias_gradients: output_size values
+    void update_weights(const OptimizerConfig& config, const float* weight_gradients,
+                        const float* bias_gradients);
+
     // Accessor methods for layer parameters
-    const Matrix& get_weights() const { return weights_; }  // Get weight matrix
+    // get_weights() throws std::logic_error while the weights are stored in
+    // half precision; get_half_weights() then holds them
+    const Matrix& get_weights() const;                     // Get weight matrix
     const Matrix& get_biases() const { return biases_; }   // Get bias vector
+    Matrix& get_weights();                                 // Mutable weight matrix
+    Matrix& get_biases() { return biases_; }                // Mutable bias vector
+    size_t input_size() const { return half_weights_ ? half_weights_->rows() : weights_->rows(); }
+    size_t output_size() const { return biases_.cols(); }
+    ActivationType get_activation() const { return activation_; }
+    const Matrix& get_last_output() const { return last_output_; } // Output of last forward()
+
+    // Gradients from the last backward() call
+    // Throws std::logic_error if backward() has not run yet
+    const Matrix& get_weight_gradients() const;
+    const Matrix& get_bias_gradients() const;
+
+    // Run forward() on the sparse kernels if the weights are sparse enough
+    // The weights are compressed into block_rows x block_cols blocks, which
+    // are kept when their stored fraction is at most max_density. The dense
+    // weights remain the copy used for training and saving: update_weights()
+    // drops the sparse copy, and edits made through get_weights() need
+    // another sparsify()
+    // Returns: Whether the layer now runs sparse
+    bool sparsify(size_t block_rows = 1, size_t block_cols = 8, double max_density = SPARSE_MAX_DENSITY);
+
+    // Sparse weights used by forward(), or nullptr when running dense
+    const SparseMatrix* get_sparse_weights() const { return sparse_weights_ ? &*sparse_weights_ : nullptr; }
+
+    // Drop the sparse copy so forward() runs the dense weights again
+    void densify() { sparse_weights_.reset(); }
+
+    // Store the weights as bfloat16 or float16, or widen them back to float
+    // Half-precision weights take half the memory and are widened inside the
+    // GEMM, which accumulates in float, so weight-bound inference reads half
+    // the bytes. The float weights, gradients, optimizer state and any sparse
+    // copy are released, which makes the layer inference-only: backward(),
+    // update_weights(), sparsify() and get_weights() throw std::logic_error
+    // until the precision is set back to Float32. Rounding is not undone by
+    // widening back
+    void set_weight_precision(Precision precision);
+    Precision get_weight_precision() const {
+        return half_weights_ ? half_weights_->precision() : Precision::Float32;
+    }
+
+    // Half-precision weights used by forward(), or nullptr when stored as float
+    const HalfMatrix* get_half_weights() const { return half_weights_ ? &*half_weights_ : nullptr; }
 
 private:
-    Matrix weights_;      // Weight matrix (input_size x output_size)
+    // Throws std::logic_error naming operation while the weights are half precision
+    void require_float_weights(const char* operation) const;
+
+    std::optional<Matrix> weights_; // Weight matrix (input_size x output_size), unset in half precision
+    std::optional<HalfMatrix> half_weights_; // Set by set_weight_precision()
     Matrix biases_;       // Bias vector (1 x output_size)
     Matrix last_input_;   // Cache of last input for backprop
     Matrix last_output_;  // Cache of last output for backprop
     ActivationType activation_; // Type of activation function
+    std::optional<SparseMatrix> sparse_weights_; // Set by sparsify()
+
+    // Gradient buffers, allocated by the first backward() so inference-only
+    // layers carry no extra memory
+    std::optional<Matrix> weight_gradients_; // dL/dW (input_size x output_size)
+    std::optional<Matrix> bias_gradients_;   // dL/db (1 x output_size)
+
+    // Per-parameter optimizer state
+    // Momentum keeps its velocity in the first-moment buffers
+    struct OptimizerState {
+        OptimizerType type;
+        Matrix weight_m; // First moment / velocity for weights
+        Matrix weight_v; // Second moment for weights (Adam)
+        Matrix bias_m;
+        Matrix bias_v;
+        size_t step;     // Number of updates applied (Adam bias correction)
+    };
+    std::optional<OptimizerState> optimizer_state_;
+};
+
+class NeuralNetwork;
 
-    // Helper functions for activation computations
-    // Returns function pointer to activation implementation
-    std::function<float(float)> get_activation_function() const;
-    // Returns function pointer to activation derivative
-    std::function<float(float)> get_activation_derivative() const;
+// InferenceContext class: Caller-owned workspace for stateless inference
+// On first use, and whenever the batch size or network shape changes, the
+// activation lifetimes are planned with plan_memory() and every layer output
+// is placed in one pooled arena, so a chain of layers runs in two ping-pong
+// buffers. Steady-state inference allocates nothing. A context serves one
+// call at a time; give each thread its own
+class InferenceContext {
+public:
+    InferenceContext() = default;
+
+    // Plan and allocate the arena for network at batch_size rows
+    InferenceContext(const NeuralNetwork& network, size_t batch_size);
+
+    // Batch size the arena is currently planned for (0 before first use)
+    size_t batch_size() const { return batch_size_; }
+
+    // Bytes reserved for activations (the arena only grows)
+    size_t arena_bytes() const { return arena_capacity_; }
+
+private:
+    friend class NeuralNetwork;
+
+    // Replan when the batch size or network shape changed
+    void prepare(const NeuralNetwork& network, size_t batch_size);
+
+    std::unique_ptr<float[], PoolDeleter> arena_;
+    size_t arena_capacity_ = 0;
+    std::vector<Matrix> activations_; // Output of each layer, wrapping the arena
+    size_t batch_size_ = 0;
 };
 
 // NeuralNetwork class: Manages multiple layers and network operations
+// forward() and backward() are serialized by an internal mutex, so a network
+// may be shared between threads; forward(input, context) and forward_many()
+// are stateless and run concurrently without locking
 class NeuralNetwork {
 public:
     // Create empty network ready for layer addition
     NeuralNetwork();
 
+    // Copies own their parameters: float weights, biases and optimizer state
+    // are copied, even when the original wraps a mapped model file; only
+    // half-precision weights, which are immutable, stay shared with the
+    // original (and its mapping). The copy starts with its own lock and no
+    // forward_async() queue. Moving and assigning first finish the
+    // forward_async() calls queued on the networks involved
+    // Neither may race with other calls on those networks
+    NeuralNetwork(const NeuralNetwork& other);
+    NeuralNetwork(NeuralNetwork&& other);
+    NeuralNetwork& operator=(const NeuralNetwork& other);
+    NeuralNetwork& operator=(NeuralNetwork&& other);
+    ~NeuralNetwork();
+
     // Add new layer to network
     // input_size: Number of inputs to layer
     // output_size: Number of outputs from layer
     // activation: Activation function type
     void add_layer(size_t input_size, size_t output_size, ActivationType activation);
+
+    // Append an existing layer
+    // Throws std::invalid_argument if its input size differs from the
+    // previous layer's output size
+    void add_layer(Layer layer);
     
     // Process input through all network layers
     // input: Input matrix (batch_size x input_size)
     // Returns: Output matrix (batch_size x output_size_of_last_layer)
     Matrix forward(const Matrix& input);
+
+    // Reentrant inference: reads the weights and writes only into context
+    // Any number of threads may run this concurrently on one network, each
+    // with its own context, as long as no thread trains or adds layers
+    // input: Input matrix (batch_size x input_size)
+    // context: Workspace receiving the activations
+    // Returns: The output, stored in context and valid until its next use
+    // Throws std::logic_error for an empty network
+    const Matrix& forward(const Matrix& input, InferenceContext& context) const;
+
+    // Reentrant inference on a view, so slices of a larger batch run without
+    // being copied into a matrix of their own
+    // input: Input view (batch_size x input_size)
+    // Returns: View of the output, stored in context and valid until its next use
+    // Throws std::logic_error for an empty network
+    ConstMatrixView forward(ConstMatrixView input, InferenceContext& context) const;
+
+    // Process several inputs as one batch
+    // The inputs are stacked row-wise and sent through a single stateless
+    // forward, so each layer runs one GEMM instead of one per input
+    // inputs: Matrices of equal width (row counts may differ)
+    // Returns: One output per input, in the same order
+    // Throws std::logic_error for an empty network
+    std::vector<Matrix> forward_many(const std::vector<Matrix>& inputs) const;
+
+    // Queue forward(input) on the network's background work queue
+    // input is copied first, so the caller may modify or release it at once
+    // Returns: Future holding the output, or the exception forward() threw
+    std::shared_future<Matrix> forward_async(const Matrix& input);
     
     // Train network using backpropagation
-    // expected: Expected output values
+    // Minimizes the mean squared error 1/(2 * batch_size) * sum((output - expected)^2)
+    // of the last forward() call, then updates every layer with the configured
+    // optimizer at the given learning rate
+    // expected: Expected output values (batch_size x output_size_of_last_layer)
     // learning_rate: Learning rate for weight updates
     void backward(const Matrix& expected, float learning_rate);
 
+    // Select the update rule used by backward(); defaults to plain SGD
+    void set_optimizer(const OptimizerConfig& config) { optimizer_ = config; }
+    const OptimizerConfig& get_optimizer() const { return optimizer_; }
+
+    // Loss minimized by backward()
+    static float mse_loss(const Matrix& output, const Matrix& expected);
+
+    // Layer::sparsify() every layer, e.g. after magnitude pruning
+    // Returns: Number of layers now running sparse
+    size_t sparsify(size_t block_rows = 1, size_t block_cols = 8, double max_density = SPARSE_MAX_DENSITY);
+
+    // Layer::set_weight_precision() every layer
+    // Half precision halves the weight memory and makes the network
+    // inference-only until it is set back to Float32
+    void set_weight_precision(Precision precision);
+
     // Get all network layers
     const std::vector<Layer>& get_layers() const { return layers_; }
+    std::vector<Layer>& get_layers() { return layers_; }
 
 private:
+    // Lock and forward_async() queue, kept behind a pointer so the network
+    // stays copyable and movable; every network owns its own
+    struct SyncState {
+        std::mutex mutex; // Serializes forward() and backward()
+        std::once_flag async_queue_started;
+        std::unique_ptr<WorkQueue> async_queue; // Started on first forward_async()
+    };
+
+    // Run the forward_async() calls still queued, whose tasks point at this
+    // network, then start over with a fresh lock and no queue
+    void reset_sync();
+
     std::vector<Layer> layers_; // Sequential storage of network layers
     Matrix last_input_;         // Cache of network input for training
+    OptimizerConfig optimizer_; // Update rule used by backward()
+    std::unique_ptr<SyncState> sync_;
 };
 
 } // namespace ml
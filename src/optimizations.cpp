@@ -1,70 +1,211 @@
-#include "optimizations.hpp"
+#include "cpu_dispatch.hpp"
+#include "float_vec.hpp"
+#include "thread_pool.hpp"
 #include <immintrin.h>
 #include <algorithm>
+#include <cmath>
+#include <stdexcept>
 
 namespace ml {
+namespace MLCPP_ISA {
 
-void simd_add(float* a, const float* b, size_t size) {
-    size_t i = 0;
+namespace {
 
-    // Process 8 elements at a time using AVX
-    for (; i + 7 < size; i += 8) {
-        __m256 va = _mm256_load_ps(&a[i]);
-        __m256 vb = _mm256_load_ps(&b[i]);
-        __m256 result = _mm256_add_ps(va, vb);
-        _mm256_store_ps(&a[i], result);
-    }
+constexpr size_t W = FloatVec::width;
 
+void add_range(float* a, const float* b, size_t size) {
+    size_t i = 0;
+    for (; i + W <= size; i += W) {
+        (FloatVec::load(a + i) + FloatVec::load(b + i)).store(a + i);
+    }
     // Process remaining elements
     for (; i < size; ++i) {
         a[i] += b[i];
     }
 }
 
-void simd_subtract(float* a, const float* b, size_t size) {
+void subtract_range(float* a, const float* b, size_t size) {
     size_t i = 0;
-
-    // Process 8 elements at a time using AVX
-    for (; i + 7 < size; i += 8) {
-        __m256 va = _mm256_load_ps(&a[i]);
-        __m256 vb = _mm256_load_ps(&b[i]);
-        __m256 result = _mm256_sub_ps(va, vb);
-        _mm256_store_ps(&a[i], result);
+    for (; i + W <= size; i += W) {
+        (FloatVec::load(a + i) - FloatVec::load(b + i)).store(a + i);
     }
-
     // Process remaining elements
     for (; i < size; ++i) {
         a[i] -= b[i];
     }
 }
 
-void block_multiply(float* result, const float* a, const float* b, size_t m, size_t n, size_t k) {
-    constexpr size_t BLOCK_SIZE = 32;
+// Grain of 16 floats keeps every chunk start on a 64-byte boundary
+constexpr size_t ELEMENTWISE_GRAIN = 16;
+
+// Run fn(begin, end) over [0, size), on the thread pool when size is large
+template <typename Fn>
+void elementwise_sweep(size_t size, Fn&& fn) {
+    if (size < PARALLEL_ELEMENTWISE_MIN) {
+        fn(size_t(0), size);
+        return;
+    }
+    ThreadPool::instance().parallel_range(size, ELEMENTWISE_GRAIN, fn);
+}
+
+template <ActivationType Act>
+void activation_backward_range(float* delta, const float* gradient, const float* output, size_t size) {
+    const FloatVec one = FloatVec::set1(1.0f);
+    size_t i = 0;
+    for (; i + W <= size; i += W) {
+        FloatVec g = FloatVec::load(gradient + i);
+        FloatVec y = FloatVec::load(output + i);
+        FloatVec d;
+        if constexpr (Act == ActivationType::ReLU) {
+            d = where_positive(y, g);
+        } else if constexpr (Act == ActivationType::Sigmoid) {
+            d = g * (y * (one - y));
+        } else {
+            d = g * (one - y * y);
+        }
+        d.store(delta + i);
+    }
+    for (; i < size; ++i) {
+        float y = output[i];
+        if constexpr (Act == ActivationType::ReLU) {
+            delta[i] = y > 0.0f ? gradient[i] : 0.0f;
+        } else if constexpr (Act == ActivationType::Sigmoid) {
+            delta[i] = gradient[i] * y * (1.0f - y);
+        } else {
+            delta[i] = gradient[i] * (1.0f - y * y);
+        }
+    }
+}
+
+template <ActivationType Act>
+void activation_backward_impl(float* delta, const float* gradient, const float* output, size_t size) {
+    elementwise_sweep(size, [&](size_t begin, size_t end) {
+        activation_backward_range<Act>(delta + begin, gradient + begin, output + begin, end - begin);
+    });
+}
+
+} // namespace
 
-    // Initialize result matrix to zero
-    std::fill_n(result, m * n, 0.0f);
+void simd_add(float* a, const float* b, size_t size) {
+    if (size < PARALLEL_ELEMENTWISE_MIN) {
+        add_range(a, b, size);
+        return;
+    }
+    ThreadPool::instance().parallel_range(size, ELEMENTWISE_GRAIN, [&](size_t begin, size_t end) {
+        add_range(a + begin, b + begin, end - begin);
+    });
+}
 
-    for (size_t i0 = 0; i0 < m; i0 += BLOCK_SIZE) {
-        size_t imax = std::min(i0 + BLOCK_SIZE, m);
+void simd_subtract(float* a, const float* b, size_t size) {
+    if (size < PARALLEL_ELEMENTWISE_MIN) {
+        subtract_range(a, b, size);
+        return;
+    }
+    ThreadPool::instance().parallel_range(size, ELEMENTWISE_GRAIN, [&](size_t begin, size_t end) {
+        subtract_range(a + begin, b + begin, end - begin);
+    });
+}
 
-        for (size_t j0 = 0; j0 < n; j0 += BLOCK_SIZE) {
-            size_t jmax = std::min(j0 + BLOCK_SIZE, n);
+void activation_backward(float* delta, const float* gradient, const float* output,
+                         size_t size, ActivationType activation) {
+    switch (activation) {
+        case ActivationType::ReLU:
+            activation_backward_impl<ActivationType::ReLU>(delta, gradient, output, size);
+            break;
+        case ActivationType::Sigmoid:
+            activation_backward_impl<ActivationType::Sigmoid>(delta, gradient, output, size);
+            break;
+        case ActivationType::Tanh:
+            activation_backward_impl<ActivationType::Tanh>(delta, gradient, output, size);
+            break;
+        default:
+            throw std::runtime_error("Unknown activation function");
+    }
+}
+
+void column_sum(float* result, const float* a, size_t rows, size_t cols) {
+    std::fill_n(result, cols, 0.0f);
+    // Row-wise accumulation keeps both streams contiguous
+    for (size_t i = 0; i < rows; ++i) {
+        const float* row = a + i * cols;
+        size_t j = 0;
+        for (; j + W <= cols; j += W) {
+            (FloatVec::load(result + j) + FloatVec::load(row + j)).store(result + j);
+        }
+        for (; j < cols; ++j) {
+            result[j] += row[j];
+        }
+    }
+}
 
-            for (size_t k0 = 0; k0 < k; k0 += BLOCK_SIZE) {
-                size_t kmax = std::min(k0 + BLOCK_SIZE, k);
+void sgd_update(float* params, const float* grads, size_t size, float learning_rate) {
+    elementwise_sweep(size, [&](size_t begin, size_t end) {
+        const FloatVec neg_lr = FloatVec::set1(-learning_rate);
+        size_t i = begin;
+        for (; i + W <= end; i += W) {
+            fmadd(neg_lr, FloatVec::load(grads + i), FloatVec::load(params + i)).store(params + i);
+        }
+        for (; i < end; ++i) {
+            params[i] -= learning_rate * grads[i];
+        }
+    });
+}
 
-                for (size_t i = i0; i < imax; ++i) {
-                    for (size_t j = j0; j < jmax; ++j) {
-                        float sum = 0.0f;
-                        for (size_t k1 = k0; k1 < kmax; ++k1) {
-                            sum += a[i * k + k1] * b[k1 * n + j];
-                        }
-                        result[i * n + j] += sum;
-                    }
-                }
-            }
+void momentum_update(float* params, const float* grads, float* velocity, size_t size,
+                     float learning_rate, float momentum) {
+    elementwise_sweep(size, [&](size_t begin, size_t end) {
+        const FloatVec neg_lr = FloatVec::set1(-learning_rate);
+        const FloatVec mu = FloatVec::set1(momentum);
+        size_t i = begin;
+        for (; i + W <= end; i += W) {
+            FloatVec vel = fmadd(mu, FloatVec::load(velocity + i), FloatVec::load(grads + i));
+            vel.store(velocity + i);
+            fmadd(neg_lr, vel, FloatVec::load(params + i)).store(params + i);
+        }
+        for (; i < end; ++i) {
+            velocity[i] = momentum * velocity[i] + grads[i];
+            params[i] -= learning_rate * velocity[i];
         }
+    });
+}
+
+void adam_update(float* params, const float* grads, float* m, float* v, size_t size,
+                 float learning_rate, float beta1, float beta2, float epsilon, size_t step) {
+    if (step == 0) {
+        throw std::invalid_argument("Adam step count starts at 1");
     }
+    // lr_t = lr * sqrt(1 - beta2^t) / (1 - beta1^t), epsilon scaled to match,
+    // so the corrected moments never have to be formed explicitly
+    double correction1 = 1.0 - std::pow(static_cast<double>(beta1), static_cast<double>(step));
+    double correction2 = 1.0 - std::pow(static_cast<double>(beta2), static_cast<double>(step));
+    float step_size = static_cast<float>(learning_rate * std::sqrt(correction2) / correction1);
+    float eps_hat = static_cast<float>(epsilon * std::sqrt(correction2));
+
+    elementwise_sweep(size, [&](size_t begin, size_t end) {
+        const FloatVec b1 = FloatVec::set1(beta1);
+        const FloatVec b2 = FloatVec::set1(beta2);
+        const FloatVec one_minus_b1 = FloatVec::set1(1.0f - beta1);
+        const FloatVec one_minus_b2 = FloatVec::set1(1.0f - beta2);
+        const FloatVec neg_step = FloatVec::set1(-step_size);
+        const FloatVec eps = FloatVec::set1(eps_hat);
+        size_t i = begin;
+        for (; i + W <= end; i += W) {
+            FloatVec g = FloatVec::load(grads + i);
+            FloatVec mi = fmadd(b1, FloatVec::load(m + i), one_minus_b1 * g);
+            FloatVec vi = fmadd(b2, FloatVec::load(v + i), one_minus_b2 * (g * g));
+            mi.store(m + i);
+            vi.store(v + i);
+            FloatVec update = mi / (sqrt(vi) + eps);
+            fmadd(neg_step, update, FloatVec::load(params + i)).store(params + i);
+        }
+        for (; i < end; ++i) {
+            float g = grads[i];
+            m[i] = beta1 * m[i] + (1.0f - beta1) * g;
+            v[i] = beta2 * v[i] + (1.0f - beta2) * g * g;
+            params[i] -= step_size * m[i] / (std::sqrt(v[i]) + eps_hat);
+        }
+    });
 }
 
-} // namespace ml
\ No newline at end of file
+} // namespace MLCPP_ISA
+} // namespace ml
@@ -1,38 +1,51 @@
 
 #pragma once
+#include "activations.hpp"
+#include "matrix_view.hpp"
 #include <cstddef>
 
 namespace ml {
 
 // All functions in this file implement SIMD (Single Instruction Multiple Data)
-// optimizations using AVX (Advanced Vector Extensions) instructions
-// Memory must be aligned to 32-byte boundaries for optimal performance
+// optimizations; each call runs the variant selected for the host CPU (see
+// cpu_dispatch.hpp), processing 4 (SSE), 8 (AVX2) or 16 (AVX-512) floats
+// per instruction
+// Buffers need only be float-aligned
 
 // Performs vectorized element-wise addition of two arrays
 // a: Destination array (will be modified)
 // b: Source array
 // size: Number of elements
-// Uses AVX __m256 to process 8 floats simultaneously
+// Arrays of PARALLEL_ELEMENTWISE_MIN elements or more are split across the thread pool
 void simd_add(float* a, const float* b, size_t size);
 
 // Performs vectorized element-wise subtraction of two arrays
 // a: Destination array (will be modified)
 // b: Source array to subtract
 // size: Number of elements
-// Uses AVX __m256 to process 8 floats simultaneously
+// Arrays of PARALLEL_ELEMENTWISE_MIN elements or more are split across the thread pool
 void simd_subtract(float* a, const float* b, size_t size);
 
-// Performs optimized matrix multiplication using AVX instructions
+// Element-wise a += b and a -= b on equally shaped strided views
+// Dense views take the flat kernels in one call and views with contiguous
+// rows one call per row; other layouts fall back to scalar loops
+// Throws std::invalid_argument if the shapes differ
+void simd_add(MatrixView a, ConstMatrixView b);
+void simd_subtract(MatrixView a, ConstMatrixView b);
+
+// Performs optimized matrix multiplication
 // result: Output matrix (m x n)
 // a: First input matrix (m x k)
 // b: Second input matrix (k x n)
 // m, n, k: Matrix dimensions
-// Uses AVX for vectorized multiply-add operations
+// Runs the packed GEMM engine from gemm.hpp
 void simd_multiply(float* result, const float* a, const float* b, 
                   size_t m, size_t n, size_t k);
 
 // Implements cache-friendly block matrix multiplication
 // Improves cache utilization by operating on small blocks that fit in L1/L2 cache
+// Block sizes are derived from the detected cache hierarchy (see gemm_blocking)
+// Large products are partitioned into M/N macro-tiles across the thread pool
 // result: Output matrix (m x n)
 // a: First input matrix (m x k)
 // b: Second input matrix (k x n)
@@ -40,4 +53,41 @@ void simd_multiply(float* result, const float* a, const float* b,
 void block_multiply(float* result, const float* a, const float* b, 
                    size_t m, size_t n, size_t k);
 
+// Training kernels
+// Each walks its buffers exactly once and splits large arrays across the
+// thread pool like simd_add; unaligned pointers are accepted
+
+// Backpropagates through an activation using the cached layer output
+// delta: Output, delta[i] = gradient[i] * f'(x_i) expressed through y_i = f(x_i)
+//        (ReLU: y > 0, Sigmoid: y * (1 - y), Tanh: 1 - y^2)
+// gradient: Gradient of the loss with respect to the layer output
+// output: Activated layer output from the forward pass
+// size: Number of elements
+void activation_backward(float* delta, const float* gradient, const float* output,
+                         size_t size, ActivationType activation);
+
+// activation_backward on equally shaped strided views
+// Throws std::invalid_argument if the shapes differ
+void activation_backward(MatrixView delta, ConstMatrixView gradient, ConstMatrixView output,
+                         ActivationType activation);
+
+// Sums the rows of a row-major matrix (used for bias gradients)
+// result: Output vector of cols elements
+// a: Input matrix (rows x cols)
+void column_sum(float* result, const float* a, size_t rows, size_t cols);
+
+// Plain gradient descent: params -= learning_rate * grads
+void sgd_update(float* params, const float* grads, size_t size, float learning_rate);
+
+// Gradient descent with momentum
+// velocity = momentum * velocity + grads; params -= learning_rate * velocity
+void momentum_update(float* params, const float* grads, float* velocity, size_t size,
+                     float learning_rate, float momentum);
+
+// Adam update (Kingma & Ba) with bias correction folded into the step size
+// m, v: First and second moment estimates, updated in place
+// step: 1-based update count used for bias correction
+void adam_update(float* params, const float* grads, float* m, float* v, size_t size,
+                 float learning_rate, float beta1, float beta2, float epsilon, size_t step);
+
 } // namespace ml
@@ -0,0 +1,366 @@
+#include "profiler.hpp"
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+namespace ml {
+
+namespace detail {
+std::atomic<bool> g_profiling_enabled{false};
+}
+
+namespace {
+
+std::atomic<bool> g_hardware_counters{false};
+
+// Bumped by reset_profile(); threads start a fresh log when it changes
+std::atomic<uint64_t> g_generation{0};
+
+std::atomic<uint64_t> g_dropped{0};
+
+int64_t now_ns() {
+    using Clock = std::chrono::steady_clock;
+    static const Clock::time_point epoch = Clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - epoch).count();
+}
+
+// User-space cycle and instruction counters of the calling thread, read
+// together as one perf event group
+class HardwareCounters {
+public:
+    ~HardwareCounters() {
+        if (instructions_fd_ >= 0) {
+            close(instructions_fd_);
+        }
+        if (cycles_fd_ >= 0) {
+            close(cycles_fd_);
+        }
+    }
+
+    // Opens the counters on first use; false when the kernel refuses them
+    bool read(uint64_t& cycles, uint64_t& instructions) {
+        if (!opened_) {
+            open();
+        }
+        if (cycles_fd_ < 0) {
+            return false;
+        }
+        struct {
+            uint64_t count;
+            uint64_t values[2];
+        } group;
+        if (::read(cycles_fd_, &group, sizeof(group)) != static_cast<ssize_t>(sizeof(group))) {
+            return false;
+        }
+        cycles = group.values[0];
+        instructions = group.values[1];
+        return true;
+    }
+
+    bool available() {
+        if (!opened_) {
+            open();
+        }
+        return cycles_fd_ >= 0;
+    }
+
+private:
+    static int open_counter(uint64_t config, int group_fd) {
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = config;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0));
+    }
+
+    void open() {
+        opened_ = true;
+        cycles_fd_ = open_counter(PERF_COUNT_HW_CPU_CYCLES, -1);
+        if (cycles_fd_ < 0) {
+            return;
+        }
+        instructions_fd_ = open_counter(PERF_COUNT_HW_INSTRUCTIONS, cycles_fd_);
+        if (instructions_fd_ < 0) {
+            close(cycles_fd_);
+            cycles_fd_ = -1;
+        }
+    }
+
+    bool opened_ = false;
+    int cycles_fd_ = -1;
+    int instructions_fd_ = -1;
+};
+
+// Fixed-size block of a thread's log; blocks never move once published
+struct EventChunk {
+    static constexpr size_t CAPACITY = 4096;
+    ProfileEvent events[CAPACITY];
+    std::atomic<size_t> count{0};
+    std::atomic<EventChunk*> next{nullptr};
+};
+
+// Events of one thread for one generation
+// Only the owning thread appends; readers see every event published by the
+// release store of its chunk's count
+class ThreadLog {
+public:
+    ThreadLog(uint32_t thread, uint64_t generation) : thread_(thread), generation_(generation) {}
+
+    ~ThreadLog() {
+        EventChunk* chunk = head_.next.load(std::memory_order_relaxed);
+        while (chunk) {
+            EventChunk* next = chunk->next.load(std::memory_order_relaxed);
+            delete chunk;
+            chunk = next;
+        }
+    }
+
+    uint64_t generation() const { return generation_; }
+
+    void append(ProfileEvent event) {
+        if (recorded_ >= PROFILE_MAX_EVENTS_PER_THREAD) {
+            g_dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        size_t count = tail_->count.load(std::memory_order_relaxed);
+        if (count == EventChunk::CAPACITY) {
+            auto* chunk = new EventChunk;
+            tail_->next.store(chunk, std::memory_order_release);
+            tail_ = chunk;
+            count = 0;
+        }
+        event.thread = thread_;
+        tail_->events[count] = event;
+        tail_->count.store(count + 1, std::memory_order_release);
+        ++recorded_;
+    }
+
+    void collect(std::vector<ProfileEvent>& out) const {
+        for (const EventChunk* chunk = &head_; chunk; chunk = chunk->next.load(std::memory_order_acquire)) {
+            size_t count = chunk->count.load(std::memory_order_acquire);
+            out.insert(out.end(), chunk->events, chunk->events + count);
+        }
+    }
+
+private:
+    uint32_t thread_;
+    uint64_t generation_;
+    EventChunk head_;
+    EventChunk* tail_ = &head_;
+    size_t recorded_ = 0;
+};
+
+// Logs of every thread that recorded since the last reset
+// The mutex is taken when a thread starts a log, never per event
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::shared_ptr<ThreadLog>> logs;
+    uint32_t next_thread = 0;
+};
+
+Registry& registry() {
+    // Leaked so that threads finishing during static destruction still
+    // find it
+    static Registry* instance = new Registry;
+    return *instance;
+}
+
+struct ThreadState {
+    std::shared_ptr<ThreadLog> log;
+    HardwareCounters counters;
+    uint32_t thread = 0;
+    bool numbered = false;
+};
+
+ThreadState& thread_state() {
+    thread_local ThreadState state;
+    return state;
+}
+
+ThreadLog& thread_log() {
+    ThreadState& state = thread_state();
+    uint64_t generation = g_generation.load(std::memory_order_acquire);
+    if (!state.log || state.log->generation() != generation) {
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        if (!state.numbered) {
+            state.thread = reg.next_thread++;
+            state.numbered = true;
+        }
+        state.log = std::make_shared<ThreadLog>(state.thread, generation);
+        reg.logs.push_back(state.log);
+    }
+    return *state.log;
+}
+
+// Minimal JSON string escaping for scope names
+void append_json_string(std::string& out, const char* text) {
+    out += '"';
+    for (const char* c = text; *c; ++c) {
+        if (*c == '"' || *c == '\\') {
+            out += '\\';
+        }
+        out += *c;
+    }
+    out += '"';
+}
+
+} // namespace
+
+void ProfileScope::begin(const char* name, double flops, double bytes, int64_t index) {
+    event_ = ProfileEvent{name, index, 0, 0, flops, bytes, 0, 0, 0};
+    if (g_hardware_counters.load(std::memory_order_relaxed)) {
+        counted_ = thread_state().counters.read(event_.cycles, event_.instructions);
+    }
+    active_ = true;
+    // Read the clock last so the counter system call is not timed
+    event_.start_ns = now_ns();
+}
+
+void ProfileScope::end() {
+    event_.duration_ns = now_ns() - event_.start_ns;
+    uint64_t cycles = 0;
+    uint64_t instructions = 0;
+    if (counted_ && thread_state().counters.read(cycles, instructions)) {
+        event_.cycles = cycles - event_.cycles;
+        event_.instructions = instructions - event_.instructions;
+    } else {
+        event_.cycles = 0;
+        event_.instructions = 0;
+    }
+    thread_log().append(event_);
+}
+
+void set_profiling(bool enabled, bool hardware_counters) {
+    g_hardware_counters.store(enabled && hardware_counters, std::memory_order_relaxed);
+    detail::g_profiling_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool hardware_counters_available() {
+    return thread_state().counters.available();
+}
+
+void reset_profile() {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.logs.clear();
+    g_generation.fetch_add(1, std::memory_order_release);
+    g_dropped.store(0, std::memory_order_relaxed);
+}
+
+std::vector<ProfileEvent> profile_events() {
+    std::vector<std::shared_ptr<ThreadLog>> logs;
+    {
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        logs = reg.logs;
+    }
+    std::vector<ProfileEvent> events;
+    for (const auto& log : logs) {
+        log->collect(events);
+    }
+    // A scope is appended when it ends, so nested scopes precede their parent
+    std::stable_sort(events.begin(), events.end(), [](const ProfileEvent& a, const ProfileEvent& b) {
+        return a.thread != b.thread ? a.thread < b.thread : a.start_ns < b.start_ns;
+    });
+    return events;
+}
+
+uint64_t profile_dropped_events() {
+    return g_dropped.load(std::memory_order_relaxed);
+}
+
+std::vector<ProfileStats> profile_summary() {
+    std::map<std::pair<std::string, int64_t>, ProfileStats> totals;
+    for (const ProfileEvent& event : profile_events()) {
+        ProfileStats& stats = totals[{event.name, event.index}];
+        if (stats.calls == 0) {
+            stats.name = event.name;
+            if (event.index >= 0) {
+                stats.name += "[" + std::to_string(event.index) + "]";
+            }
+            stats.min_ns = event.duration_ns;
+            stats.max_ns = event.duration_ns;
+        }
+        ++stats.calls;
+        stats.total_ns += event.duration_ns;
+        stats.min_ns = std::min(stats.min_ns, event.duration_ns);
+        stats.max_ns = std::max(stats.max_ns, event.duration_ns);
+        stats.flops += event.flops;
+        stats.bytes += event.bytes;
+        stats.cycles += event.cycles;
+        stats.instructions += event.instructions;
+    }
+
+    std::vector<ProfileStats> summary;
+    summary.reserve(totals.size());
+    for (auto& entry : totals) {
+        summary.push_back(std::move(entry.second));
+    }
+    std::sort(summary.begin(), summary.end(), [](const ProfileStats& a, const ProfileStats& b) {
+        return a.total_ns > b.total_ns;
+    });
+    return summary;
+}
+
+std::string chrome_trace() {
+    std::vector<ProfileEvent> events = profile_events();
+    long pid = static_cast<long>(getpid());
+    std::string out = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    char buffer[256];
+    uint32_t named_threads = 0;
+    bool first = true;
+    for (const ProfileEvent& event : events) {
+        if (!first) {
+            out += ',';
+        }
+        first = false;
+        // Events are grouped by thread, so each thread is named once
+        if (event.thread + 1 > named_threads) {
+            named_threads = event.thread + 1;
+            std::snprintf(buffer, sizeof(buffer),
+                          "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%ld,\"tid\":%u,"
+                          "\"args\":{\"name\":\"mlcpp thread %u\"}},",
+                          pid, event.thread, event.thread);
+            out += buffer;
+        }
+        out += "{\"name\":";
+        append_json_string(out, event.name);
+        std::snprintf(buffer, sizeof(buffer),
+                      ",\"cat\":\"mlcpp\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%ld,\"tid\":%u,"
+                      "\"args\":{\"index\":%lld,\"flops\":%.0f,\"bytes\":%.0f,"
+                      "\"cycles\":%llu,\"instructions\":%llu}}",
+                      event.start_ns / 1e3, event.duration_ns / 1e3, pid, event.thread,
+                      static_cast<long long>(event.index), event.flops, event.bytes,
+                      static_cast<unsigned long long>(event.cycles),
+                      static_cast<unsigned long long>(event.instructions));
+        out += buffer;
+    }
+    out += "]}";
+    return out;
+}
+
+void write_chrome_trace(const std::string& path) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Cannot open trace file: " + path);
+    }
+    file << chrome_trace();
+    if (!file) {
+        throw std::runtime_error("Failed to write trace file: " + path);
+    }
+}
+
+} // namespace ml
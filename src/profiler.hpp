@@ -0,0 +1,117 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ml {
+
+// Built-in hot-path profiler
+// Kernels and network phases open a ProfileScope; while profiling is enabled
+// each scope records its wall time, FLOP and byte counts and, optionally,
+// user-space cycles and instructions from perf_event_open. Events go to an
+// append-only log owned by the recording thread, so recording takes no locks.
+// While profiling is disabled a scope costs one relaxed atomic load
+
+// One recorded scope
+struct ProfileEvent {
+    const char* name;      // Static string naming the scope
+    int64_t index;         // Layer or item index, -1 when unused
+    int64_t start_ns;      // Start, relative to the profiler epoch
+    int64_t duration_ns;
+    double flops;          // Floating-point operations done by the scope
+    double bytes;          // Bytes the scope reads and writes
+    uint64_t cycles;       // Hardware counters, 0 unless enabled and available
+    uint64_t instructions;
+    uint32_t thread;       // Profiler-assigned thread number
+};
+
+// Aggregate of every event with the same name and index
+struct ProfileStats {
+    std::string name;      // Scope name, with "[index]" appended when indexed
+    uint64_t calls = 0;
+    int64_t total_ns = 0;  // Inclusive of nested scopes
+    int64_t min_ns = 0;
+    int64_t max_ns = 0;
+    double flops = 0.0;
+    double bytes = 0.0;
+    uint64_t cycles = 0;
+    uint64_t instructions = 0;
+};
+
+namespace detail {
+extern std::atomic<bool> g_profiling_enabled;
+}
+
+// Whether scopes are currently being recorded
+inline bool profiling_enabled() {
+    return detail::g_profiling_enabled.load(std::memory_order_relaxed);
+}
+
+// Turn recording on or off for all threads
+// hardware_counters: Also read cycles and instructions around every scope
+//                    (one system call each); silently unavailable when the
+//                    kernel forbids perf_event_open
+void set_profiling(bool enabled, bool hardware_counters = false);
+
+// Whether the calling thread could open the hardware counters
+bool hardware_counters_available();
+
+// Drop every recorded event
+// Safe while other threads record; events they finish concurrently may land
+// in the discarded log
+void reset_profile();
+
+// All recorded events, ordered by thread and then start time
+std::vector<ProfileEvent> profile_events();
+
+// Per-scope totals, slowest first
+std::vector<ProfileStats> profile_summary();
+
+// Maximum events kept per thread between resets
+constexpr size_t PROFILE_MAX_EVENTS_PER_THREAD = size_t(1) << 18;
+
+// Number of events discarded since the last reset because their thread had
+// already recorded PROFILE_MAX_EVENTS_PER_THREAD
+uint64_t profile_dropped_events();
+
+// Recorded events in the Chrome trace event format, viewable in
+// chrome://tracing or https://ui.perfetto.dev
+std::string chrome_trace();
+
+// Write chrome_trace() to path
+// Throws std::runtime_error when the file cannot be written
+void write_chrome_trace(const std::string& path);
+
+// ProfileScope class: Records the enclosing block as one event
+// name: Static string; it is stored by pointer
+// flops, bytes: Work done by the block, used for GFLOP/s and GB/s
+// index: Distinguishes repeated scopes such as layers (-1 for none)
+class ProfileScope {
+public:
+    explicit ProfileScope(const char* name, double flops = 0.0, double bytes = 0.0, int64_t index = -1) {
+        if (profiling_enabled()) {
+            begin(name, flops, bytes, index);
+        }
+    }
+
+    ~ProfileScope() {
+        if (active_) {
+            end();
+        }
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    void begin(const char* name, double flops, double bytes, int64_t index);
+    void end();
+
+    bool active_ = false;
+    bool counted_ = false; // Hardware counters were read at the start
+    ProfileEvent event_;
+};
+
+} // namespace ml
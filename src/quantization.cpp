@@ -0,0 +1,163 @@
+#include "quantization.hpp"
+#include "int8_gemm.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <optional>
+#include <stdexcept>
+
+namespace ml {
+
+QuantizedLayer::QuantizedLayer(const Layer& layer)
+    : input_size_(layer.input_size())
+    , output_size_(layer.output_size())
+    , activation_(layer.get_activation())
+    , packed_bytes_(int8_packed_size(input_size_, output_size_))
+    , packed_weights_(static_cast<int8_t*>(pool_allocate(packed_bytes_)), PoolDeleter{packed_bytes_})
+    , weight_scales_(output_size_)
+    , column_sums_(output_size_, 0)
+    , biases_(layer.get_biases()) {
+    // Half-precision layers are quantized from their widened weights
+    std::optional<Matrix> widened;
+    if (const HalfMatrix* half = layer.get_half_weights()) {
+        widened.emplace(half->to_float());
+    }
+    const Matrix& weights = widened ? *widened : layer.get_weights();
+
+    for (size_t j = 0; j < output_size_; ++j) {
+        float max_abs = 0.0f;
+        for (size_t i = 0; i < input_size_; ++i) {
+            max_abs = std::max(max_abs, std::abs(weights.at(i, j)));
+        }
+        weight_scales_[j] = max_abs > 0.0f ? max_abs / static_cast<float>(INT8_WEIGHT_MAX) : 1.0f;
+    }
+
+    std::vector<int8_t> quantized(input_size_ * output_size_);
+    for (size_t i = 0; i < input_size_; ++i) {
+        for (size_t j = 0; j < output_size_; ++j) {
+            long q = std::lrint(weights.at(i, j) / weight_scales_[j]);
+            q = std::clamp<long>(q, -INT8_WEIGHT_MAX, INT8_WEIGHT_MAX);
+            quantized[i * output_size_ + j] = static_cast<int8_t>(q);
+            column_sums_[j] += static_cast<int32_t>(q);
+        }
+    }
+    pack_int8_weights(packed_weights_.get(), quantized.data(), input_size_, output_size_);
+}
+
+void QuantizedLayer::forward(const Matrix& input, Matrix& output) const {
+    if (input.cols() != input_size_) {
+        throw std::invalid_argument("Invalid matrix dimensions for multiplication");
+    }
+    if (output.rows() != input.rows() || output.cols() != output_size_) {
+        throw std::invalid_argument("Output dimensions must be batch_size x output_size");
+    }
+    size_t m = input.rows();
+    size_t qa_bytes = m * int8_padded_depth(input_size_);
+    std::unique_ptr<uint8_t[], PoolDeleter> qa(static_cast<uint8_t*>(pool_allocate(qa_bytes)),
+                                               PoolDeleter{qa_bytes});
+    std::vector<float> scales(m);
+    std::vector<int32_t> zero_points(m);
+    quantize_rows(qa.get(), scales.data(), zero_points.data(), input.data(), m, input_size_);
+
+    int8_gemm_bias_activation(output.data(), qa.get(), scales.data(), zero_points.data(),
+                              packed_weights_.get(), column_sums_.data(), weight_scales_.data(),
+                              biases_.data(), m, output_size_, input_size_, activation_);
+}
+
+Matrix QuantizedLayer::dequantized_weights() const {
+    // Read each value back out of the packed layout
+    Matrix weights(input_size_, output_size_, Matrix::Uninitialized{});
+    size_t kp = int8_padded_depth(input_size_);
+    for (size_t i = 0; i < input_size_; ++i) {
+        for (size_t j = 0; j < output_size_; ++j) {
+            size_t block = j / INT8_GEMM_NR;
+            size_t offset = block * kp * INT8_GEMM_NR + (i / 4) * 4 * INT8_GEMM_NR
+                          + (j % INT8_GEMM_NR) * 4 + i % 4;
+            weights.at(i, j) = packed_weights_[offset] * weight_scales_[j];
+        }
+    }
+    return weights;
+}
+
+size_t QuantizedLayer::weight_bytes() const {
+    return packed_bytes_ + weight_scales_.size() * sizeof(float)
+         + column_sums_.size() * sizeof(int32_t) + output_size_ * sizeof(float);
+}
+
+QuantizedNetwork::QuantizedNetwork(const NeuralNetwork& network) {
+    layers_.reserve(network.get_layers().size());
+    for (const auto& layer : network.get_layers()) {
+        layers_.emplace_back(layer);
+    }
+}
+
+Matrix QuantizedNetwork::forward(const Matrix& input) const {
+    ProfileScope scope("QuantizedNetwork::forward");
+    if (layers_.empty()) {
+        return input;
+    }
+    Matrix current(input.rows(), layers_.front().output_size(), Matrix::Uninitialized{});
+    {
+        ProfileScope layer_scope("QuantizedLayer::forward", 0.0, 0.0, 0);
+        layers_.front().forward(input, current);
+    }
+    for (size_t i = 1; i < layers_.size(); ++i) {
+        ProfileScope layer_scope("QuantizedLayer::forward", 0.0, 0.0, static_cast<int64_t>(i));
+        Matrix next(input.rows(), layers_[i].output_size(), Matrix::Uninitialized{});
+        layers_[i].forward(current, next);
+        current = std::move(next);
+    }
+    return current;
+}
+
+size_t QuantizedNetwork::weight_bytes() const {
+    size_t bytes = 0;
+    for (const auto& layer : layers_) {
+        bytes += layer.weight_bytes();
+    }
+    return bytes;
+}
+
+QuantizationReport evaluate_quantization(const NeuralNetwork& reference,
+                                         const QuantizedNetwork& quantized,
+                                         const Matrix& input) {
+    InferenceContext context;
+    const Matrix& expected = reference.forward(input, context);
+    Matrix actual = quantized.forward(input);
+    if (actual.rows() != expected.rows() || actual.cols() != expected.cols()) {
+        throw std::invalid_argument("Quantized network does not match the reference network shape");
+    }
+
+    QuantizationReport report;
+    double abs_sum = 0.0;
+    double error_squares = 0.0;
+    double reference_squares = 0.0;
+    size_t agreeing_rows = 0;
+    for (size_t i = 0; i < expected.rows(); ++i) {
+        size_t expected_best = 0;
+        size_t actual_best = 0;
+        for (size_t j = 0; j < expected.cols(); ++j) {
+            double diff = static_cast<double>(actual.at(i, j)) - expected.at(i, j);
+            report.max_abs_error = std::max(report.max_abs_error, static_cast<float>(std::abs(diff)));
+            abs_sum += std::abs(diff);
+            error_squares += diff * diff;
+            reference_squares += static_cast<double>(expected.at(i, j)) * expected.at(i, j);
+            expected_best = expected.at(i, j) > expected.at(i, expected_best) ? j : expected_best;
+            actual_best = actual.at(i, j) > actual.at(i, actual_best) ? j : actual_best;
+        }
+        agreeing_rows += expected_best == actual_best;
+    }
+    size_t count = expected.rows() * expected.cols();
+    report.mean_abs_error = static_cast<float>(abs_sum / count);
+    report.relative_rms_error = reference_squares > 0.0
+        ? static_cast<float>(std::sqrt(error_squares / reference_squares)) : 0.0f;
+    report.top1_agreement = static_cast<float>(agreeing_rows) / static_cast<float>(expected.rows());
+
+    for (const auto& layer : reference.get_layers()) {
+        report.float_weight_bytes += (layer.input_size() + 1) * layer.output_size() * sizeof(float);
+    }
+    report.quantized_weight_bytes = quantized.weight_bytes();
+    return report;
+}
+
+} // namespace ml
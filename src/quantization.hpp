@@ -0,0 +1,88 @@
+#pragma once
+#include "neural.hpp"
+#include "aligned_allocator.hpp"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace ml {
+
+// QuantizedLayer class: Inference-only int8 counterpart of Layer
+// Weights are quantized symmetrically per output channel (zero point 0,
+// scale = max |w| / 127) and packed once for the int8 GEMM. Activations are
+// quantized per row at every call (dynamic quantization), so each row's
+// result does not depend on the other rows of the batch
+class QuantizedLayer {
+public:
+    // Quantize the weights of a trained float layer; biases stay float
+    explicit QuantizedLayer(const Layer& layer);
+
+    // Stateless forward: output = activation(input * weights + biases)
+    // input: Matrix of input values (batch_size x input_size)
+    // output: Preallocated batch_size x output_size matrix, overwritten
+    void forward(const Matrix& input, Matrix& output) const;
+
+    size_t input_size() const { return input_size_; }
+    size_t output_size() const { return output_size_; }
+    ActivationType get_activation() const { return activation_; }
+
+    // Per-output-channel weight scales; weight zero points are all 0
+    const std::vector<float>& get_weight_scales() const { return weight_scales_; }
+
+    // Float weights reconstructed from the int8 values (input_size x output_size)
+    Matrix dequantized_weights() const;
+
+    // Bytes of packed int8 weights, per-channel scales, column sums and biases
+    size_t weight_bytes() const;
+
+private:
+    size_t input_size_;
+    size_t output_size_;
+    ActivationType activation_;
+    size_t packed_bytes_;
+    std::unique_ptr<int8_t[], PoolDeleter> packed_weights_; // pack_int8_weights layout
+    std::vector<float> weight_scales_;  // Scale of each output channel
+    std::vector<int32_t> column_sums_;  // Sum of each int8 weight column
+    Matrix biases_;                     // Bias vector (1 x output_size)
+};
+
+// QuantizedNetwork class: Int8 copy of a trained NeuralNetwork for inference
+// forward() is const and allocates only its scratch buffers, so one instance
+// may be shared by many threads
+class QuantizedNetwork {
+public:
+    // Quantize every layer of network
+    explicit QuantizedNetwork(const NeuralNetwork& network);
+
+    // Process input through all quantized layers
+    // input: Input matrix (batch_size x input_size)
+    // Returns: Output matrix (batch_size x output_size_of_last_layer)
+    Matrix forward(const Matrix& input) const;
+
+    const std::vector<QuantizedLayer>& get_layers() const { return layers_; }
+
+    // Total weight_bytes() of all layers
+    size_t weight_bytes() const;
+
+private:
+    std::vector<QuantizedLayer> layers_;
+};
+
+// Accuracy of a quantized network measured against its float original
+struct QuantizationReport {
+    float max_abs_error = 0;     // Largest |float output - quantized output|
+    float mean_abs_error = 0;    // Mean of the same differences
+    float relative_rms_error = 0; // RMS of the differences / RMS of the float outputs
+    float top1_agreement = 0;    // Fraction of rows whose largest output is in the same column
+    size_t float_weight_bytes = 0;     // Float weights and biases
+    size_t quantized_weight_bytes = 0; // Int8 weights, scales, column sums and biases
+};
+
+// Run input through both networks and compare their outputs
+// reference: The float network that quantized was built from
+// input: Representative inputs (batch_size x input_size)
+QuantizationReport evaluate_quantization(const NeuralNetwork& reference,
+                                         const QuantizedNetwork& quantized,
+                                         const Matrix& input);
+
+} // namespace ml
@@ -0,0 +1,76 @@
+#include "sparse_matrix.hpp"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace ml {
+
+SparseMatrix::SparseMatrix(const Matrix& dense, size_t block_rows, size_t block_cols)
+    : rows_(dense.rows()), cols_(dense.cols()), block_rows_(block_rows), block_cols_(block_cols) {
+    if (block_rows == 0 || block_cols == 0) {
+        throw std::invalid_argument("Sparse block dimensions must be positive");
+    }
+    size_t row_blocks = (rows_ + block_rows - 1) / block_rows;
+    size_t col_blocks = (cols_ + block_cols - 1) / block_cols;
+    if (col_blocks > std::numeric_limits<uint32_t>::max()) {
+        throw std::invalid_argument("Too many block columns for a sparse matrix");
+    }
+
+    row_offsets_.reserve(row_blocks + 1);
+    for (size_t rb = 0; rb < row_blocks; ++rb) {
+        size_t r0 = rb * block_rows;
+        size_t r1 = std::min(r0 + block_rows, rows_);
+        for (size_t cb = 0; cb < col_blocks; ++cb) {
+            size_t c0 = cb * block_cols;
+            size_t c1 = std::min(c0 + block_cols, cols_);
+            bool nonzero = false;
+            for (size_t i = r0; i < r1 && !nonzero; ++i) {
+                for (size_t j = c0; j < c1 && !nonzero; ++j) {
+                    nonzero = dense.data()[i * cols_ + j] != 0.0f;
+                }
+            }
+            if (!nonzero) {
+                continue;
+            }
+            block_columns_.push_back(static_cast<uint32_t>(cb));
+            for (size_t i = r0; i < r0 + block_rows; ++i) {
+                for (size_t j = c0; j < c0 + block_cols; ++j) {
+                    values_.push_back(i < r1 && j < c1 ? dense.data()[i * cols_ + j] : 0.0f);
+                }
+            }
+        }
+        row_offsets_.push_back(block_columns_.size());
+    }
+}
+
+double SparseMatrix::density() const {
+    if (rows_ == 0 || cols_ == 0) {
+        return 0.0;
+    }
+    return static_cast<double>(values_.size()) / (static_cast<double>(rows_) * cols_);
+}
+
+size_t SparseMatrix::memory_bytes() const {
+    return values_.size() * sizeof(float) + block_columns_.size() * sizeof(uint32_t) +
+           row_offsets_.size() * sizeof(size_t);
+}
+
+Matrix SparseMatrix::to_dense() const {
+    Matrix dense(rows_, cols_);
+    size_t block_size = block_rows_ * block_cols_;
+    for (size_t rb = 0; rb + 1 < row_offsets_.size(); ++rb) {
+        for (size_t q = row_offsets_[rb]; q < row_offsets_[rb + 1]; ++q) {
+            const float* block = values_.data() + q * block_size;
+            size_t r0 = rb * block_rows_;
+            size_t c0 = block_columns_[q] * block_cols_;
+            for (size_t i = 0; i < block_rows_ && r0 + i < rows_; ++i) {
+                for (size_t j = 0; j < block_cols_ && c0 + j < cols_; ++j) {
+                    dense.at(r0 + i, c0 + j) = block[i * block_cols_ + j];
+                }
+            }
+        }
+    }
+    return dense;
+}
+
+} // namespace ml
@@ -0,0 +1,89 @@
+#pragma once
+#include "activations.hpp"
+#include "matrix.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ml {
+
+// SparseMatrix class: Block compressed sparse row (BSR) matrix
+// The matrix is tiled into block_rows x block_cols blocks and only blocks
+// holding a nonzero are stored, each as a dense row-major block. 1 x 1
+// blocks give plain CSR; wider blocks such as 1 x 8 or 4 x 4 store a few
+// explicit zeros but let the kernels process a whole block row with one
+// vector instruction. Edge blocks are zero-padded past the matrix bounds.
+// Immutable once built
+class SparseMatrix {
+public:
+    SparseMatrix() = default;
+
+    // Compress a dense matrix, keeping every block with a nonzero element
+    // block_rows, block_cols: Block shape (1 x 1 for CSR)
+    // Throws std::invalid_argument for a zero block dimension
+    explicit SparseMatrix(const Matrix& dense, size_t block_rows = 1, size_t block_cols = 1);
+
+    size_t rows() const { return rows_; }
+    size_t cols() const { return cols_; }
+    size_t block_rows() const { return block_rows_; }
+    size_t block_cols() const { return block_cols_; }
+
+    // Number of stored blocks
+    size_t num_blocks() const { return block_columns_.size(); }
+
+    // Stored values, including the explicit zeros inside blocks
+    size_t stored_values() const { return values_.size(); }
+
+    // Fraction of the dense multiply-adds a sparse product performs:
+    // stored_values() / (rows() * cols())
+    double density() const;
+
+    // Bytes of values and indices
+    size_t memory_bytes() const;
+
+    // Expand back to a dense matrix
+    Matrix to_dense() const;
+
+    // Raw BSR arrays, as read by the kernels
+    // Blocks of block row r are [row_offsets()[r], row_offsets()[r + 1]);
+    // block q covers columns column_indices()[q] * block_cols() onwards and
+    // its block_rows() x block_cols() values start at values()[q * block size]
+    const std::vector<size_t>& row_offsets() const { return row_offsets_; }
+    const std::vector<uint32_t>& column_indices() const { return block_columns_; }
+    const std::vector<float>& values() const { return values_; }
+
+private:
+    size_t rows_ = 0;
+    size_t cols_ = 0;
+    size_t block_rows_ = 1;
+    size_t block_cols_ = 1;
+    std::vector<size_t> row_offsets_{0};  // One entry per block row, plus one
+    std::vector<uint32_t> block_columns_; // Block column of each stored block
+    std::vector<float> values_;           // Stored blocks, row-major
+};
+
+// Density up to which Layer::sparsify switches a layer to the sparse kernels
+// Sparse products skip zero blocks but cannot tile the weights in registers
+// like the dense GEMM. At a batch of 64 through a 1024 x 1024 layer, CSR
+// breaks even near 0.2 and 1 x 8 blocks near 0.35; smaller batches favour
+// the sparse kernels far longer, since the dense GEMM then streams the whole
+// weight matrix for little work
+constexpr double SPARSE_MAX_DENSITY = 0.2;
+
+// Computes c = a * b for dense a and sparse b
+// Batches narrower than a vector stream each stored block along the output
+// columns; wider batches are packed a vector of rows at a time, so each
+// stored value is one multiply-add across those rows. Large products are
+// split across the thread pool by rows, or by block rows of b when a has
+// few rows
+// c: Output view (m x b.cols()) with contiguous rows, overwritten
+// a: Input view (m x b.rows()); copied first if its columns are strided
+// Throws std::invalid_argument if the shapes don't match
+void spmm(MatrixView c, ConstMatrixView a, const SparseMatrix& b);
+
+// Computes c = activation(a * b + bias) for dense a and sparse b
+// bias: Row vector of b.cols() biases added to every row
+void spmm_bias_activation(MatrixView c, ConstMatrixView a, const SparseMatrix& b, const float* bias,
+                          ActivationType activation);
+
+} // namespace ml
@@ -0,0 +1,343 @@
+#include "cpu_dispatch.hpp"
+#include "epilogue.hpp"
+#include "float_vec.hpp"
+#include "sparse_matrix.hpp"
+#include "thread_pool.hpp"
+#include <immintrin.h>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace ml {
+namespace MLCPP_ISA {
+
+namespace {
+
+// Two kernels cover the batch sizes. The row kernel broadcasts one element
+// of A per row and streams each stored block row of B along the output
+// columns; it suits small batches and blocks at least a vector wide. The
+// transposed kernel packs a vector's worth of rows of A depth-major, so every
+// stored value of B is one broadcast multiply-add across that many rows;
+// single-column CSR blocks need it to vectorize at all
+
+// Rows of A that share each loaded block row of B in the row kernel
+constexpr size_t SPMM_MR = 4;
+
+// Rows of A per group in the transposed kernel
+constexpr size_t SPMM_VR = FloatVec::width;
+
+// Thread-local scratch buffers, reused across calls
+// slot: Distinguishes the buffers one task uses at the same time
+float* scratch(size_t slot, size_t count) {
+    thread_local std::vector<float> buffers[3];
+    if (buffers[slot].size() < count) {
+        buffers[slot].resize(count);
+    }
+    return buffers[slot].data();
+}
+
+// acc[r][0..BC) += x[r] * v[0..BC) for R rows spaced ld apart
+// BC is the block width, or 0 when it is only known at run time (bc)
+template <size_t R, size_t BC>
+inline void update_block(float* acc, size_t ld, const float* x, const float* v, size_t bc) {
+    if constexpr (BC == 0) {
+        for (size_t r = 0; r < R; ++r) {
+            for (size_t j = 0; j < bc; ++j) {
+                acc[r * ld + j] += x[r] * v[j];
+            }
+        }
+    } else {
+        size_t j = 0;
+#if defined(__AVX512F__)
+        for (; j + 16 <= BC; j += 16) {
+            __m512 b = _mm512_loadu_ps(v + j);
+            for (size_t r = 0; r < R; ++r) {
+                float* c = acc + r * ld + j;
+                _mm512_storeu_ps(c, _mm512_fmadd_ps(_mm512_set1_ps(x[r]), b, _mm512_loadu_ps(c)));
+            }
+        }
+#endif
+#if defined(__AVX2__) && defined(__FMA__)
+        for (; j + 8 <= BC; j += 8) {
+            __m256 b = _mm256_loadu_ps(v + j);
+            for (size_t r = 0; r < R; ++r) {
+                float* c = acc + r * ld + j;
+                _mm256_storeu_ps(c, _mm256_fmadd_ps(_mm256_set1_ps(x[r]), b, _mm256_loadu_ps(c)));
+            }
+        }
+#endif
+        for (; j + 4 <= BC; j += 4) {
+            __m128 b = _mm_loadu_ps(v + j);
+            for (size_t r = 0; r < R; ++r) {
+                float* c = acc + r * ld + j;
+                _mm_storeu_ps(c, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(x[r]), b), _mm_loadu_ps(c)));
+            }
+        }
+        // Only widths that are not a multiple of 4 have a scalar tail; without
+        // the guard GCC warns about the empty loop after the vector ones
+        if constexpr (BC % 4 != 0) {
+            for (; j < BC; ++j) {
+                for (size_t r = 0; r < R; ++r) {
+                    acc[r * ld + j] += x[r] * v[j];
+                }
+            }
+        }
+    }
+}
+
+// Accumulate rows [0, R) of a times block rows [rb0, rb1) of b into acc
+// acc: R rows of ld >= padded b.cols() floats
+template <size_t R, size_t BC>
+void accumulate_blocks(float* acc, size_t ld, const float* a, size_t lda,
+                       const SparseMatrix& b, size_t rb0, size_t rb1) {
+    const size_t br = b.block_rows();
+    const size_t bc = BC ? BC : b.block_cols();
+    const size_t block_size = br * bc;
+    const size_t* offsets = b.row_offsets().data();
+    const uint32_t* columns = b.column_indices().data();
+    const float* values = b.values().data();
+    for (size_t rb = rb0; rb < rb1; ++rb) {
+        size_t r0 = rb * br;
+        size_t depth = std::min(br, b.rows() - r0);
+        for (size_t rr = 0; rr < depth; ++rr) {
+            float x[R];
+            bool any = false;
+            for (size_t r = 0; r < R; ++r) {
+                x[r] = a[r * lda + r0 + rr];
+                any |= x[r] != 0.0f;
+            }
+            // Rows of inputs zeroed by ReLU skip a whole row of weights
+            if (!any) {
+                continue;
+            }
+            for (size_t q = offsets[rb]; q < offsets[rb + 1]; ++q) {
+                update_block<R, BC>(acc + columns[q] * bc, ld, x, values + q * block_size + rr * bc, bc);
+            }
+        }
+    }
+}
+
+template <size_t R>
+void accumulate_rows(float* acc, size_t ld, const float* a, size_t lda,
+                     const SparseMatrix& b, size_t rb0, size_t rb1) {
+    switch (b.block_cols()) {
+        case 1:
+            accumulate_blocks<R, 1>(acc, ld, a, lda, b, rb0, rb1);
+            break;
+        case 4:
+            accumulate_blocks<R, 4>(acc, ld, a, lda, b, rb0, rb1);
+            break;
+        case 8:
+            accumulate_blocks<R, 8>(acc, ld, a, lda, b, rb0, rb1);
+            break;
+        case 16:
+            accumulate_blocks<R, 16>(acc, ld, a, lda, b, rb0, rb1);
+            break;
+        default:
+            accumulate_blocks<R, 0>(acc, ld, a, lda, b, rb0, rb1);
+            break;
+    }
+}
+
+// Zero acc and accumulate rows (at most SPMM_MR) rows of a over block rows [rb0, rb1)
+void accumulate(float* acc, size_t ld, const float* a, size_t lda, size_t rows,
+                const SparseMatrix& b, size_t rb0, size_t rb1) {
+    std::memset(acc, 0, rows * ld * sizeof(float));
+    switch (rows) {
+        case 1:
+            accumulate_rows<1>(acc, ld, a, lda, b, rb0, rb1);
+            break;
+        case 2:
+            accumulate_rows<2>(acc, ld, a, lda, b, rb0, rb1);
+            break;
+        case 3:
+            accumulate_rows<3>(acc, ld, a, lda, b, rb0, rb1);
+            break;
+        default:
+            accumulate_rows<SPMM_MR>(acc, ld, a, lda, b, rb0, rb1);
+            break;
+    }
+}
+
+// packed[p * SPMM_VR + r] = a[r][p] for depth [p0, p1); rows past rows are zero
+void pack_transposed(float* packed, const float* a, size_t lda, size_t rows, size_t p0, size_t p1) {
+    for (size_t p = p0; p < p1; ++p) {
+        float* out = packed + p * SPMM_VR;
+        for (size_t r = 0; r < rows; ++r) {
+            out[r] = a[r * lda + p];
+        }
+        for (size_t r = rows; r < SPMM_VR; ++r) {
+            out[r] = 0.0f;
+        }
+    }
+}
+
+// acc[j * SPMM_VR + r] = sum over block rows [rb0, rb1) of b of
+// packed[p * SPMM_VR + r] * b[p][j]
+void accumulate_transposed(float* acc, size_t ld, const float* packed,
+                           const SparseMatrix& b, size_t rb0, size_t rb1) {
+    std::memset(acc, 0, ld * SPMM_VR * sizeof(float));
+    const size_t br = b.block_rows();
+    const size_t bc = b.block_cols();
+    const size_t block_size = br * bc;
+    const size_t* offsets = b.row_offsets().data();
+    const uint32_t* columns = b.column_indices().data();
+    const float* values = b.values().data();
+    for (size_t rb = rb0; rb < rb1; ++rb) {
+        size_t r0 = rb * br;
+        size_t depth = std::min(br, b.rows() - r0);
+        for (size_t rr = 0; rr < depth; ++rr) {
+            FloatVec x = FloatVec::load(packed + (r0 + rr) * SPMM_VR);
+            for (size_t q = offsets[rb]; q < offsets[rb + 1]; ++q) {
+                float* c = acc + columns[q] * bc * SPMM_VR;
+                const float* v = values + q * block_size + rr * bc;
+                for (size_t t = 0; t < bc; ++t) {
+                    fmadd(FloatVec::set1(v[t]), x, FloatVec::load(c + t * SPMM_VR)).store(c + t * SPMM_VR);
+                }
+            }
+        }
+    }
+}
+
+// Write rows of acc through the epilogue into c
+template <typename Epilogue>
+void store_rows(float* c, size_t ldc, const float* acc, size_t ld, size_t rows, size_t n,
+                const Epilogue& epilogue) {
+    for (size_t r = 0; r < rows; ++r) {
+        float* out = c + r * ldc;
+        const float* in = acc + r * ld;
+        size_t j = 0;
+#if defined(__AVX512F__) && defined(__AVX512DQ__)
+        for (; j + 16 <= n; j += 16) {
+            _mm512_storeu_ps(out + j, epilogue.apply(_mm512_loadu_ps(in + j), j));
+        }
+#elif defined(__AVX2__) && defined(__FMA__)
+        for (; j + 8 <= n; j += 8) {
+            _mm256_storeu_ps(out + j, epilogue.apply(_mm256_loadu_ps(in + j), j));
+        }
+#endif
+        for (; j < n; ++j) {
+            out[j] = epilogue.apply(in[j], j);
+        }
+    }
+}
+
+// Splits the rows of a into groups: SPMM_VR rows for the transposed kernel
+// once the batch fills a vector, SPMM_MR rows for the row kernel otherwise.
+// Large products run the groups across the thread pool; when there are fewer
+// groups than threads the block rows of b are split too, each task summing
+// into its own partial accumulator
+template <typename Epilogue>
+void spmm_driver(float* c, size_t ldc, const float* a, size_t lda, const SparseMatrix& b, size_t m,
+                 const Epilogue& epilogue) {
+    size_t n = b.cols();
+    if (m == 0 || n == 0) {
+        return;
+    }
+    size_t bc = b.block_cols();
+    size_t ld = (n + bc - 1) / bc * bc;
+    bool transposed = m >= SPMM_VR;
+    size_t group_rows = transposed ? SPMM_VR : SPMM_MR;
+    size_t groups = (m + group_rows - 1) / group_rows;
+    size_t row_blocks = b.row_offsets().size() - 1;
+    size_t acc_size = group_rows * ld;
+
+    // Accumulate the group starting at row i0 over block rows [rb0, rb1)
+    auto accumulate_group = [&](float* acc, size_t i0, size_t rb0, size_t rb1) {
+        size_t rows = std::min(group_rows, m - i0);
+        if (transposed) {
+            float* packed = scratch(1, b.rows() * SPMM_VR);
+            pack_transposed(packed, a + i0 * lda, lda, rows,
+                            rb0 * b.block_rows(), std::min(rb1 * b.block_rows(), b.rows()));
+            accumulate_transposed(acc, ld, packed, b, rb0, rb1);
+        } else {
+            accumulate(acc, ld, a + i0 * lda, lda, rows, b, rb0, rb1);
+        }
+    };
+    auto store_group = [&](const float* acc, size_t i0) {
+        size_t rows = std::min(group_rows, m - i0);
+        if (!transposed) {
+            store_rows(c + i0 * ldc, ldc, acc, ld, rows, n, epilogue);
+            return;
+        }
+        // Gather each row back from the depth-major accumulator so the
+        // epilogue runs on contiguous columns
+        float* row = scratch(2, n);
+        for (size_t r = 0; r < rows; ++r) {
+            for (size_t j = 0; j < n; ++j) {
+                row[j] = acc[j * SPMM_VR + r];
+            }
+            store_rows(c + (i0 + r) * ldc, ldc, row, n, 1, n, epilogue);
+        }
+    };
+
+    ThreadPool& pool = ThreadPool::instance();
+    size_t threads = pool.num_threads();
+    bool parallel = threads > 1 && m * b.stored_values() >= PARALLEL_GEMM_MIN_FLOPS;
+    size_t splits = 1;
+    if (parallel && groups < threads) {
+        splits = std::min(row_blocks, (threads + groups - 1) / groups);
+    }
+
+    if (splits <= 1) {
+        auto run = [&](size_t begin, size_t end) {
+            float* acc = scratch(0, acc_size);
+            for (size_t g = begin; g < end; ++g) {
+                accumulate_group(acc, g * group_rows, 0, row_blocks);
+                store_group(acc, g * group_rows);
+            }
+        };
+        if (parallel) {
+            pool.parallel_range(groups, 1, run);
+        } else {
+            run(0, groups);
+        }
+        return;
+    }
+
+    std::vector<float> partial(groups * splits * acc_size);
+    pool.parallel_range(groups * splits, 1, [&](size_t begin, size_t end) {
+        for (size_t task = begin; task < end; ++task) {
+            size_t s = task % splits;
+            accumulate_group(partial.data() + task * acc_size, task / splits * group_rows,
+                             s * row_blocks / splits, (s + 1) * row_blocks / splits);
+        }
+    });
+    for (size_t g = 0; g < groups; ++g) {
+        float* sum = partial.data() + g * splits * acc_size;
+        for (size_t s = 1; s < splits; ++s) {
+            const float* part = sum + s * acc_size;
+            for (size_t i = 0; i < acc_size; ++i) {
+                sum[i] += part[i];
+            }
+        }
+        store_group(sum, g * group_rows);
+    }
+}
+
+} // namespace
+
+void spmm(float* result, size_t ldc, const float* a, size_t lda, const SparseMatrix& b, size_t m) {
+    spmm_driver(result, ldc, a, lda, b, m, NoEpilogue{});
+}
+
+void spmm_bias_activation(float* result, size_t ldc, const float* a, size_t lda, const SparseMatrix& b,
+                          const float* bias, size_t m, ActivationType activation) {
+    switch (activation) {
+        case ActivationType::ReLU:
+            spmm_driver(result, ldc, a, lda, b, m, BiasActivationEpilogue<ActivationType::ReLU>{bias});
+            break;
+        case ActivationType::Sigmoid:
+            spmm_driver(result, ldc, a, lda, b, m, BiasActivationEpilogue<ActivationType::Sigmoid>{bias});
+            break;
+        case ActivationType::Tanh:
+            spmm_driver(result, ldc, a, lda, b, m, BiasActivationEpilogue<ActivationType::Tanh>{bias});
+            break;
+        default:
+            throw std::runtime_error("Unknown activation function");
+    }
+}
+
+} // namespace MLCPP_ISA
+} // namespace ml
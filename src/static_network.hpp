@@ -0,0 +1,242 @@
+#pragma once
+#include "activations.hpp"
+#include "float_vec.hpp"
+#include "half.hpp"
+#include "matrix.hpp"
+#include "neural.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+
+namespace ml {
+
+// Compile-time shaped inference for small fixed-topology MLPs
+// NeuralNetwork sizes everything at runtime: each forward() checks shapes,
+// goes through the kernel dispatch and packs its operands for the GEMM. For a
+// 32 -> 64 -> 64 -> 8 scorer on a single row that overhead dwarfs the ~7k
+// FLOPs of work. StaticNetwork fixes the layer shapes and activations as
+// template parameters instead: the weights live inline in the object, the
+// activations between layers on the stack, and every loop has a constant
+// trip count, so the compiler unrolls the FloatVec register blocks
+// completely. Nothing is allocated and nothing is checked per call.
+// The engine is header-only and uses the vectors of the including
+// translation unit's flags: SSE alone is throughput-bound near 1 us for the
+// scorer above, building with -mavx2 -mfma (or -march=native) brings a row
+// well under that. Dense and StaticNetwork live in namespace ml::MLCPP_ISA,
+// whose name follows those flags (see isa.hpp), so translation units built
+// with different flags each keep their own code
+
+// Accumulator vectors of a Dense layer kept in registers at once: enough
+// independent FMA chains to cover their latency, few enough to leave
+// registers for the weights
+constexpr size_t STATIC_ACCUMULATORS = 8;
+
+namespace MLCPP_ISA {
+
+// One fully connected layer: activation(input * weights + biases)
+// Weights are input_size x output_size row-major, as in Layer
+template <size_t InputSize, size_t OutputSize, ActivationType Activation>
+struct Dense {
+    static_assert(InputSize > 0 && OutputSize > 0, "Dense layer sizes must be positive");
+
+    static constexpr size_t input_size = InputSize;
+    static constexpr size_t output_size = OutputSize;
+    static constexpr ActivationType activation = Activation;
+
+    alignas(64) std::array<float, InputSize * OutputSize> weights{};
+    alignas(64) std::array<float, OutputSize> biases{};
+
+    // output = activation(input * weights + biases) for one row
+    // The row is accumulated as a sum of weight rows scaled by the inputs, in
+    // blocks of up to STATIC_ACCUMULATORS vectors that stay in registers for
+    // the whole pass over the inputs
+    void forward(const float* input, float* output) const {
+        constexpr size_t width = FloatVec::width;
+        constexpr size_t vectors = OutputSize / width;
+        constexpr size_t full = vectors / STATIC_ACCUMULATORS * STATIC_ACCUMULATORS;
+        for (size_t v = 0; v < full; v += STATIC_ACCUMULATORS) {
+            accumulate<STATIC_ACCUMULATORS>(input, v * width, output);
+        }
+        if constexpr (vectors > full) {
+            accumulate<vectors - full>(input, full * width, output);
+        }
+        for (size_t j = vectors * width; j < OutputSize; ++j) {
+            float sum = biases[j];
+            for (size_t i = 0; i < InputSize; ++i) {
+                sum += input[i] * weights[i * OutputSize + j];
+            }
+            output[j] = sum;
+        }
+        for (size_t j = 0; j < OutputSize; ++j) {
+            output[j] = activate(output[j]);
+        }
+    }
+
+    // Same approximations as the GEMM epilogues, so results match Layer
+    static float activate(float x) {
+        if constexpr (Activation == ActivationType::ReLU) {
+            return x > 0.0f ? x : 0.0f;
+        } else if constexpr (Activation == ActivationType::Sigmoid) {
+            return approx::sigmoid_approx(x);
+        } else {
+            return approx::tanh_approx(x);
+        }
+    }
+
+    // Throws std::invalid_argument if layer differs in shape or activation
+    static void check(const Layer& layer) {
+        if (layer.input_size() != InputSize || layer.output_size() != OutputSize) {
+            throw std::invalid_argument("Layer is " + std::to_string(layer.input_size()) + "x" +
+                                        std::to_string(layer.output_size()) + ", static layer is " +
+                                        std::to_string(InputSize) + "x" + std::to_string(OutputSize));
+        }
+        if (layer.get_activation() != Activation) {
+            throw std::invalid_argument("Layer activation does not match the static layer");
+        }
+    }
+
+    // Copy the parameters of layer, which must pass check()
+    void load(const Layer& layer) {
+        if (const HalfMatrix* half = layer.get_half_weights()) {
+            half_to_float(weights.data(), half->data(), weights.size(), half->precision());
+        } else {
+            const Matrix& source = layer.get_weights();
+            std::copy(source.data(), source.data() + weights.size(), weights.begin());
+        }
+        std::copy(layer.get_biases().data(), layer.get_biases().data() + OutputSize, biases.begin());
+    }
+
+private:
+    // Pre-activation outputs [j0, j0 + Vectors * width)
+    template <size_t Vectors>
+    void accumulate(const float* input, size_t j0, float* output) const {
+        constexpr size_t width = FloatVec::width;
+        FloatVec sum[Vectors];
+        for (size_t v = 0; v < Vectors; ++v) {
+            sum[v] = FloatVec::load(biases.data() + j0 + v * width);
+        }
+        for (size_t i = 0; i < InputSize; ++i) {
+            FloatVec x = FloatVec::set1(input[i]);
+            const float* row = weights.data() + i * OutputSize + j0;
+#pragma GCC unroll 16
+            for (size_t v = 0; v < Vectors; ++v) {
+                sum[v] = fmadd(x, FloatVec::load(row + v * width), sum[v]);
+            }
+        }
+        for (size_t v = 0; v < Vectors; ++v) {
+            sum[v].store(output + j0 + v * width);
+        }
+    }
+};
+
+// StaticNetwork class: Dense layers of compile-time shape run in sequence
+// e.g. StaticNetwork<Dense<32, 64, ActivationType::ReLU>, Dense<64, 8, ActivationType::Sigmoid>>
+// All parameters are stored inline (sizeof grows with the weights), so large
+// instances belong on the heap rather than the stack. forward() is const and
+// keeps no state, so any number of threads may share one instance
+template <typename... Layers>
+class StaticNetwork {
+    static_assert(sizeof...(Layers) > 0, "StaticNetwork needs at least one layer");
+
+    using LayerTuple = std::tuple<Layers...>;
+    static constexpr size_t layer_count = sizeof...(Layers);
+
+    template <size_t L>
+    using LayerAt = std::tuple_element_t<L, LayerTuple>;
+
+    template <size_t... L>
+    static constexpr bool chained(std::index_sequence<L...>) {
+        return ((LayerAt<L>::output_size == LayerAt<L + 1>::input_size) && ...);
+    }
+    static_assert(chained(std::make_index_sequence<layer_count - 1>{}),
+                  "Each layer's input size must equal the previous layer's output size");
+
+public:
+    static constexpr size_t input_size = LayerAt<0>::input_size;
+    static constexpr size_t output_size = LayerAt<layer_count - 1>::output_size;
+
+    using Input = std::array<float, input_size>;
+    using Output = std::array<float, output_size>;
+
+    // Zero weights and biases
+    StaticNetwork() = default;
+
+    // Copy the parameters of network, see load()
+    explicit StaticNetwork(const NeuralNetwork& network) { load(network); }
+
+    // Copy the parameters of network, whose layers must match Layers in
+    // shape and activation; float and half-precision weights are accepted
+    // Later changes to network are not seen
+    // Throws std::invalid_argument on a layer count, shape or activation
+    // mismatch, leaving the parameters unchanged
+    void load(const NeuralNetwork& network) {
+        if (network.get_layers().size() != layer_count) {
+            throw std::invalid_argument("Network has " + std::to_string(network.get_layers().size()) +
+                                        " layers, static network has " + std::to_string(layer_count));
+        }
+        load_layers(network, std::make_index_sequence<layer_count>{});
+    }
+
+    // Score one row
+    // input: input_size values
+    // output: output_size values, overwritten
+    void forward(const float* input, float* output) const { run<0>(input, output); }
+
+    Output forward(const Input& input) const {
+        Output output;
+        run<0>(input.data(), output.data());
+        return output;
+    }
+
+    // Score rows of a batch one at a time; for large batches
+    // NeuralNetwork::forward() is faster, its GEMM reuses each weight across
+    // many rows
+    // input: rows x input_size
+    // output: rows x output_size, overwritten
+    // Throws std::invalid_argument for mismatched shapes
+    void forward(const Matrix& input, Matrix& output) const {
+        if (input.cols() != input_size || output.cols() != output_size || output.rows() != input.rows()) {
+            throw std::invalid_argument("Matrix shapes do not match the static network");
+        }
+        for (size_t i = 0; i < input.rows(); ++i) {
+            run<0>(input.data() + i * input_size, output.data() + i * output_size);
+        }
+    }
+
+    template <size_t L>
+    LayerAt<L>& layer() { return std::get<L>(layers_); }
+    template <size_t L>
+    const LayerAt<L>& layer() const { return std::get<L>(layers_); }
+
+private:
+    template <size_t... L>
+    void load_layers(const NeuralNetwork& network, std::index_sequence<L...>) {
+        (LayerAt<L>::check(network.get_layers()[L]), ...);
+        (std::get<L>(layers_).load(network.get_layers()[L]), ...);
+    }
+
+    // Layer L and the rest, with each intermediate row in a stack buffer
+    template <size_t L>
+    void run(const float* input, float* output) const {
+        if constexpr (L + 1 == layer_count) {
+            std::get<L>(layers_).forward(input, output);
+        } else {
+            alignas(64) float hidden[LayerAt<L>::output_size];
+            std::get<L>(layers_).forward(input, hidden);
+            run<L + 1>(hidden, output);
+        }
+    }
+
+    LayerTuple layers_;
+};
+
+} // namespace MLCPP_ISA
+
+using MLCPP_ISA::Dense;
+using MLCPP_ISA::StaticNetwork;
+
+} // namespace ml
@@ -0,0 +1,379 @@
+#include "stream_inference.hpp"
+#include "profiler.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace ml {
+
+namespace {
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "Streamed files are little-endian");
+
+using Clock = std::chrono::steady_clock;
+
+double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+constexpr char NPY_MAGIC[6] = {'\x93', 'N', 'U', 'M', 'P', 'Y'};
+
+// Read-only shared mapping of a whole input file
+class InputMapping {
+public:
+    explicit InputMapping(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot open input file " + path + ": " + std::strerror(errno));
+        }
+        if (fstat(fd, &info_) != 0) {
+            int error = errno;
+            close(fd);
+            throw std::runtime_error("Cannot stat input file " + path + ": " + std::strerror(error));
+        }
+        size_ = static_cast<size_t>(info_.st_size);
+        if (size_ > 0) {
+            void* data = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+            int error = errno;
+            close(fd);
+            if (data == MAP_FAILED) {
+                throw std::runtime_error("Cannot map input file " + path + ": " + std::strerror(error));
+            }
+            data_ = static_cast<const char*>(data);
+            madvise(const_cast<char*>(data_), size_, MADV_SEQUENTIAL);
+        } else {
+            close(fd);
+        }
+    }
+
+    ~InputMapping() {
+        if (data_) {
+            munmap(const_cast<char*>(data_), size_);
+        }
+    }
+
+    InputMapping(const InputMapping&) = delete;
+    InputMapping& operator=(const InputMapping&) = delete;
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+    // Whether path names this file (possibly through another link)
+    bool same_file(const std::string& path) const {
+        struct stat other;
+        return stat(path.c_str(), &other) == 0 && other.st_dev == info_.st_dev && other.st_ino == info_.st_ino;
+    }
+
+    // Pass advice for [begin, end) to the kernel, widened to whole pages
+    // when prefetching and narrowed to pages wholly inside it when dropping,
+    // so a neighbouring chunk never loses its pages
+    void advise(size_t begin, size_t end, int advice) const {
+        static const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        end = std::min(end, size_);
+        if (advice == MADV_DONTNEED) {
+            begin = (begin + page - 1) / page * page;
+            end = end / page * page;
+        } else {
+            begin = begin / page * page;
+        }
+        if (data_ && begin < end) {
+            madvise(const_cast<char*>(data_) + begin, end - begin, advice);
+        }
+    }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    struct stat info_;
+};
+
+// Layout of the float32 matrix inside an input file
+struct InputLayout {
+    size_t data_offset;
+    size_t rows;
+    size_t cols;
+};
+
+// Value of key in a .npy header dictionary, up to the next top-level comma
+std::string npy_field(const std::string& header, const std::string& key) {
+    size_t pos = header.find("'" + key + "'");
+    if (pos == std::string::npos || (pos = header.find(':', pos)) == std::string::npos) {
+        return {};
+    }
+    size_t begin = header.find_first_not_of(' ', pos + 1);
+    if (begin == std::string::npos) {
+        return {};
+    }
+    bool tuple = header[begin] == '(';
+    size_t end = header.find(tuple ? ')' : ',', begin);
+    if (end == std::string::npos) {
+        return {};
+    }
+    return header.substr(begin, end - begin + (tuple ? 1 : 0));
+}
+
+// Parse the header of a .npy file, accepting only 2-D little-endian float32 in C order
+InputLayout parse_npy(const char* data, size_t size, const std::string& path) {
+    auto malformed = [&](const std::string& why) {
+        return std::runtime_error("Input file " + path + ": " + why);
+    };
+    if (size < 10) {
+        throw malformed("truncated .npy header");
+    }
+    uint8_t major = static_cast<uint8_t>(data[6]);
+    size_t header_offset = major == 1 ? 10 : 12;
+    if (major < 1 || major > 3 || size < header_offset) {
+        throw malformed("unsupported .npy version");
+    }
+    uint32_t header_bytes = 0;
+    std::memcpy(&header_bytes, data + 8, major == 1 ? 2 : 4);
+    if (header_bytes > size - header_offset) {
+        throw malformed("truncated .npy header");
+    }
+    std::string header(data + header_offset, header_bytes);
+    if (npy_field(header, "descr") != "'<f4'") {
+        throw malformed("only float32 (<f4) .npy arrays can be streamed");
+    }
+    if (npy_field(header, "fortran_order") != "False") {
+        throw malformed("only C-order .npy arrays can be streamed");
+    }
+    std::string shape = npy_field(header, "shape");
+    unsigned long long rows = 0, cols = 0;
+    char closing = 0;
+    if (std::sscanf(shape.c_str(), "(%llu, %llu%c", &rows, &cols, &closing) != 3 || closing != ')') {
+        throw malformed("only 2-D .npy arrays can be streamed, got shape " + shape);
+    }
+    InputLayout layout{header_offset + header_bytes, static_cast<size_t>(rows), static_cast<size_t>(cols)};
+    if (layout.data_offset % sizeof(float) != 0) {
+        throw malformed("misaligned .npy data");
+    }
+    if (layout.cols == 0 || layout.cols > size ||
+        layout.rows > (size - layout.data_offset) / (layout.cols * sizeof(float))) {
+        throw malformed("truncated .npy data");
+    }
+    return layout;
+}
+
+InputLayout input_layout(const InputMapping& input, size_t raw_cols, const std::string& path) {
+    if (input.size() >= sizeof(NPY_MAGIC) && std::memcmp(input.data(), NPY_MAGIC, sizeof(NPY_MAGIC)) == 0) {
+        return parse_npy(input.data(), input.size(), path);
+    }
+    size_t row_bytes = raw_cols * sizeof(float);
+    if (input.size() % row_bytes != 0) {
+        throw std::runtime_error("Input file " + path + " is not a whole number of " +
+                                 std::to_string(raw_cols) + "-column float32 rows");
+    }
+    return {0, input.size() / row_bytes, raw_cols};
+}
+
+// Version 1.0 .npy header for a rows x cols float32 array, padded so the
+// data starts on a 64-byte boundary
+std::string npy_header(size_t rows, size_t cols) {
+    std::string dict = "{'descr': '<f4', 'fortran_order': False, 'shape': (" + std::to_string(rows) + ", " +
+                       std::to_string(cols) + "), }";
+    size_t total = (10 + dict.size() + 1 + 63) / 64 * 64;
+    dict.append(total - 10 - dict.size() - 1, ' ');
+    dict.push_back('\n');
+    uint16_t length = static_cast<uint16_t>(dict.size());
+    std::string header(NPY_MAGIC, sizeof(NPY_MAGIC));
+    header.push_back('\x01');
+    header.push_back('\x00');
+    header.append(reinterpret_cast<const char*>(&length), sizeof(length));
+    return header + dict;
+}
+
+bool ends_with(const std::string& text, const std::string& suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+} // namespace
+
+StreamStats stream_inference(const NeuralNetwork& network, const std::string& input_path,
+                             const std::string& output_path, const StreamConfig& config) {
+    ProfileScope scope("stream_inference");
+    Clock::time_point start = Clock::now();
+    const auto& layers = network.get_layers();
+    if (layers.empty()) {
+        throw std::invalid_argument("stream_inference requires a network with at least one layer");
+    }
+    if (config.chunk_rows == 0 || config.num_workers == 0 || config.max_chunks_in_flight == 0) {
+        throw std::invalid_argument("chunk_rows, num_workers and max_chunks_in_flight must be positive");
+    }
+    size_t input_cols = layers.front().input_size();
+    size_t output_cols = layers.back().output_size();
+
+    InputMapping input(input_path);
+    if (input.same_file(output_path)) {
+        throw std::invalid_argument("stream_inference output would overwrite its input " + input_path);
+    }
+    // Columns per stored row; those past the network's input are skipped
+    const size_t row_cols = config.input_cols ? config.input_cols : input_cols;
+    if (row_cols < input_cols) {
+        throw std::invalid_argument("input_cols " + std::to_string(row_cols) +
+                                    " is narrower than the network's input size " + std::to_string(input_cols));
+    }
+    InputLayout layout = input_layout(input, row_cols, input_path);
+    if (layout.cols != row_cols) {
+        throw std::invalid_argument("Input rows have " + std::to_string(layout.cols) + " columns but " +
+                                    std::to_string(row_cols) + " are expected");
+    }
+
+    std::ofstream output(output_path, std::ios::binary | std::ios::trunc);
+    if (!output) {
+        throw std::runtime_error("Cannot open output file for writing: " + output_path);
+    }
+    if (ends_with(output_path, ".npy")) {
+        std::string header = npy_header(layout.rows, output_cols);
+        output.write(header.data(), static_cast<std::streamsize>(header.size()));
+    }
+
+    StreamStats stats;
+    stats.rows = layout.rows;
+    stats.chunks = (layout.rows + config.chunk_rows - 1) / config.chunk_rows;
+    const size_t depth = std::min(config.max_chunks_in_flight, std::max<size_t>(stats.chunks, 1));
+    const size_t row_bytes = row_cols * sizeof(float);
+    const float* rows = reinterpret_cast<const float*>(input.data() + layout.data_offset);
+    auto chunk_begin = [&](size_t chunk) { return layout.data_offset + chunk * config.chunk_rows * row_bytes; };
+    auto chunk_end = [&](size_t chunk) {
+        return layout.data_offset + std::min((chunk + 1) * config.chunk_rows, layout.rows) * row_bytes;
+    };
+
+    // Chunk c lands in slot c % depth; a worker may start chunk c only once
+    // chunk c - depth has been written, which frees that slot
+    std::vector<Matrix> slots;
+    slots.reserve(depth);
+    for (size_t i = 0; i < depth; ++i) {
+        slots.emplace_back(std::min(config.chunk_rows, std::max<size_t>(layout.rows, 1)), output_cols,
+                           Matrix::Uninitialized{});
+    }
+    std::vector<bool> ready(depth, false);
+    std::mutex mutex;                  // Guards the fields below and ready
+    std::condition_variable changed;   // Signals a claimed, finished or written chunk
+    size_t next_chunk = 0;
+    size_t written = 0;
+    std::exception_ptr error;
+
+    auto worker = [&] {
+        InferenceContext context;
+        double compute_seconds = 0;
+        for (;;) {
+            size_t chunk;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [&] {
+                    return error || next_chunk >= stats.chunks || next_chunk < written + depth;
+                });
+                if (error || next_chunk >= stats.chunks) {
+                    break;
+                }
+                chunk = next_chunk++;
+            }
+            // Start reading the chunk the next free worker will claim
+            size_t ahead = chunk + config.num_workers;
+            if (ahead < stats.chunks) {
+                input.advise(chunk_begin(ahead), chunk_end(ahead), MADV_WILLNEED);
+            }
+            try {
+                Clock::time_point computing = Clock::now();
+                size_t first = chunk * config.chunk_rows;
+                size_t count = std::min(config.chunk_rows, layout.rows - first);
+                ConstMatrixView result = network.forward(
+                    ConstMatrixView(rows + first * row_cols, count, input_cols, row_cols, 1), context);
+                std::memcpy(slots[chunk % depth].data(), result.data(), count * output_cols * sizeof(float));
+                compute_seconds += seconds_since(computing);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                changed.notify_all();
+                break;
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                ready[chunk % depth] = true;
+            }
+            changed.notify_all();
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.compute_seconds += compute_seconds;
+    };
+
+    std::vector<std::thread> workers;
+    size_t worker_count = std::min(config.num_workers, std::max<size_t>(stats.chunks, 1));
+    if (stats.chunks > 0) {
+        input.advise(chunk_begin(0), chunk_end(std::min(worker_count, stats.chunks) - 1), MADV_WILLNEED);
+    }
+    for (size_t i = 0; i < worker_count && stats.chunks > 0; ++i) {
+        workers.emplace_back(worker);
+    }
+
+    // The calling thread writes the chunks in order as they complete
+    auto fail = [&](std::exception_ptr failure) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!error) {
+            error = failure;
+        }
+        changed.notify_all();
+    };
+    for (size_t chunk = 0; chunk < stats.chunks; ++chunk) {
+        size_t slot = chunk % depth;
+        {
+            Clock::time_point waiting = Clock::now();
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&] { return error || ready[slot]; });
+            stats.writer_wait_seconds += seconds_since(waiting);
+            if (error) {
+                break;
+            }
+        }
+        Clock::time_point writing = Clock::now();
+        size_t count = std::min(config.chunk_rows, layout.rows - chunk * config.chunk_rows);
+        size_t bytes = count * output_cols * sizeof(float);
+        {
+            ProfileScope write_scope("stream_inference::write", 0.0, static_cast<double>(bytes),
+                                     static_cast<int64_t>(chunk));
+            output.write(reinterpret_cast<const char*>(slots[slot].data()), static_cast<std::streamsize>(bytes));
+        }
+        if (!output) {
+            fail(std::make_exception_ptr(std::runtime_error("Failed to write output file: " + output_path)));
+            break;
+        }
+        // Scored rows are not read again
+        input.advise(chunk_begin(chunk), chunk_end(chunk), MADV_DONTNEED);
+        stats.write_seconds += seconds_since(writing);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ready[slot] = false;
+            ++written;
+        }
+        changed.notify_all();
+    }
+    for (std::thread& thread : workers) {
+        thread.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    if (!output.flush()) {
+        throw std::runtime_error("Failed to write output file: " + output_path);
+    }
+    stats.seconds = seconds_since(start);
+    return stats;
+}
+
+} // namespace ml
@@ -0,0 +1,50 @@
+#pragma once
+#include "neural.hpp"
+#include <cstddef>
+#include <string>
+
+namespace ml {
+
+// Pipeline shape for stream_inference
+struct StreamConfig {
+    size_t chunk_rows = 4096;          // Rows per forward() call
+    size_t num_workers = 2;            // Threads running forward() concurrently
+    size_t max_chunks_in_flight = 8;   // Chunks started but not yet written; bounds memory
+    // Row width of the input; 0 takes the network's input size. Rows may be
+    // wider than the network's input: the leading columns are scored and the
+    // rest (e.g. trailing ids or labels) skipped. A .npy input's shape must
+    // agree with it
+    size_t input_cols = 0;
+};
+
+// Counters from one stream_inference run
+struct StreamStats {
+    size_t rows = 0;             // Rows scored
+    size_t chunks = 0;           // forward() calls issued
+    double seconds = 0;          // Wall time of the whole run
+    double compute_seconds = 0;  // Time inside forward(), summed over workers
+    double write_seconds = 0;    // Time the writer spent writing output
+    double writer_wait_seconds = 0; // Time the writer waited for the next chunk
+};
+
+// Score a float32 dataset too large for memory, chunk by chunk
+// The input is either a .npy file (2-D, little-endian float32, C order) or
+// headerless row-major float32; .npy is recognized by its magic bytes. It is
+// memory-mapped read-only and each chunk is fed to forward() as a view into
+// the mapping, so rows are never copied on the way in. Workers claim chunks
+// in order, each with its own InferenceContext, and ask the kernel to read
+// ahead the chunk after the ones in progress, so disk reads overlap compute.
+// The calling thread writes results strictly in input order and releases the
+// input pages behind it; at most max_chunks_in_flight chunk results exist at
+// once, so memory stays bounded however large the dataset is
+// network: Must not be trained or modified while the stream runs
+// output_path: Written as .npy when it ends in ".npy", raw float32 otherwise
+// Throws std::invalid_argument for a bad configuration, an empty network, a
+// row width that differs from input_cols or is narrower than the network, or
+// output_path naming the input,
+// std::runtime_error for I/O failures or a malformed input file, and rethrows
+// the first exception raised by forward()
+StreamStats stream_inference(const NeuralNetwork& network, const std::string& input_path,
+                             const std::string& output_path, const StreamConfig& config = {});
+
+} // namespace ml
@@ -0,0 +1,250 @@
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace ml {
+
+namespace {
+
+// Set while a thread is executing tasks of a parallel region
+// Nested regions see it and run inline instead of deadlocking on the pool
+thread_local bool tl_in_parallel_region = false;
+
+// Most threads MLCPP_NUM_THREADS may ask for; larger values are typos that
+// would otherwise fail to start the pool inside instance()
+constexpr size_t MAX_ENV_THREADS = 4096;
+
+// Decimal value of an environment variable, or fallback when it is unset,
+// zero or invalid; values that are not plain digits (stoul would wrap "-1" to
+// ULONG_MAX) or exceed max are reported on stderr
+size_t env_size(const char* name, size_t fallback, size_t max) {
+    const char* value = std::getenv(name);
+    if (!value || !*value) {
+        return fallback;
+    }
+    if (std::isdigit(static_cast<unsigned char>(value[0]))) {
+        try {
+            size_t used = 0;
+            unsigned long parsed = std::stoul(value, &used);
+            if (value[used] == '\0' && parsed <= max) {
+                return parsed == 0 ? fallback : static_cast<size_t>(parsed);
+            }
+        } catch (const std::exception&) {
+        }
+    }
+    std::cerr << "mlcpp: ignoring " << name << "=" << value << std::endl;
+    return fallback;
+}
+
+size_t default_thread_count() {
+    size_t hw = std::thread::hardware_concurrency();
+    return hw > 0 ? hw : 1;
+}
+
+#ifdef __linux__
+// CPUs this process may run on, in ascending order
+std::vector<int> allowed_cpus() {
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+    return cpus;
+}
+#endif
+
+// Pin the calling worker to one CPU; worker 0 gets the second allowed CPU so
+// the submitting thread keeps the first one to itself
+void pin_current_thread(size_t worker_index) {
+#ifdef __linux__
+    static const std::vector<int> cpus = allowed_cpus();
+    if (cpus.empty()) {
+        return;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpus[(worker_index + 1) % cpus.size()], &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)worker_index;
+#endif
+}
+
+} // namespace
+
+ThreadPool& ThreadPool::instance() {
+    static ThreadPool pool(env_size("MLCPP_NUM_THREADS", 0, MAX_ENV_THREADS),
+                           env_size("MLCPP_AFFINITY", 0, 1) != 0);
+    return pool;
+}
+
+ThreadPool::ThreadPool(size_t num_threads, bool pin_threads)
+    : pin_threads_(pin_threads) {
+    start_workers((num_threads == 0 ? default_thread_count() : num_threads) - 1);
+}
+
+ThreadPool::~ThreadPool() {
+    stop_workers();
+}
+
+void ThreadPool::set_num_threads(size_t num_threads) {
+    std::lock_guard<std::mutex> submit(submit_mutex_);
+    stop_workers();
+    start_workers((num_threads == 0 ? default_thread_count() : num_threads) - 1);
+}
+
+void ThreadPool::set_affinity(bool pin_threads) {
+    std::lock_guard<std::mutex> submit(submit_mutex_);
+    size_t count = workers_.size();
+    stop_workers();
+    pin_threads_ = pin_threads;
+    start_workers(count);
+}
+
+void ThreadPool::start_workers(size_t count) {
+    stopping_ = false;
+    workers_.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        workers_.emplace_back(&ThreadPool::worker_loop, this, i, generation_);
+    }
+}
+
+void ThreadPool::stop_workers() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+    workers_.clear();
+}
+
+void ThreadPool::worker_loop(size_t worker_index, size_t seen) {
+    if (pin_threads_) {
+        pin_current_thread(worker_index);
+    }
+    tl_in_parallel_region = true;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        wake_.wait(lock, [&] { return stopping_ || generation_ != seen; });
+        if (stopping_) {
+            return;
+        }
+        seen = generation_;
+        lock.unlock();
+        run_tasks();
+        lock.lock();
+        if (--active_workers_ == 0) {
+            done_.notify_one();
+        }
+    }
+}
+
+void ThreadPool::run_tasks() {
+    size_t index;
+    while ((index = next_task_.fetch_add(1, std::memory_order_relaxed)) < job_count_) {
+        try {
+            (*job_)(index);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!error_) {
+                error_ = std::current_exception();
+            }
+        }
+    }
+}
+
+void ThreadPool::parallel_for(size_t count, const std::function<void(size_t)>& fn) {
+    if (count == 0) {
+        return;
+    }
+    if (count == 1 || workers_.empty() || tl_in_parallel_region) {
+        for (size_t i = 0; i < count; ++i) {
+            fn(i);
+        }
+        return;
+    }
+
+    std::unique_lock<std::mutex> submit(submit_mutex_, std::try_to_lock);
+    if (!submit.owns_lock()) {
+        // Another thread is driving the pool; doing the work here is cheaper
+        // than queueing behind it
+        for (size_t i = 0; i < count; ++i) {
+            fn(i);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        job_ = &fn;
+        job_count_ = count;
+        next_task_.store(0, std::memory_order_relaxed);
+        active_workers_ = workers_.size();
+        ++generation_;
+    }
+    wake_.notify_all();
+
+    tl_in_parallel_region = true;
+    run_tasks();
+    tl_in_parallel_region = false;
+
+    std::exception_ptr error;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [&] { return active_workers_ == 0; });
+        job_ = nullptr;
+        std::swap(error, error_);
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void ThreadPool::parallel_range(size_t size, size_t grain,
+                                const std::function<void(size_t, size_t)>& fn) {
+    if (size == 0) {
+        return;
+    }
+    grain = std::max<size_t>(grain, 1);
+    // Aim for a few chunks per thread so dynamic claiming can rebalance
+    size_t target_chunks = num_threads() * 4;
+    size_t chunk = std::max(grain, (size + target_chunks - 1) / target_chunks);
+    chunk = (chunk + grain - 1) / grain * grain;
+    size_t chunks = (size + chunk - 1) / chunk;
+
+    parallel_for(chunks, [&](size_t c) {
+        size_t begin = c * chunk;
+        fn(begin, std::min(size, begin + chunk));
+    });
+}
+
+void set_num_threads(size_t num_threads) {
+    ThreadPool::instance().set_num_threads(num_threads);
+}
+
+size_t get_num_threads() {
+    return ThreadPool::instance().num_threads();
+}
+
+void set_thread_affinity(bool pin_threads) {
+    ThreadPool::instance().set_affinity(pin_threads);
+}
+
+} // namespace ml
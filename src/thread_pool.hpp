@@ -0,0 +1,92 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ml {
+
+// ThreadPool class: Library-owned pool of persistent worker threads
+// Workers sleep on a condition variable between jobs, so a parallel region
+// costs one wake-up instead of thread creation. The calling thread always
+// participates in the work it submits
+class ThreadPool {
+public:
+    // Returns the process-wide pool used by all kernels
+    // Initial size comes from MLCPP_NUM_THREADS, else hardware_concurrency()
+    // Setting MLCPP_AFFINITY=1 pins workers to cores at startup
+    // Negative, malformed or out-of-range values (above 4096 threads) are
+    // reported on stderr and ignored
+    static ThreadPool& instance();
+
+    // Create a pool that runs work on num_threads threads (caller included)
+    // num_threads: Total thread count; 0 selects hardware_concurrency()
+    // pin_threads: Bind each worker to its own CPU from the process mask
+    explicit ThreadPool(size_t num_threads = 0, bool pin_threads = false);
+
+    // Stops and joins all workers
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Resize the pool; joins the old workers and starts new ones
+    // Must not be called while a parallel region is running
+    void set_num_threads(size_t num_threads);
+
+    // Total number of threads that execute a parallel region
+    size_t num_threads() const { return workers_.size() + 1; }
+
+    // Enable or disable CPU pinning; takes effect by restarting the workers
+    void set_affinity(bool pin_threads);
+    bool affinity() const { return pin_threads_; }
+
+    // Run fn(i) for every i in [0, count), blocking until all calls finish
+    // Tasks are claimed dynamically so uneven work balances itself
+    // Runs inline when count == 1, the pool has one thread, the caller is a
+    // pool worker (nested region), or another thread currently owns the pool
+    void parallel_for(size_t count, const std::function<void(size_t)>& fn);
+
+    // Split [0, size) into contiguous ranges of at least grain elements and
+    // run fn(begin, end) for each one in parallel
+    // Ranges start on multiples of grain, so a grain that is a multiple of the
+    // SIMD width keeps every range start aligned
+    void parallel_range(size_t size, size_t grain,
+                        const std::function<void(size_t, size_t)>& fn);
+
+private:
+    void start_workers(size_t count);
+    void stop_workers();
+    void worker_loop(size_t worker_index, size_t seen_generation);
+    void run_tasks();
+
+    std::vector<std::thread> workers_;
+    bool pin_threads_;
+
+    std::mutex submit_mutex_;      // Held by the thread that owns the current job
+    std::mutex mutex_;             // Guards the job fields below
+    std::condition_variable wake_; // Signals workers that a job is ready
+    std::condition_variable done_; // Signals the submitter that workers finished
+    const std::function<void(size_t)>* job_ = nullptr;
+    size_t job_count_ = 0;
+    size_t generation_ = 0;        // Incremented for every submitted job
+    size_t active_workers_ = 0;    // Workers still inside the current job
+    bool stopping_ = false;
+    std::exception_ptr error_;     // First exception thrown by a task of the job
+    std::atomic<size_t> next_task_{0};
+};
+
+// Parallelization thresholds: work below these sizes stays on the caller
+constexpr size_t PARALLEL_ELEMENTWISE_MIN = 1 << 16; // Elements per element-wise sweep
+constexpr size_t PARALLEL_GEMM_MIN_FLOPS = 1 << 21;  // m * n * k for a GEMM
+
+// Convenience wrappers around ThreadPool::instance()
+void set_num_threads(size_t num_threads);
+size_t get_num_threads();
+void set_thread_affinity(bool pin_threads);
+
+} // namespace ml
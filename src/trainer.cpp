@@ -0,0 +1,332 @@
+#include "trainer.hpp"
+#include "gemm.hpp"
+#include "optimizations.hpp"
+#include "profiler.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <utility>
+
+namespace ml {
+
+namespace {
+
+// Parameter blocks start on 64-byte boundaries of the gradient buffers
+constexpr size_t PARAMETER_ALIGNMENT = 16;
+
+size_t align_parameters(size_t count) {
+    return (count + PARAMETER_ALIGNMENT - 1) / PARAMETER_ALIGNMENT * PARAMETER_ALIGNMENT;
+}
+
+// Split leaves [first, last) of the halving tree into groups subtrees
+// The left half of every node gets count / 2 leaves and groups / 2 groups,
+// so each range is a node of the same tree whatever the group count
+void split_tree(size_t first, size_t last, size_t groups,
+                std::vector<std::pair<size_t, size_t>>& ranges) {
+    if (groups <= 1) {
+        ranges.emplace_back(first, last);
+        return;
+    }
+    size_t mid = first + (last - first) / 2;
+    split_tree(first, mid, groups / 2, ranges);
+    split_tree(mid, last, groups - groups / 2, ranges);
+}
+
+} // namespace
+
+// Rows visited by one train_epoch() call
+struct DataParallelTrainer::Epoch {
+    const Matrix& inputs;
+    const Matrix& targets;
+    const std::vector<size_t>* order; // Row trained at each position; nullptr visits rows in order
+};
+
+// One synchronous minibatch: rows [begin, begin + rows) of the epoch order
+// cut into `shards` contiguous pieces
+struct DataParallelTrainer::Step {
+    size_t begin;
+    size_t rows;
+    size_t shards;
+    float scale;           // 1 / rows, the mean over the whole minibatch
+    std::vector<double>& losses; // Summed squared error of each shard
+
+    size_t shard_begin(size_t shard) const { return begin + shard * rows / shards; }
+};
+
+DataParallelTrainer::DataParallelTrainer(NeuralNetwork& network, TrainerConfig config)
+    : network_(network), config_(config),
+      num_workers_(config.num_workers ? config.num_workers : get_num_threads()) {
+    if (config_.batch_size == 0) {
+        throw std::invalid_argument("Trainer batch size must be positive");
+    }
+    if (config_.deterministic && config_.mode == TrainingMode::Hogwild) {
+        throw std::invalid_argument("Hogwild training cannot be deterministic");
+    }
+}
+
+void DataParallelTrainer::plan_parameters() {
+    const std::vector<Layer>& layers = network_.get_layers();
+    std::vector<size_t> sizes{layers.front().input_size()};
+    for (const Layer& layer : layers) {
+        sizes.push_back(layer.output_size());
+    }
+    if (sizes == layer_sizes_) {
+        return;
+    }
+    layer_sizes_ = std::move(sizes);
+    workspaces_.clear();
+    weight_offsets_.clear();
+    bias_offsets_.clear();
+    parameter_count_ = 0;
+    for (size_t i = 0; i < layers.size(); ++i) {
+        weight_offsets_.push_back(parameter_count_);
+        parameter_count_ += align_parameters(layer_sizes_[i] * layer_sizes_[i + 1]);
+        bias_offsets_.push_back(parameter_count_);
+        parameter_count_ += align_parameters(layer_sizes_[i + 1]);
+    }
+}
+
+float* DataParallelTrainer::parameter_gradients(Workspace& workspace, size_t level) const {
+    while (workspace.parameters.size() <= level) {
+        workspace.parameters.emplace_back(1, parameter_count_, Matrix::Uninitialized{});
+    }
+    return workspace.parameters[level].data();
+}
+
+double DataParallelTrainer::run_shard(Workspace& workspace, const Epoch& epoch, size_t begin,
+                                      size_t end, float scale, float* gradients) const {
+    const std::vector<Layer>& layers = network_.get_layers();
+    size_t rows = end - begin;
+    size_t input_cols = epoch.inputs.cols();
+    size_t target_cols = epoch.targets.cols();
+    if (workspace.capacity < rows) {
+        workspace.activations.clear();
+        workspace.gradients.clear();
+        for (const Layer& layer : layers) {
+            workspace.activations.emplace_back(rows, layer.output_size(), Matrix::Uninitialized{});
+            workspace.gradients.emplace_back(rows, layer.output_size(), Matrix::Uninitialized{});
+        }
+        workspace.inputs.reset();
+        workspace.targets.reset();
+        workspace.capacity = rows;
+    }
+
+    // Shuffled rows are gathered once; in order they are read in place
+    ConstMatrixView inputs(epoch.inputs.data() + begin * input_cols, rows, input_cols);
+    ConstMatrixView targets(epoch.targets.data() + begin * target_cols, rows, target_cols);
+    if (epoch.order) {
+        if (!workspace.inputs) {
+            workspace.inputs.emplace(workspace.capacity, input_cols, Matrix::Uninitialized{});
+            workspace.targets.emplace(workspace.capacity, target_cols, Matrix::Uninitialized{});
+        }
+        for (size_t i = 0; i < rows; ++i) {
+            size_t row = (*epoch.order)[begin + i];
+            std::memcpy(workspace.inputs->data() + i * input_cols,
+                        epoch.inputs.data() + row * input_cols, input_cols * sizeof(float));
+            std::memcpy(workspace.targets->data() + i * target_cols,
+                        epoch.targets.data() + row * target_cols, target_cols * sizeof(float));
+        }
+        inputs = workspace.inputs->view().row_range(0, rows);
+        targets = workspace.targets->view().row_range(0, rows);
+    }
+
+    ConstMatrixView x = inputs;
+    for (size_t i = 0; i < layers.size(); ++i) {
+        MatrixView output = workspace.activations[i].view().row_range(0, rows);
+        gemm_bias_activation(output, x, layers[i].get_weights().view(), layers[i].get_biases().data(),
+                             layers[i].get_activation());
+        x = output;
+    }
+
+    // dL/dy = (y - t) * scale, as NeuralNetwork::backward() with the
+    // minibatch's row count in scale
+    double loss = 0.0;
+    MatrixView gradient = workspace.gradients.back().view().row_range(0, rows);
+    for (size_t i = 0; i < rows; ++i) {
+        const float* y = x.data() + i * x.row_stride();
+        const float* t = targets.data() + i * targets.row_stride();
+        float* g = gradient.data() + i * gradient.row_stride();
+        for (size_t j = 0; j < target_cols; ++j) {
+            float d = y[j] - t[j];
+            loss += static_cast<double>(d) * d;
+            g[j] = d * scale;
+        }
+    }
+
+    for (size_t i = layers.size(); i-- > 0;) {
+        const Layer& layer = layers[i];
+        size_t outputs = layer.output_size();
+        // The delta overwrites the gradient; the kernel is element-wise
+        MatrixView delta = workspace.gradients[i].view().row_range(0, rows);
+        activation_backward(delta, delta, workspace.activations[i].view().row_range(0, rows),
+                            layer.get_activation());
+        ConstMatrixView previous = i ? ConstMatrixView(workspace.activations[i - 1].view().row_range(0, rows))
+                                     : inputs;
+        gemm(MatrixView(gradients + weight_offsets_[i], layer.input_size(), outputs),
+             previous.transposed(), delta);
+        column_sum(gradients + bias_offsets_[i], delta.data(), rows, outputs);
+        if (i > 0) {
+            gemm(workspace.gradients[i - 1].view().row_range(0, rows), delta,
+                 layer.get_weights().view().transposed());
+        }
+    }
+    return loss;
+}
+
+void DataParallelTrainer::reduce_shards(Workspace& workspace, const Epoch& epoch, const Step& step,
+                                        size_t first, size_t last, size_t level) const {
+    float* gradients = parameter_gradients(workspace, level);
+    if (last - first == 1) {
+        step.losses[first] = run_shard(workspace, epoch, step.shard_begin(first),
+                                       step.shard_begin(first + 1), step.scale, gradients);
+        return;
+    }
+    // The left subtree reuses this level, the right one the next
+    size_t mid = first + (last - first) / 2;
+    reduce_shards(workspace, epoch, step, first, mid, level);
+    reduce_shards(workspace, epoch, step, mid, last, level + 1);
+    simd_add(gradients, workspace.parameters[level + 1].data(), parameter_count_);
+}
+
+void DataParallelTrainer::reduce_workspaces(size_t first, size_t last, size_t offset, size_t count) {
+    if (last - first <= 1) {
+        return;
+    }
+    size_t mid = first + (last - first) / 2;
+    reduce_workspaces(first, mid, offset, count);
+    reduce_workspaces(mid, last, offset, count);
+    simd_add(workspaces_[first].parameters[0].data() + offset,
+             workspaces_[mid].parameters[0].data() + offset, count);
+}
+
+double DataParallelTrainer::train_synchronous(const Epoch& epoch, size_t begin, size_t rows,
+                                              float learning_rate) {
+    // Every worker takes one shard, or in deterministic mode a subtree of a
+    // fixed number of shards
+    size_t shards = std::min(config_.deterministic ? TRAINER_DETERMINISTIC_SHARDS : num_workers_, rows);
+    size_t groups = std::min(num_workers_, shards);
+    std::vector<std::pair<size_t, size_t>> ranges;
+    split_tree(0, shards, groups, ranges);
+    std::vector<double> losses(shards);
+    Step step{begin, rows, shards, 1.0f / static_cast<float>(rows), losses};
+
+    ThreadPool& pool = ThreadPool::instance();
+    {
+        ProfileScope scope("DataParallelTrainer::shards");
+        pool.parallel_for(groups, [&](size_t group) {
+            reduce_shards(workspaces_[group], epoch, step, ranges[group].first, ranges[group].second, 0);
+        });
+    }
+    {
+        // Block by block, so each block of every workspace is read once
+        ProfileScope scope("DataParallelTrainer::reduce", static_cast<double>(groups - 1) * parameter_count_,
+                           8.0 * (groups - 1) * parameter_count_);
+        size_t blocks = (parameter_count_ + TRAINER_REDUCE_BLOCK - 1) / TRAINER_REDUCE_BLOCK;
+        pool.parallel_for(blocks, [&](size_t block) {
+            size_t offset = block * TRAINER_REDUCE_BLOCK;
+            reduce_workspaces(0, groups, offset, std::min(TRAINER_REDUCE_BLOCK, parameter_count_ - offset));
+        });
+    }
+
+    OptimizerConfig optimizer = network_.get_optimizer();
+    optimizer.learning_rate = learning_rate;
+    const float* gradients = workspaces_[0].parameters[0].data();
+    std::vector<Layer>& layers = network_.get_layers();
+    for (size_t i = 0; i < layers.size(); ++i) {
+        ProfileScope scope("Layer::update_weights", 0.0, 0.0, static_cast<int64_t>(i));
+        layers[i].update_weights(optimizer, gradients + weight_offsets_[i], gradients + bias_offsets_[i]);
+    }
+    return std::accumulate(losses.begin(), losses.end(), 0.0);
+}
+
+double DataParallelTrainer::train_hogwild(const Epoch& epoch, float learning_rate, size_t steps) {
+    size_t rows = epoch.inputs.rows();
+    std::vector<double> losses(steps);
+    std::vector<Layer>& layers = network_.get_layers();
+    std::atomic<size_t> next_step{0};
+    ProfileScope scope("DataParallelTrainer::hogwild");
+    ThreadPool::instance().parallel_for(std::min(num_workers_, steps), [&](size_t worker) {
+        Workspace& workspace = workspaces_[worker];
+        float* gradients = parameter_gradients(workspace, 0);
+        for (size_t s; (s = next_step.fetch_add(1, std::memory_order_relaxed)) < steps;) {
+            size_t begin = s * config_.batch_size;
+            size_t end = std::min(begin + config_.batch_size, rows);
+            losses[s] = run_shard(workspace, epoch, begin, end, 1.0f / static_cast<float>(end - begin),
+                                  gradients);
+            // Other workers may be reading or writing these weights right now
+            for (size_t i = 0; i < layers.size(); ++i) {
+                Matrix& weights = layers[i].get_weights();
+                Matrix& biases = layers[i].get_biases();
+                sgd_update(weights.data(), gradients + weight_offsets_[i],
+                           weights.rows() * weights.cols(), learning_rate);
+                sgd_update(biases.data(), gradients + bias_offsets_[i], biases.cols(), learning_rate);
+            }
+        }
+    });
+    return std::accumulate(losses.begin(), losses.end(), 0.0);
+}
+
+EpochStats DataParallelTrainer::train_epoch(const Matrix& inputs, const Matrix& targets,
+                                            float learning_rate) {
+    ProfileScope scope("DataParallelTrainer::train_epoch");
+    auto start = std::chrono::steady_clock::now();
+    std::vector<Layer>& layers = network_.get_layers();
+    if (layers.empty()) {
+        throw std::logic_error("Cannot train an empty network");
+    }
+    if (inputs.cols() != layers.front().input_size()) {
+        throw std::invalid_argument("Input width must match the network's input size");
+    }
+    if (targets.rows() != inputs.rows() || targets.cols() != layers.back().output_size()) {
+        throw std::invalid_argument("Targets must have one row of network outputs per input row");
+    }
+    // Matrices are never empty today; the mean loss below would be NaN
+    if (inputs.rows() == 0) {
+        throw std::invalid_argument("Cannot train on an empty dataset");
+    }
+    if (config_.mode == TrainingMode::Hogwild && network_.get_optimizer().type != OptimizerType::SGD) {
+        throw std::invalid_argument("Hogwild training supports only the SGD optimizer");
+    }
+    for (Layer& layer : layers) {
+        layer.get_weights(); // Throws for half-precision weights before any work starts
+        layer.densify();
+    }
+    plan_parameters();
+    if (workspaces_.size() < num_workers_) {
+        workspaces_.resize(num_workers_);
+    }
+
+    std::vector<size_t> order;
+    if (config_.shuffle) {
+        order.resize(inputs.rows());
+        std::iota(order.begin(), order.end(), size_t{0});
+        std::seed_seq seed{static_cast<uint32_t>(config_.seed), static_cast<uint32_t>(config_.seed >> 32),
+                           static_cast<uint32_t>(epochs_)};
+        std::mt19937_64 rng(seed);
+        std::shuffle(order.begin(), order.end(), rng);
+    }
+    ++epochs_;
+    Epoch epoch{inputs, targets, config_.shuffle ? &order : nullptr};
+
+    EpochStats stats;
+    size_t rows = inputs.rows();
+    stats.steps = (rows + config_.batch_size - 1) / config_.batch_size;
+    double loss = 0.0;
+    if (config_.mode == TrainingMode::Hogwild) {
+        loss = train_hogwild(epoch, learning_rate, stats.steps);
+    } else {
+        for (size_t begin = 0; begin < rows; begin += config_.batch_size) {
+            loss += train_synchronous(epoch, begin, std::min(config_.batch_size, rows - begin), learning_rate);
+        }
+    }
+    stats.loss = static_cast<float>(loss / (2.0 * rows));
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+} // namespace ml
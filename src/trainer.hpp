@@ -0,0 +1,123 @@
+#pragma once
+#include "neural.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace ml {
+
+// How DataParallelTrainer workers share the weights
+enum class TrainingMode {
+    Synchronous, // Shard gradients are reduced and applied once per minibatch
+    Hogwild      // Each worker applies SGD to the shared weights without locking
+};
+
+// Shards per minibatch in deterministic mode, fixed so that results do not
+// depend on the worker count
+constexpr size_t TRAINER_DETERMINISTIC_SHARDS = 16;
+
+// Floats per block of the gradient reduction; the workers' copies of one
+// block stay in L2 while the whole reduction tree is walked over it
+constexpr size_t TRAINER_REDUCE_BLOCK = 4096;
+
+// Settings for DataParallelTrainer
+struct TrainerConfig {
+    size_t batch_size = 256;       // Rows per optimizer step
+    size_t num_workers = 0;        // Workers with their own workspace; 0 takes get_num_threads()
+    TrainingMode mode = TrainingMode::Synchronous;
+    bool deterministic = false;    // Bitwise identical results for any num_workers (Synchronous only)
+    bool shuffle = true;           // Visit the rows in a new order every epoch
+    uint64_t seed = 0;             // Seed of the shuffle order
+};
+
+// Counters from one train_epoch() call
+struct EpochStats {
+    float loss = 0;      // Loss as mse_loss() over all rows, each measured before its own step
+    size_t steps = 0;    // Minibatches trained
+    double seconds = 0;  // Wall time of the epoch
+};
+
+// DataParallelTrainer class: Multi-threaded minibatch training of a network
+// Synchronous mode cuts every minibatch into contiguous shards, one per
+// worker. Each worker runs forward and backward over its shard in its own
+// activation and gradient buffers, reading the shared weights, with its GEMMs
+// running single-threaded on that worker. The shard gradients are summed by
+// a pairwise tree, block by block so that partial sums stay in cache, and the
+// network's optimizer applies the sum once per step: the same update
+// NeuralNetwork::backward() makes for the whole minibatch. The summation
+// order is fixed, so runs repeat bitwise for a given num_workers. With
+// deterministic set, every minibatch is cut into TRAINER_DETERMINISTIC_SHARDS
+// shards and each worker reduces a whole subtree of them, so results also
+// repeat across thread counts and machines with the same kernels.
+// Hogwild mode lets each worker train whole minibatches of its own and apply
+// plain SGD to the shared weights without locks. Updates may interleave and
+// overwrite each other, which SGD tolerates well in practice; workers never
+// wait for a reduction, but runs are not reproducible
+class DataParallelTrainer {
+public:
+    // network: Network to train; must outlive the trainer and not be used by
+    //          other threads while train_epoch() runs
+    // Throws std::invalid_argument for a zero batch size or a deterministic
+    // Hogwild configuration
+    DataParallelTrainer(NeuralNetwork& network, TrainerConfig config = {});
+
+    // Train one pass over the rows of inputs with the network's optimizer
+    // Layers running sparse are densified first, as any update would do
+    // inputs: rows x input_size of the first layer
+    // targets: rows x output_size of the last layer
+    // learning_rate: Step size given to the optimizer
+    // Throws std::invalid_argument for mismatched shapes, inputs without rows
+    // or Hogwild with an optimizer other than SGD, std::logic_error for an
+    // empty network or half-precision layers
+    EpochStats train_epoch(const Matrix& inputs, const Matrix& targets, float learning_rate);
+
+    const TrainerConfig& config() const { return config_; }
+
+private:
+    // Buffers of one worker, grown to the largest shard seen
+    struct Workspace {
+        std::vector<Matrix> activations;  // Output of each layer
+        std::vector<Matrix> gradients;    // dL/d(output) of each layer, turned into delta in place
+        std::optional<Matrix> inputs;     // Shard rows gathered in shuffled order
+        std::optional<Matrix> targets;
+        std::vector<Matrix> parameters;   // dW and db of every layer, one copy per reduction level
+        size_t capacity = 0;              // Rows the buffers above hold
+    };
+    struct Epoch;
+    struct Step;
+
+    // Lay out every layer's dW and db in one flat buffer; drops the
+    // workspaces when the network's shape changed
+    void plan_parameters();
+    float* parameter_gradients(Workspace& workspace, size_t level) const;
+
+    // Forward and backward over rows [begin, end) of the epoch order
+    // Writes dW and db, scaled by scale, into gradients and returns the
+    // summed squared error of the rows
+    double run_shard(Workspace& workspace, const Epoch& epoch, size_t begin, size_t end,
+                     float scale, float* gradients) const;
+
+    // Sum the gradients of shards [first, last) into level of workspace,
+    // pairing them as the halving tree over all shards of the step does
+    void reduce_shards(Workspace& workspace, const Epoch& epoch, const Step& step,
+                       size_t first, size_t last, size_t level) const;
+
+    // Sum the level 0 gradients of workspaces [first, last) into the first one
+    void reduce_workspaces(size_t first, size_t last, size_t offset, size_t count);
+
+    double train_synchronous(const Epoch& epoch, size_t begin, size_t rows, float learning_rate);
+    double train_hogwild(const Epoch& epoch, float learning_rate, size_t steps);
+
+    NeuralNetwork& network_;
+    TrainerConfig config_;
+    size_t num_workers_;
+    std::vector<Workspace> workspaces_;
+    std::vector<size_t> layer_sizes_;     // Input size, then each layer's output size
+    std::vector<size_t> weight_offsets_;  // Start of each layer's dW in a gradient buffer
+    std::vector<size_t> bias_offsets_;    // Start of each layer's db
+    size_t parameter_count_ = 0;          // Floats per gradient buffer
+    uint64_t epochs_ = 0;                 // Epochs trained, mixed into the shuffle seed
+};
+
+} // namespace ml
@@ -0,0 +1,57 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace ml {
+
+// WorkQueue class: FIFO of tasks executed by dedicated background threads
+// Used for asynchronous entry points such as NeuralNetwork::forward_async.
+// Tasks may themselves use the ThreadPool; the queue threads are not pool
+// workers, so a task's GEMMs still run in parallel
+class WorkQueue {
+public:
+    // Start num_threads background threads (at least one)
+    explicit WorkQueue(size_t num_threads = 1);
+
+    // Runs every task still queued, then joins the threads
+    ~WorkQueue();
+
+    WorkQueue(const WorkQueue&) = delete;
+    WorkQueue& operator=(const WorkQueue&) = delete;
+
+    // Append a task; it runs on one of the queue threads in submission order
+    // Exceptions escaping task are swallowed, use enqueue() to observe them
+    void submit(std::function<void()> task);
+
+    // Append fn and return a future for its result (or exception)
+    template <typename F>
+    std::future<std::invoke_result_t<F>> enqueue(F&& fn) {
+        using Result = std::invoke_result_t<F>;
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(fn));
+        std::future<Result> future = task->get_future();
+        submit([task] { (*task)(); });
+        return future;
+    }
+
+    // Number of tasks waiting to start
+    size_t pending() const;
+
+private:
+    void worker_loop();
+
+    std::vector<std::thread> threads_;
+    mutable std::mutex mutex_;          // Guards tasks_ and stopping_
+    std::condition_variable ready_;     // Signals that a task or stop request arrived
+    std::deque<std::function<void()>> tasks_;
+    bool stopping_ = false;
+};
+
+} // namespace ml
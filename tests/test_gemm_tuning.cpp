@@ -0,0 +1,247 @@
+#include "../src/cpu_dispatch.hpp"
+#include "../src/gemm_tuning.hpp"
+#include "../src/neural.hpp"
+#include "../src/thread_pool.hpp"
+#include <unistd.h>
+#include <cassert>
+#include <cstdlib>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Naive a * b over row-major inputs
+std::vector<float> reference(const std::vector<float>& a, const std::vector<float>& b, size_t m, size_t n, size_t k) {
+    std::vector<float> c(m * n, 0.0f);
+    for (size_t i = 0; i < m; ++i) {
+        for (size_t p = 0; p < k; ++p) {
+            for (size_t j = 0; j < n; ++j) {
+                c[i * n + j] += a[i * k + p] * b[p * n + j];
+            }
+        }
+    }
+    return c;
+}
+
+template <typename Error>
+bool throws(void (*call)(const std::string&), const std::string& path) {
+    try {
+        call(path);
+    } catch (const Error&) {
+        return true;
+    }
+    return false;
+}
+
+void load(const std::string& path) { ml::load_gemm_tuning(path); }
+
+// Cache with one plan per kernel variant for the shape bucket of m = n = k,
+// in the format save_gemm_tuning writes
+void write_cache(const std::string& path, size_t size) {
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line, model = "unknown";
+    while (std::getline(cpuinfo, line)) {
+        if (line.compare(0, 10, "model name") == 0) {
+            model = line.substr(line.find_first_not_of(" \t", line.find(':') + 1));
+            break;
+        }
+    }
+    size_t bucket = ml::GemmTuningTable::bucket(size);
+    std::ofstream out(path);
+    out << "mlcpp-gemm-tuning 1\ncpu " << model << '\n';
+    for (const std::string& isa : ml::available_kernel_isas()) {
+        out << isa << ' ' << bucket << ' ' << bucket << ' ' << bucket << " 48 128 256 1 1 1\n";
+    }
+}
+
+void test_explicit_load_before_first_gemm() {
+    // The host cache loads on first kernel use; plans loaded before that must
+    // not be replaced by it. Runs first, before anything dispatches
+    std::string prefix = "/tmp/mlcpp_gemm_tuning_first_" + std::to_string(getpid());
+    write_cache(prefix + "_host.txt", 64);
+    write_cache(prefix + "_explicit.txt", 8);
+    setenv("MLCPP_GEMM_TUNING", (prefix + "_host.txt").c_str(), 1);
+    assert(ml::load_gemm_tuning(prefix + "_explicit.txt") == ml::available_kernel_isas().size());
+    assert(ml::find_gemm_plan(8, 8, 8) != nullptr);
+    assert(ml::find_gemm_plan(64, 64, 64) == nullptr);
+    ml::clear_gemm_tuning();
+    assert(ml::find_gemm_plan(8, 8, 8) == nullptr);
+    std::remove((prefix + "_host.txt").c_str());
+    std::remove((prefix + "_explicit.txt").c_str());
+    unsetenv("MLCPP_GEMM_TUNING");
+}
+
+void test_buckets() {
+    assert(ml::GemmTuningTable::bucket(1) == 0);
+    assert(ml::GemmTuningTable::bucket(2) == 1);
+    assert(ml::GemmTuningTable::bucket(5) == 3);
+    assert(ml::GemmTuningTable::bucket(8) == 3);
+    assert(ml::GemmTuningTable::bucket(1024) == 10);
+    assert(ml::GemmTuningTable::bucket(1025) == 11);
+    assert(ml::GemmTuningTable::bucket(size_t{1} << 40) == ml::GemmTuningTable::BUCKETS - 1);
+
+    ml::GemmTuningTable table;
+    ml::GemmPlan plan{{48, 128, 256}, 1, 2, 2};
+    table.set({3, 10, 10, plan});
+    table.set({0, 10, 10, plan});
+    assert(table.find(8, 1000, 600) && table.find(8, 1000, 600)->blocking.kc == 128);
+    assert(table.find(5, 513, 1024) != nullptr);
+    assert(table.find(9, 1000, 600) == nullptr);
+    assert(table.find(1, 1000, 600) != nullptr);
+    assert(table.entries().size() == 2 && table.entries()[0].m_bucket == 0);
+
+    bool threw = false;
+    try {
+        table.set({3, 10, 10, {{0, 128, 256}, 1, 1, 1}});
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+}
+
+void test_planned_gemm() {
+    // Odd block sizes and splits, also ones beyond the tile counts, give the
+    // same product on every kernel variant
+    const size_t m = 37, n = 70, k = 129;
+    std::vector<float> a(m * k), b(k * n);
+    for (size_t i = 0; i < a.size(); ++i) a[i] = static_cast<float>(i % 11) * 0.125f - 0.5f;
+    for (size_t i = 0; i < b.size(); ++i) b[i] = static_cast<float>(i % 7) * 0.25f - 0.75f;
+    std::vector<float> expected = reference(a, b, m, n, k);
+
+    size_t threads = ml::get_num_threads();
+    ml::set_num_threads(4);
+    const ml::GemmPlan plans[] = {
+        {{6, 16, 32}, 1, 1, 4},
+        {{13, 50, 40}, 2, 2, 4},
+        {{300, 1000, 1000}, 4, 1, 4},
+        {{7, 1, 17}, 1, 4, 4},
+        {{64, 64, 64}, 9, 9, 4},
+        {{64, 64, 64}, 2, 2, 3}, // Tuned for another pool size: default split
+    };
+    for (const std::string& isa : ml::available_kernel_isas()) {
+        const ml::KernelTable& kernels = ml::kernel_table_for(isa);
+        for (const ml::GemmPlan& plan : plans) {
+            std::vector<float> c(m * n, -1.0f);
+            kernels.gemm_planned(c.data(), n, a.data(), k, 1, b.data(), n, 1, m, n, k, plan);
+            for (size_t i = 0; i < c.size(); ++i) {
+                assert(std::abs(c[i] - expected[i]) < 1e-3f);
+            }
+        }
+    }
+    ml::set_num_threads(threads);
+}
+
+void test_tune_and_cache() {
+    ml::clear_gemm_tuning();
+    assert(ml::find_gemm_plan(8, 200, 100) == nullptr);
+    ml::GemmTuneResult result = ml::tune_gemm(8, 200, 100);
+    assert(result.tuned_seconds > 0 && result.tuned_seconds <= result.default_seconds);
+    const ml::GemmPlan* plan = ml::find_gemm_plan(7, 256, 128);
+    assert(plan && plan->blocking.kc == result.plan.blocking.kc);
+
+    // The tuned plan now serves every product of the bucket
+    const size_t m = 6, n = 230, k = 97;
+    ml::Matrix a(m, k), b(k, n);
+    for (size_t i = 0; i < m * k; ++i) a.data()[i] = static_cast<float>(i % 5) * 0.5f - 1.0f;
+    for (size_t i = 0; i < k * n; ++i) b.data()[i] = static_cast<float>(i % 9) * 0.125f - 0.5f;
+    ml::Matrix c = a * b;
+    std::vector<float> expected = reference(std::vector<float>(a.data(), a.data() + m * k),
+                                            std::vector<float>(b.data(), b.data() + k * n), m, n, k);
+    for (size_t i = 0; i < m * n; ++i) {
+        assert(std::abs(c.data()[i] - expected[i]) < 1e-3f);
+    }
+
+    std::string path = "/tmp/mlcpp_gemm_tuning_test_" + std::to_string(getpid()) + "/cache.txt";
+    ml::save_gemm_tuning(path);
+    ml::clear_gemm_tuning();
+    assert(ml::find_gemm_plan(8, 200, 100) == nullptr);
+    assert(ml::load_gemm_tuning(path) == 1);
+    plan = ml::find_gemm_plan(8, 200, 100);
+    assert(plan && plan->blocking.mc == result.plan.blocking.mc && plan->m_parts == result.plan.m_parts);
+
+    // Lines of unknown variants are skipped, malformed ones and caches from
+    // other CPUs are rejected without touching the loaded plans
+    std::ifstream in(path);
+    std::string magic, cpu, entry;
+    std::getline(in, magic);
+    std::getline(in, cpu);
+    std::getline(in, entry);
+    in.close();
+    {
+        std::ofstream out(path);
+        out << magic << '\n' << cpu << '\n' << entry << "\nneon 1 1 1 8 8 8 1 1 1\n";
+    }
+    assert(ml::load_gemm_tuning(path) == 1);
+    {
+        std::ofstream out(path);
+        out << magic << '\n' << cpu << '\n' << entry << " 7\n";
+    }
+    assert(throws<std::runtime_error>(load, path));
+    {
+        std::ofstream out(path);
+        out << magic << '\n' << "cpu Imaginary CPU 9000\n" << entry << '\n';
+    }
+    assert(throws<std::runtime_error>(load, path));
+    assert(throws<std::runtime_error>(load, path + ".missing"));
+    assert(ml::find_gemm_plan(8, 200, 100) != nullptr);
+
+    std::remove(path.c_str());
+    std::remove(path.substr(0, path.rfind('/')).c_str());
+    ml::clear_gemm_tuning();
+    assert(ml::find_gemm_plan(8, 200, 100) == nullptr);
+}
+
+void test_clear_every_variant() {
+    // Plans for several variants at once; clearing and reloading drop each
+    // variant's table in turn (run under -fsanitize=address as well)
+    std::string original = ml::get_kernel_isa();
+    std::vector<std::string> isas = ml::available_kernel_isas();
+    for (const std::string& isa : isas) {
+        ml::set_kernel_isa(isa);
+        ml::tune_gemm(4, 64, 32);
+    }
+    std::string path = "/tmp/mlcpp_gemm_tuning_variants_" + std::to_string(getpid()) + ".txt";
+    ml::save_gemm_tuning(path);
+    assert(ml::load_gemm_tuning(path) == isas.size());
+    std::remove(path.c_str());
+    ml::clear_gemm_tuning();
+    for (const std::string& isa : isas) {
+        ml::set_kernel_isa(isa);
+        assert(ml::find_gemm_plan(4, 64, 32) == nullptr);
+    }
+    ml::set_kernel_isa(original);
+}
+
+void test_network_shapes() {
+    ml::NeuralNetwork network;
+    network.add_layer(20, 30, ml::ActivationType::ReLU);
+    network.add_layer(30, 4, ml::ActivationType::Sigmoid);
+    std::vector<ml::GemmShape> shapes = ml::network_gemm_shapes(network, {1, 16});
+    assert(shapes.size() == 4);
+    assert(shapes[0].m == 1 && shapes[0].n == 30 && shapes[0].k == 20);
+    assert(shapes[3].m == 16 && shapes[3].n == 4 && shapes[3].k == 30);
+    shapes = ml::network_gemm_shapes(network, {16}, true);
+    assert(shapes.size() == 6);
+    assert(shapes[1].m == 20 && shapes[1].n == 30 && shapes[1].k == 16);
+    assert(shapes[2].m == 16 && shapes[2].n == 20 && shapes[2].k == 30);
+
+    // One tuning run per bucket: batches 5 and 8 share theirs
+    auto tuned = ml::tune_network(network, {5, 8});
+    assert(tuned.size() == 2);
+    assert(ml::find_gemm_plan(6, 32, 17) && ml::find_gemm_plan(7, 3, 32));
+    ml::clear_gemm_tuning();
+}
+
+int main() {
+    test_explicit_load_before_first_gemm();
+    test_buckets();
+    test_planned_gemm();
+    test_tune_and_cache();
+    test_clear_every_variant();
+    test_network_shapes();
+    std::cout << "All GEMM tuning tests passed!" << std::endl;
+    return 0;
+}
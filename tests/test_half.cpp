@@ -0,0 +1,161 @@
+#include "../src/half.hpp"
+#include "../src/cpu_dispatch.hpp"
+#include "../src/gemm.hpp"
+#include "../src/model_io.hpp"
+#include "../src/neural.hpp"
+#include "../src/thread_pool.hpp"
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+void test_conversions() {
+    // Every finite 16-bit value survives widening and narrowing again
+    for (uint32_t bits = 0; bits <= 0xffff; ++bits) {
+        auto value = static_cast<uint16_t>(bits);
+        float bf = ml::bfloat16_to_float(value);
+        float fp = ml::float16_to_float(value);
+        if (!std::isnan(bf)) assert(ml::float_to_bfloat16(bf) == value);
+        if (!std::isnan(fp)) assert(ml::float_to_float16(fp) == value);
+    }
+
+    // Round to nearest, ties to even
+    assert(ml::float_to_bfloat16(1.0f + 1.0f / 256) == ml::float_to_bfloat16(1.0f));
+    assert(ml::bfloat16_to_float(ml::float_to_bfloat16(1.0f + 3.0f / 256)) == 1.0f + 4.0f / 256);
+    assert(ml::float_to_float16(1.0f + 1.0f / 2048) == 0x3c00);
+    assert(ml::float_to_float16(1.0f + 3.0f / 2048) == 0x3c02);
+
+    // float16 range: largest finite, overflow, subnormals
+    assert(ml::float16_to_float(ml::float_to_float16(65504.0f)) == 65504.0f);
+    assert(ml::float_to_float16(65519.0f) == 0x7bff);
+    assert(ml::float_to_float16(65520.0f) == 0x7c00);
+    assert(ml::float_to_float16(-1e10f) == 0xfc00);
+    assert(ml::float_to_float16(std::ldexp(1.0f, -24)) == 0x0001);
+    assert(ml::float_to_float16(std::ldexp(1.0f, -25)) == 0x0000);
+    assert(ml::float_to_float16(std::ldexp(3.0f, -26)) == 0x0001);
+    assert(ml::float_to_float16(std::ldexp(1023.5f, -24)) == 0x0400);
+    float nan = std::numeric_limits<float>::quiet_NaN();
+    assert(std::isnan(ml::float16_to_float(ml::float_to_float16(nan))));
+    assert(std::isnan(ml::bfloat16_to_float(ml::float_to_bfloat16(nan))));
+
+    bool threw = false;
+    try {
+        ml::HalfMatrix bad(ml::Matrix(2, 2), ml::Precision::Float32);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+}
+
+void test_half_gemm_matches_widened() {
+    // The kernels widen exactly the values to_float() produces, so results
+    // match a float GEMM on the widened weights; the shapes cover edge
+    // tiles, vector tails of the conversions and a threaded product
+    const size_t shapes[][3] = {{1, 37, 29}, {7, 70, 45}, {64, 300, 260}};
+    std::string original = ml::get_kernel_isa();
+    for (const std::string& isa : ml::available_kernel_isas()) {
+        ml::set_kernel_isa(isa);
+        for (const auto& shape : shapes) {
+            size_t m = shape[0], k = shape[1], n = shape[2];
+            ml::Matrix a(m, k), w(k, n);
+            for (size_t i = 0; i < m * k; ++i) a.data()[i] = static_cast<float>(i % 13) * 0.1f - 0.6f;
+            for (size_t i = 0; i < k * n; ++i) w.data()[i] = static_cast<float>(i % 29) * 0.013f - 0.19f;
+            std::vector<float> bias(n);
+            for (size_t j = 0; j < n; ++j) bias[j] = static_cast<float>(j % 5) * 0.1f - 0.2f;
+
+            for (ml::Precision precision : {ml::Precision::BFloat16, ml::Precision::Float16}) {
+                ml::HalfMatrix half(w, precision);
+                assert(half.bytes() == k * n * 2);
+                ml::Matrix widened = half.to_float();
+                ml::Matrix expected(m, n), result(m, n);
+                ml::gemm_bias_activation(expected.view(), a.view(), widened.view(), bias.data(),
+                                         ml::ActivationType::Tanh);
+                ml::gemm_bias_activation(result.view(), a.view(), half, bias.data(), ml::ActivationType::Tanh);
+                for (size_t i = 0; i < m * n; ++i) {
+                    assert(result.data()[i] == expected.data()[i]);
+                }
+            }
+        }
+    }
+    ml::set_kernel_isa(original);
+}
+
+void test_half_layer() {
+    const std::string path = "test_half_model.bin";
+    ml::NeuralNetwork nn;
+    nn.add_layer(40, 64, ml::ActivationType::ReLU);
+    nn.add_layer(64, 5, ml::ActivationType::Sigmoid);
+    ml::Matrix input(9, 40);
+    for (size_t i = 0; i < 9; ++i)
+        for (size_t j = 0; j < 40; ++j)
+            input.at(i, j) = static_cast<float>((i * 40 + j) % 13) * 0.1f - 0.6f;
+    ml::Matrix reference = nn.forward(input);
+
+    for (ml::Precision precision : {ml::Precision::BFloat16, ml::Precision::Float16}) {
+        nn.set_weight_precision(precision);
+        const ml::Layer& layer = nn.get_layers()[0];
+        assert(layer.get_weight_precision() == precision);
+        assert(layer.get_half_weights() != nullptr && layer.get_half_weights()->bytes() == 40 * 64 * 2);
+        assert(layer.input_size() == 40 && layer.output_size() == 64);
+        float tolerance = precision == ml::Precision::BFloat16 ? 2e-2f : 2e-3f;
+        ml::Matrix out = nn.forward(input);
+        for (size_t i = 0; i < out.rows() * out.cols(); ++i) {
+            assert(std::abs(out.data()[i] - reference.data()[i]) < tolerance);
+        }
+
+        // Half-precision layers are inference-only
+        bool threw = false;
+        try {
+            nn.backward(out, 0.1f);
+        } catch (const std::logic_error&) {
+            threw = true;
+        }
+        assert(threw);
+        threw = false;
+        try {
+            layer.get_weights();
+        } catch (const std::logic_error&) {
+            threw = true;
+        }
+        assert(threw);
+
+        // Saved at 16 bits and loaded as views into the mapping
+        ml::save_network(nn, path);
+        auto loaded = ml::load_network(path);
+        const ml::HalfMatrix* half = loaded->get_layers()[1].get_half_weights();
+        assert(half != nullptr && half->precision() == precision);
+        assert(reinterpret_cast<std::uintptr_t>(half->data()) % 64 == 0);
+        ml::Matrix loaded_out = loaded->forward(input);
+        for (size_t i = 0; i < out.rows() * out.cols(); ++i) {
+            assert(loaded_out.data()[i] == out.data()[i]);
+        }
+        std::remove(path.c_str());
+    }
+
+    // Widening back makes the network trainable again
+    nn.set_weight_precision(ml::Precision::Float32);
+    assert(nn.get_layers()[0].get_half_weights() == nullptr);
+    ml::Matrix out = nn.forward(input);
+    nn.backward(reference, 0.1f);
+    for (size_t i = 0; i < out.rows() * out.cols(); ++i) {
+        assert(std::abs(out.data()[i] - reference.data()[i]) < 2e-2f);
+    }
+}
+
+int main() {
+    test_conversions();
+    test_half_gemm_matches_widened();
+    test_half_layer();
+    // Again with several workers, so the threaded GEMM path widens its own
+    // panels regardless of the host's core count
+    size_t threads = ml::get_num_threads();
+    ml::set_num_threads(4);
+    test_half_gemm_matches_widened();
+    ml::set_num_threads(threads);
+    std::cout << "All half-precision tests passed!" << std::endl;
+    return 0;
+}
@@ -1,7 +1,15 @@
 #include "../src/matrix.hpp"
+#include "../src/gemm.hpp"
+#include "../src/cpu_dispatch.hpp"
+#include "../src/optimizations.hpp"
 #include <cassert>
 #include <cmath>
+#include <cstdint>
 #include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 void test_matrix_creation() {
     ml::Matrix m(3, 4);
@@ -42,9 +50,320 @@ void test_matrix_operations() {
     assert(std::abs(d.at(1, 1) - 50.0f) < 1e-6);
 }
 
+void test_multiply_matches_reference() {
+    // Shapes chosen to exercise full tiles, MR/NR edge tiles and multiple KC blocks
+    const size_t shapes[][3] = {{1, 1, 1}, {7, 17, 5}, {6, 16, 300}, {65, 33, 129}, {128, 96, 700}};
+    for (const auto& shape : shapes) {
+        size_t m = shape[0], n = shape[1], k = shape[2];
+        ml::Matrix a(m, k);
+        ml::Matrix b(k, n);
+        for (size_t i = 0; i < m; ++i)
+            for (size_t p = 0; p < k; ++p)
+                a.at(i, p) = static_cast<float>((i * 7 + p * 3) % 11) - 5.0f;
+        for (size_t p = 0; p < k; ++p)
+            for (size_t j = 0; j < n; ++j)
+                b.at(p, j) = static_cast<float>((p * 5 + j * 2) % 13) - 6.0f;
+
+        ml::Matrix c = a * b;
+        assert(c.rows() == m && c.cols() == n);
+        for (size_t i = 0; i < m; ++i) {
+            for (size_t j = 0; j < n; ++j) {
+                float expected = 0.0f;
+                for (size_t p = 0; p < k; ++p) {
+                    expected += a.at(i, p) * b.at(p, j);
+                }
+                assert(std::abs(c.at(i, j) - expected) < 1e-3f * (1.0f + std::abs(expected)));
+            }
+        }
+    }
+}
+
+void test_storage_alignment_and_reuse() {
+    const float* released = nullptr;
+    for (size_t n : {1, 3, 17, 100, 1000}) {
+        ml::Matrix m(n, n + 1);
+        assert(reinterpret_cast<std::uintptr_t>(m.data()) % ml::MEMORY_ALIGNMENT == 0);
+        ml::Matrix copy(m);
+        assert(reinterpret_cast<std::uintptr_t>(copy.data()) % ml::MEMORY_ALIGNMENT == 0);
+    }
+    {
+        ml::Matrix temp(64, 64);
+        released = temp.data();
+    }
+    // Same size class on the same thread is served from the free list
+    ml::Matrix reused(64, 64);
+    assert(reused.data() == released);
+    assert(reused.at(63, 63) == 0.0f);
+}
+
+void test_move_semantics() {
+    ml::Matrix a(4, 5);
+    a.fill(2.0f);
+    const float* buffer = a.data();
+
+    ml::Matrix moved(std::move(a));
+    assert(moved.data() == buffer);
+    assert(moved.rows() == 4 && moved.cols() == 5);
+    assert(a.rows() == 0 && a.data() == nullptr);
+
+    ml::Matrix target(1, 1);
+    target = std::move(moved);
+    assert(target.data() == buffer);
+    assert(target.at(3, 4) == 2.0f);
+}
+
+void test_wrap_external_memory() {
+    // Deliberately misaligned for SIMD: offset by one float
+    std::vector<float> storage(1 + 3 * 5, 1.0f);
+    auto alive = std::make_shared<int>(0);
+    {
+        ml::Matrix wrapped = ml::Matrix::wrap(storage.data() + 1, 3, 5, alive);
+        assert(!wrapped.owns_data());
+        assert(wrapped.data() == storage.data() + 1);
+        assert(alive.use_count() == 2);
+
+        // Writes go through to the external buffer
+        wrapped.at(2, 4) = 7.0f;
+        assert(storage[15] == 7.0f);
+
+        // Unaligned SIMD paths and expressions read the wrapped data
+        ml::Matrix other(3, 5);
+        other.fill(2.0f);
+        ml::Matrix sum = wrapped + other;
+        assert(sum.owns_data());
+        assert(sum.at(0, 0) == 3.0f && sum.at(2, 4) == 9.0f);
+        wrapped.add_optimized(other);
+        assert(storage[1] == 3.0f);
+
+        // Assignment detaches into pooled storage instead of writing through
+        wrapped = other;
+        assert(wrapped.owns_data());
+        assert(storage[1] == 3.0f);
+    }
+    assert(alive.use_count() == 1);
+}
+
+void test_fused_expressions() {
+    ml::Matrix a(3, 4), b(4, 2), c(3, 2), d(3, 2);
+    a.fill(1.0f);
+    b.fill(2.0f);
+    c.fill(3.0f);
+    d.fill(0.5f);
+
+    // a * b = 8 everywhere; GEMM writes the destination, then one fused pass
+    ml::Matrix e = a * b + c - d;
+    for (size_t i = 0; i < 3; ++i)
+        for (size_t j = 0; j < 2; ++j)
+            assert(std::abs(e.at(i, j) - 10.5f) < 1e-6f);
+
+    // Product on the right-hand side of a subtraction and two products
+    ml::Matrix f = c - a * b;
+    ml::Matrix g = a * b + a * b;
+    assert(std::abs(f.at(2, 1) + 5.0f) < 1e-6f);
+    assert(std::abs(g.at(0, 0) - 16.0f) < 1e-6f);
+
+    // Assigning into an operand of the product must not corrupt the GEMM input
+    ml::Matrix sq(2, 2);
+    sq.at(0, 0) = 1.0f; sq.at(0, 1) = 2.0f;
+    sq.at(1, 0) = 3.0f; sq.at(1, 1) = 4.0f;
+    sq = sq * sq + sq;
+    assert(std::abs(sq.at(0, 0) - 8.0f) < 1e-6f);
+    assert(std::abs(sq.at(1, 1) - 26.0f) < 1e-6f);
+
+    // Element-wise expressions evaluate in place into an existing matrix
+    const float* buffer = e.data();
+    e = c + d - c;
+    assert(e.data() == buffer);
+    assert(std::abs(e.at(1, 1) - 0.5f) < 1e-6f);
+
+    // Plain a + b and a - b run the dispatched kernels, also when the
+    // destination is one of the operands
+    ml::Matrix x(5, 7), y(5, 7);
+    for (size_t i = 0; i < 35; ++i) {
+        x.data()[i] = static_cast<float>(i);
+        y.data()[i] = 0.5f * static_cast<float>(i);
+    }
+    ml::Matrix sum = x + y;
+    ml::Matrix diff = x - y;
+    assert(std::abs(sum.at(4, 6) - 51.0f) < 1e-6f && std::abs(diff.at(4, 6) - 17.0f) < 1e-6f);
+    diff = diff - y;
+    assert(std::abs(diff.at(4, 6)) < 1e-6f);
+    sum = x - sum;
+    assert(std::abs(sum.at(4, 6) + 17.0f) < 1e-6f && std::abs(sum.at(0, 1) + 0.5f) < 1e-6f);
+
+    bool threw = false;
+    try {
+        ml::Matrix bad = a + b;
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+}
+
+void test_transposed_multiply() {
+    const size_t m = 13, n = 21, k = 300;
+    std::vector<float> a(m * k), at(k * m), b(k * n), bt(n * k);
+    for (size_t i = 0; i < m; ++i)
+        for (size_t p = 0; p < k; ++p)
+            a[i * k + p] = at[p * m + i] = static_cast<float>((i + 3 * p) % 9) - 4.0f;
+    for (size_t p = 0; p < k; ++p)
+        for (size_t j = 0; j < n; ++j)
+            b[p * n + j] = bt[j * k + p] = static_cast<float>((2 * p + j) % 7) - 3.0f;
+
+    std::vector<float> reference(m * n), result(m * n);
+    ml::gemm(reference.data(), a.data(), b.data(), m, n, k);
+    const float* lhs[2] = {a.data(), at.data()};
+    const float* rhs[2] = {b.data(), bt.data()};
+    for (int ta = 0; ta < 2; ++ta) {
+        for (int tb = 0; tb < 2; ++tb) {
+            ml::gemm(result.data(), lhs[ta], rhs[tb], m, n, k, ta == 1, tb == 1);
+            for (size_t i = 0; i < m * n; ++i) {
+                assert(std::abs(result[i] - reference[i]) < 1e-3f);
+            }
+        }
+    }
+}
+
+void test_kernel_variants_agree() {
+    // Every variant the host can run must compute the same results; the
+    // shape has edge tiles for both the 16- and 32-column register tiles
+    const size_t m = 11, n = 45, k = 70;
+    std::vector<float> a(m * k), b(k * n), bias(n), grad(m * n);
+    for (size_t i = 0; i < a.size(); ++i) a[i] = static_cast<float>(i % 13) * 0.1f - 0.6f;
+    for (size_t i = 0; i < b.size(); ++i) b[i] = static_cast<float>(i % 7) * 0.05f - 0.15f;
+    for (size_t j = 0; j < n; ++j) bias[j] = static_cast<float>(j % 5) * 0.2f - 0.4f;
+    for (size_t i = 0; i < grad.size(); ++i) grad[i] = static_cast<float>(i % 3) - 1.0f;
+
+    std::string original = ml::get_kernel_isa();
+    std::vector<float> reference_out, reference_delta;
+    for (const std::string& isa : ml::available_kernel_isas()) {
+        ml::set_kernel_isa(isa);
+        assert(ml::get_kernel_isa() == isa);
+        std::vector<float> out(m * n), delta(m * n);
+        ml::gemm_bias_activation(out.data(), a.data(), b.data(), bias.data(), m, n, k,
+                                 ml::ActivationType::Tanh);
+        ml::activation_backward(delta.data(), grad.data(), out.data(), m * n, ml::ActivationType::Tanh);
+        if (reference_out.empty()) {
+            reference_out = out;
+            reference_delta = delta;
+            continue;
+        }
+        for (size_t i = 0; i < m * n; ++i) {
+            assert(std::abs(out[i] - reference_out[i]) < 1e-5f);
+            assert(std::abs(delta[i] - reference_delta[i]) < 1e-5f);
+        }
+    }
+    ml::set_kernel_isa(original);
+
+    bool threw = false;
+    try {
+        ml::set_kernel_isa("neon");
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+}
+
+void test_matrix_views() {
+    ml::Matrix m(4, 6);
+    for (size_t i = 0; i < 4; ++i)
+        for (size_t j = 0; j < 6; ++j)
+            m.at(i, j) = static_cast<float>(i * 10 + j);
+
+    // Slices and transposes share the matrix's storage
+    ml::MatrixView block = m.view().block(1, 2, 2, 3);
+    assert(block.rows() == 2 && block.cols() == 3);
+    assert(block.at(0, 0) == 12.0f && block.at(1, 2) == 24.0f);
+    assert(!block.is_contiguous() && block.unit_col_stride());
+    block.at(1, 1) = -1.0f;
+    assert(m.at(2, 3) == -1.0f);
+
+    ml::ConstMatrixView t = block.transposed();
+    assert(t.rows() == 3 && t.cols() == 2 && t.at(2, 1) == 24.0f);
+    assert(m.view().row_range(1, 3).is_contiguous());
+
+    // Copying a view materializes it densely
+    ml::Matrix copy(t);
+    assert(copy.rows() == 3 && copy.cols() == 2);
+    assert(copy.at(0, 1) == 22.0f && copy.at(1, 1) == -1.0f);
+
+    bool threw = false;
+    try {
+        m.view().col_range(4, 7);
+    } catch (const std::out_of_range&) {
+        threw = true;
+    }
+    assert(threw);
+
+    // Element-wise kernels on strided views touch only the viewed elements
+    ml::Matrix ones(2, 3);
+    ones.fill(1.0f);
+    ml::simd_add(m.view().block(0, 0, 2, 3), ones.view());
+    ml::simd_subtract(m.view().col_range(5, 6).transposed(), ml::ConstMatrixView(ones.data(), 1, 4));
+    assert(m.at(0, 0) == 1.0f && m.at(1, 2) == 13.0f && m.at(2, 0) == 20.0f);
+    assert(m.at(3, 5) == 34.0f && m.at(0, 4) == 4.0f);
+
+    // ReLU backward through a transposed view matches the flat kernel
+    ml::Matrix grad(3, 2), delta(2, 3), expected(2, 3);
+    grad.fill(2.0f);
+    ml::Matrix out(m.view().block(0, 0, 2, 3));
+    out.at(1, 2) = -3.0f;
+    ml::activation_backward(expected.data(), grad.data(), out.data(), 6, ml::ActivationType::ReLU);
+    ml::activation_backward(delta.view(), grad.view().transposed(), out.view(), ml::ActivationType::ReLU);
+    for (size_t i = 0; i < 2; ++i)
+        for (size_t j = 0; j < 3; ++j)
+            assert(delta.at(i, j) == expected.at(i, j));
+}
+
+void test_strided_gemm() {
+    // Operands are sub-blocks and transposes of larger buffers; the output
+    // is written into a window of a wider matrix in both orientations
+    const size_t m = 19, n = 37, k = 53;
+    ml::Matrix big_a(k + 3, m + 5), big_b(n + 2, k + 4);
+    for (size_t i = 0; i < big_a.rows(); ++i)
+        for (size_t j = 0; j < big_a.cols(); ++j)
+            big_a.at(i, j) = static_cast<float>((i * 7 + j) % 11) * 0.1f - 0.5f;
+    for (size_t i = 0; i < big_b.rows(); ++i)
+        for (size_t j = 0; j < big_b.cols(); ++j)
+            big_b.at(i, j) = static_cast<float>((i + 3 * j) % 13) * 0.1f - 0.6f;
+    ml::ConstMatrixView a = big_a.view().block(2, 1, k, m).transposed();
+    ml::ConstMatrixView b = big_b.view().block(1, 3, n, k).transposed();
+    ml::Matrix dense_a(a), dense_b(b);
+    ml::Matrix reference = dense_a * dense_b;
+
+    ml::Matrix c(m + 4, n + 6), ct(n + 1, m + 2);
+    ml::gemm(c.view().block(2, 3, m, n), a, b);
+    ml::gemm(ct.view().block(1, 2, n, m).transposed(), a, b);
+    for (size_t i = 0; i < m; ++i) {
+        for (size_t j = 0; j < n; ++j) {
+            assert(std::abs(c.at(i + 2, j + 3) - reference.at(i, j)) < 1e-3f);
+            assert(std::abs(ct.at(j + 1, i + 2) - reference.at(i, j)) < 1e-3f);
+        }
+    }
+    // Elements around the window are untouched
+    assert(c.at(1, 3) == 0.0f && c.at(2, 2) == 0.0f && c.at(m + 2, n + 3) == 0.0f);
+
+    bool threw = false;
+    try {
+        ml::gemm(c.view().block(0, 0, m, n + 1), a, b);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+}
+
 int main() {
     test_matrix_creation();
     test_matrix_operations();
+    test_multiply_matches_reference();
+    test_storage_alignment_and_reuse();
+    test_move_semantics();
+    test_wrap_external_memory();
+    test_fused_expressions();
+    test_transposed_multiply();
+    test_kernel_variants_agree();
+    test_matrix_views();
+    test_strided_gemm();
     std::cout << "All matrix tests passed!" << std::endl;
     return 0;
 }
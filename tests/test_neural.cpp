@@ -1,7 +1,20 @@
 #include "../src/neural.hpp"
+#include "../src/batching_server.hpp"
+#include "../src/cpu_dispatch.hpp"
+#include "../src/memory_planner.hpp"
+#include "../src/model_io.hpp"
+#include <atomic>
 #include <cassert>
 #include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
 
 void test_layer_creation() {
     ml::Layer layer(4, 3, ml::ActivationType::ReLU);
@@ -26,9 +39,422 @@ void test_forward_propagation() {
     assert(output.at(0, 0) >= 0.0f && output.at(0, 0) <= 1.0f);
 }
 
+void test_fused_epilogue_matches_reference() {
+    const ml::ActivationType types[] = {
+        ml::ActivationType::ReLU, ml::ActivationType::Sigmoid, ml::ActivationType::Tanh
+    };
+    for (auto type : types) {
+        // 700 inputs spans several depth blocks; 7 x 37 leaves edge tiles
+        ml::Layer layer(700, 37, type);
+        ml::Matrix input(7, 700);
+        for (size_t i = 0; i < input.rows(); ++i)
+            for (size_t j = 0; j < input.cols(); ++j)
+                input.at(i, j) = std::sin(0.37f * i + 0.11f * j);
+
+        ml::Matrix output = layer.forward(input);
+        const ml::Matrix& w = layer.get_weights();
+        const ml::Matrix& b = layer.get_biases();
+        for (size_t i = 0; i < output.rows(); ++i) {
+            for (size_t j = 0; j < output.cols(); ++j) {
+                double z = b.at(0, j);
+                for (size_t p = 0; p < input.cols(); ++p) {
+                    z += static_cast<double>(input.at(i, p)) * w.at(p, j);
+                }
+                double expected = type == ml::ActivationType::ReLU ? (z > 0 ? z : 0)
+                                : type == ml::ActivationType::Sigmoid ? 1.0 / (1.0 + std::exp(-z))
+                                : std::tanh(z);
+                assert(std::abs(output.at(i, j) - expected) < 1e-4);
+            }
+        }
+    }
+}
+
+void test_activations_propagate_nan() {
+    // A NaN input poisons its whole output row through the full-tile vector
+    // epilogues and the scalar edge tiles alike, on every kernel variant
+    std::string original = ml::get_kernel_isa();
+    for (const std::string& isa : ml::available_kernel_isas()) {
+        ml::set_kernel_isa(isa);
+        for (auto type : {ml::ActivationType::Sigmoid, ml::ActivationType::Tanh}) {
+            ml::Layer layer(5, 37, type);
+            ml::Matrix input(7, 5);
+            for (size_t i = 0; i < 7 * 5; ++i) input.data()[i] = 0.1f * static_cast<float>(i % 9) - 0.4f;
+            input.at(2, 3) = std::nanf("");
+            const ml::Matrix& output = layer.forward(input);
+            for (size_t i = 0; i < output.rows(); ++i)
+                for (size_t j = 0; j < output.cols(); ++j)
+                    assert(std::isnan(output.at(i, j)) == (i == 2));
+        }
+    }
+    ml::set_kernel_isa(original);
+}
+
+void test_backward_matches_finite_differences() {
+    ml::NeuralNetwork nn;
+    nn.add_layer(5, 7, ml::ActivationType::Tanh);
+    nn.add_layer(7, 3, ml::ActivationType::Sigmoid);
+
+    ml::Matrix input(4, 5);
+    ml::Matrix expected(4, 3);
+    for (size_t i = 0; i < 4; ++i) {
+        for (size_t j = 0; j < 5; ++j) input.at(i, j) = std::cos(0.3f * i + 0.7f * j);
+        for (size_t j = 0; j < 3; ++j) expected.at(i, j) = 0.25f * ((i + j) % 3);
+    }
+
+    // Capture analytic gradients with a zero learning rate (weights unchanged)
+    nn.forward(input);
+    nn.backward(expected, 0.0f);
+    ml::Layer& first = nn.get_layers()[0];
+    float analytic = first.get_weight_gradients().at(2, 3);
+
+    const float h = 1e-3f;
+    float original = first.get_weights().at(2, 3);
+    first.get_weights().at(2, 3) = original + h;
+    float loss_plus = ml::NeuralNetwork::mse_loss(nn.forward(input), expected);
+    first.get_weights().at(2, 3) = original - h;
+    float loss_minus = ml::NeuralNetwork::mse_loss(nn.forward(input), expected);
+    first.get_weights().at(2, 3) = original;
+
+    float numeric = (loss_plus - loss_minus) / (2 * h);
+    assert(std::abs(numeric - analytic) < 1e-3f);
+}
+
+void test_training_reduces_loss() {
+    const ml::OptimizerType optimizers[] = {
+        ml::OptimizerType::SGD, ml::OptimizerType::Momentum, ml::OptimizerType::Adam
+    };
+    for (auto type : optimizers) {
+        ml::NeuralNetwork nn;
+        nn.add_layer(2, 8, ml::ActivationType::Tanh);
+        nn.add_layer(8, 1, ml::ActivationType::Sigmoid);
+        ml::OptimizerConfig config;
+        config.type = type;
+        nn.set_optimizer(config);
+
+        // XOR
+        ml::Matrix input(4, 2);
+        ml::Matrix expected(4, 1);
+        const float xs[4][2] = {{0, 0}, {0, 1}, {1, 0}, {1, 1}};
+        for (size_t i = 0; i < 4; ++i) {
+            input.at(i, 0) = xs[i][0];
+            input.at(i, 1) = xs[i][1];
+            expected.at(i, 0) = xs[i][0] != xs[i][1] ? 1.0f : 0.0f;
+        }
+
+        float lr = type == ml::OptimizerType::Adam ? 0.05f : 0.5f;
+        float initial = ml::NeuralNetwork::mse_loss(nn.forward(input), expected);
+        for (int epoch = 0; epoch < 500; ++epoch) {
+            nn.forward(input);
+            nn.backward(expected, lr);
+        }
+        float final_loss = ml::NeuralNetwork::mse_loss(nn.forward(input), expected);
+        assert(final_loss < initial * 0.5f);
+    }
+}
+
+void test_batched_and_async_forward() {
+    ml::NeuralNetwork nn;
+    nn.add_layer(3, 5, ml::ActivationType::Tanh);
+    nn.add_layer(5, 2, ml::ActivationType::Sigmoid);
+
+    std::vector<ml::Matrix> inputs;
+    for (size_t n = 1; n <= 3; ++n) {
+        inputs.emplace_back(n, 3);
+        for (size_t i = 0; i < n; ++i)
+            for (size_t j = 0; j < 3; ++j)
+                inputs.back().at(i, j) = 0.1f * static_cast<float>(n + i) - 0.2f * static_cast<float>(j);
+    }
+
+    std::vector<ml::Matrix> batched = nn.forward_many(inputs);
+    std::vector<std::shared_future<ml::Matrix>> futures;
+    for (const auto& input : inputs) {
+        futures.push_back(nn.forward_async(input));
+    }
+    assert(batched.size() == inputs.size());
+    for (size_t n = 0; n < inputs.size(); ++n) {
+        ml::Matrix single = nn.forward(inputs[n]);
+        const ml::Matrix& async = futures[n].get();
+        assert(batched[n].rows() == single.rows() && batched[n].cols() == 2);
+        for (size_t i = 0; i < single.rows(); ++i)
+            for (size_t j = 0; j < 2; ++j) {
+                assert(std::abs(batched[n].at(i, j) - single.at(i, j)) < 1e-6f);
+                assert(async.at(i, j) == single.at(i, j));
+            }
+    }
+
+    // Errors surface through the future
+    bool threw = false;
+    try {
+        nn.forward_async(ml::Matrix(1, 4)).get();
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+}
+
+ml::NeuralNetwork make_network() {
+    ml::NeuralNetwork nn;
+    nn.add_layer(3, 4, ml::ActivationType::Tanh);
+    nn.add_layer(4, 2, ml::ActivationType::Sigmoid);
+    return nn;
+}
+
+void test_copy_and_move() {
+    ml::Matrix input(2, 3);
+    for (size_t i = 0; i < 6; ++i) input.data()[i] = 0.3f * static_cast<float>(i) - 0.7f;
+
+    // Returned by value and stored in a vector
+    std::vector<ml::NeuralNetwork> networks;
+    networks.push_back(make_network());
+    networks.push_back(make_network());
+    ml::NeuralNetwork& original = networks[0];
+    ml::Matrix expected = original.forward(input);
+
+    // A copy is independent of the original
+    ml::NeuralNetwork copy = original;
+    copy.get_layers()[0].get_weights().data()[0] += 1.0f;
+    ml::Matrix after = original.forward(input);
+    for (size_t i = 0; i < after.rows() * after.cols(); ++i) {
+        assert(after.data()[i] == expected.data()[i]);
+    }
+    copy = original;
+    assert(copy.forward(input).at(1, 1) == expected.at(1, 1));
+
+    // Moving finishes the queued forward_async() calls of the source
+    std::shared_future<ml::Matrix> pending = original.forward_async(input);
+    ml::NeuralNetwork moved = std::move(original);
+    assert(pending.get().at(0, 0) == expected.at(0, 0));
+    assert(moved.forward(input).at(0, 1) == expected.at(0, 1));
+    assert(moved.forward_async(input).get().at(1, 0) == expected.at(1, 0));
+    assert(original.get_layers().empty());
+    original = std::move(moved);
+    assert(original.forward(input).at(0, 0) == expected.at(0, 0));
+}
+
+void test_batching_server() {
+    ml::NeuralNetwork nn;
+    nn.add_layer(3, 4, ml::ActivationType::ReLU);
+    nn.add_layer(4, 2, ml::ActivationType::Tanh);
+
+    ml::BatchingConfig config;
+    config.max_batch_size = 4;
+    config.max_latency = std::chrono::seconds(1); // Only full batches should run
+    std::vector<ml::Matrix> rows;
+    std::vector<std::shared_future<ml::Matrix>> futures;
+    {
+        ml::BatchingServer server(nn, config);
+        for (size_t n = 0; n < 8; ++n) {
+            rows.emplace_back(1, 3);
+            rows.back().at(0, 0) = 0.3f * static_cast<float>(n);
+            rows.back().at(0, 2) = -0.1f * static_cast<float>(n);
+            futures.push_back(server.submit(rows.back()));
+        }
+        for (size_t n = 0; n < 8; ++n) {
+            ml::Matrix expected = nn.forward(rows[n]);
+            const ml::Matrix& output = futures[n].get();
+            assert(output.rows() == 1 && output.cols() == 2);
+            for (size_t j = 0; j < 2; ++j)
+                assert(std::abs(output.at(0, j) - expected.at(0, j)) < 1e-6f);
+        }
+
+        ml::BatchingStats stats = server.stats();
+        assert(stats.requests == 8 && stats.batches == 2);
+        assert(stats.batch_size_histogram[4] == 2);
+        assert(stats.latency_p50_us <= stats.latency_p99_us);
+
+        bool threw = false;
+        try {
+            server.submit(ml::Matrix(1, 5));
+        } catch (const std::invalid_argument&) {
+            threw = true;
+        }
+        assert(threw);
+
+        // Destruction runs a partial batch instead of dropping it
+        futures.push_back(server.submit(rows[0]));
+    }
+    assert(futures.back().get().at(0, 1) == futures[0].get().at(0, 1));
+}
+
+void test_stateless_inference() {
+    ml::NeuralNetwork nn;
+    nn.add_layer(6, 8, ml::ActivationType::ReLU);
+    nn.add_layer(8, 3, ml::ActivationType::Sigmoid);
+
+    ml::Matrix input(5, 6);
+    for (size_t i = 0; i < 5; ++i)
+        for (size_t j = 0; j < 6; ++j)
+            input.at(i, j) = 0.05f * static_cast<float>(i * 6 + j) - 0.7f;
+    ml::Matrix expected = nn.forward(input);
+
+    // Buffers are sized once and reused for the same batch size
+    ml::InferenceContext context(nn, 5);
+    const ml::Matrix& first = nn.forward(input, context);
+    const float* buffer = first.data();
+    const ml::Matrix& second = nn.forward(input, context);
+    assert(second.data() == buffer);
+    for (size_t i = 0; i < 5; ++i)
+        for (size_t j = 0; j < 3; ++j)
+            assert(second.at(i, j) == expected.at(i, j));
+
+    // One network shared by several threads, one context each
+    std::vector<std::thread> threads;
+    std::atomic<bool> mismatch{false};
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&] {
+            ml::InferenceContext local;
+            for (int iter = 0; iter < 50; ++iter) {
+                const ml::Matrix& out = nn.forward(input, local);
+                for (size_t i = 0; i < 5; ++i)
+                    for (size_t j = 0; j < 3; ++j)
+                        if (out.at(i, j) != expected.at(i, j)) mismatch = true;
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    assert(!mismatch);
+
+    // A different batch size resizes the workspace
+    ml::Matrix row(1, 6);
+    assert(nn.forward(row, context).rows() == 1);
+    assert(context.batch_size() == 1);
+
+    // Row ranges of a larger batch run in place without being copied
+    ml::ConstMatrixView rows = input.view().row_range(1, 4);
+    ml::ConstMatrixView out = nn.forward(rows, context);
+    assert(out.rows() == 3 && out.cols() == 3);
+    for (size_t i = 0; i < 3; ++i)
+        for (size_t j = 0; j < 3; ++j)
+            assert(std::abs(out.at(i, j) - expected.at(i + 1, j)) < 1e-6f);
+
+    // An empty network has no output in the context to return
+    ml::NeuralNetwork empty;
+    ml::InferenceContext empty_context;
+    bool threw = false;
+    try {
+        empty.forward(input, empty_context);
+    } catch (const std::logic_error&) {
+        threw = true;
+    }
+    assert(threw);
+    threw = false;
+    try {
+        empty.forward(input.view(), empty_context);
+    } catch (const std::logic_error&) {
+        threw = true;
+    }
+    assert(threw);
+}
+
+void test_memory_plan() {
+    // Chain of four activations: the plan collapses to two ping-pong buffers
+    std::vector<ml::BufferLifetime> chain = {
+        {1024, 0, 1}, {128, 1, 2}, {1024, 2, 3}, {128, 3, 4}};
+    ml::MemoryPlan plan = ml::plan_memory(chain);
+    assert(plan.arena_bytes == 1152);
+    assert(plan.offsets[0] == plan.offsets[2]);
+    assert(plan.offsets[1] == plan.offsets[3]);
+    assert(plan.offsets[1] >= 1024);
+
+    // Unaligned sizes are rounded up and live buffers never overlap
+    std::vector<ml::BufferLifetime> live = {{100, 0, 2}, {10, 1, 1}, {50, 2, 3}};
+    plan = ml::plan_memory(live);
+    for (size_t a = 0; a < live.size(); ++a) {
+        assert(plan.offsets[a] % ml::MEMORY_ALIGNMENT == 0);
+        for (size_t b = a + 1; b < live.size(); ++b) {
+            bool same_time = live[a].first_use <= live[b].last_use && live[b].first_use <= live[a].last_use;
+            bool same_bytes = plan.offsets[a] < plan.offsets[b] + live[b].bytes &&
+                              plan.offsets[b] < plan.offsets[a] + live[a].bytes;
+            assert(!(same_time && same_bytes));
+        }
+    }
+
+    // The inference arena for the same chain shape
+    ml::NeuralNetwork nn;
+    nn.add_layer(8, 64, ml::ActivationType::ReLU);
+    nn.add_layer(64, 8, ml::ActivationType::ReLU);
+    nn.add_layer(8, 64, ml::ActivationType::ReLU);
+    nn.add_layer(64, 8, ml::ActivationType::Tanh);
+    ml::InferenceContext context(nn, 4);
+    assert(context.arena_bytes() == 1152);
+}
+
+void test_save_and_load() {
+    const std::string path = "test_neural_model.bin";
+    ml::NeuralNetwork network;
+    network.add_layer(5, 13, ml::ActivationType::Tanh);
+    network.add_layer(13, 3, ml::ActivationType::Sigmoid);
+    ml::Matrix input(4, 5);
+    for (size_t i = 0; i < 4; ++i)
+        for (size_t j = 0; j < 5; ++j)
+            input.at(i, j) = 0.1f * static_cast<float>(i) - 0.2f * static_cast<float>(j);
+    ml::Matrix expected = network.forward(input);
+    ml::save_network(network, path);
+
+    {
+        auto loaded = ml::load_network(path);
+        assert(loaded->get_layers().size() == 2);
+        for (const auto& layer : loaded->get_layers()) {
+            // Parameters are 64-byte aligned views into the mapping
+            assert(!layer.get_weights().owns_data());
+            assert(reinterpret_cast<std::uintptr_t>(layer.get_weights().data()) % 64 == 0);
+            assert(reinterpret_cast<std::uintptr_t>(layer.get_biases().data()) % 64 == 0);
+        }
+        assert(loaded->get_layers()[1].get_activation() == ml::ActivationType::Sigmoid);
+        ml::Matrix output = loaded->forward(input);
+        for (size_t i = 0; i < output.rows() * output.cols(); ++i) {
+            assert(output.data()[i] == expected.data()[i]);
+        }
+
+        // Training writes to private pages, never to the file
+        ml::Matrix target(4, 3);
+        loaded->backward(target, 0.5f);
+        assert(loaded->get_layers()[0].get_weights().at(0, 0) != network.get_layers()[0].get_weights().at(0, 0));
+    }
+    auto reloaded = ml::load_network(path);
+    assert(reloaded->get_layers()[0].get_weights().at(0, 0) == network.get_layers()[0].get_weights().at(0, 0));
+
+    // Truncated and foreign files are rejected
+    {
+        std::ifstream in(path, std::ios::binary);
+        std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), static_cast<std::streamsize>(bytes.size() / 2));
+    }
+    bool threw = false;
+    try {
+        ml::load_network(path);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    assert(threw);
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out << std::string(128, 'x');
+    }
+    threw = false;
+    try {
+        ml::load_network(path);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    assert(threw);
+    std::remove(path.c_str());
+}
+
 int main() {
     test_layer_creation();
     test_forward_propagation();
+    test_fused_epilogue_matches_reference();
+    test_activations_propagate_nan();
+    test_backward_matches_finite_differences();
+    test_training_reduces_loss();
+    test_batched_and_async_forward();
+    test_copy_and_move();
+    test_batching_server();
+    test_stateless_inference();
+    test_memory_plan();
+    test_save_and_load();
     std::cout << "All neural network tests passed!" << std::endl;
     return 0;
 }
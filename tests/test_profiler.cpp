@@ -0,0 +1,121 @@
+#include "../src/profiler.hpp"
+#include "../src/gemm.hpp"
+#include "../src/neural.hpp"
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const ml::ProfileStats* find_stats(const std::vector<ml::ProfileStats>& summary, const std::string& name) {
+    for (const auto& stats : summary) {
+        if (stats.name == name) {
+            return &stats;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace
+
+void test_disabled_records_nothing() {
+    ml::reset_profile();
+    ml::set_profiling(false);
+    std::vector<float> a(64, 1.0f), b(64, 1.0f), c(64);
+    ml::gemm(c.data(), a.data(), b.data(), 8, 8, 8);
+    assert(ml::profile_events().empty());
+}
+
+void test_forward_phases() {
+    ml::NeuralNetwork network;
+    network.add_layer(20, 30, ml::ActivationType::ReLU);
+    network.add_layer(30, 5, ml::ActivationType::Sigmoid);
+    ml::Matrix input(4, 20);
+
+    ml::reset_profile();
+    ml::set_profiling(true);
+    network.forward(input);
+    network.forward(input);
+    ml::set_profiling(false);
+
+    auto summary = ml::profile_summary();
+    const auto* forward = find_stats(summary, "NeuralNetwork::forward");
+    const auto* layer0 = find_stats(summary, "Layer::forward[0]");
+    const auto* layer1 = find_stats(summary, "Layer::forward[1]");
+    const auto* gemm = find_stats(summary, "gemm_bias_activation");
+    assert(forward && forward->calls == 2);
+    assert(layer0 && layer0->calls == 2 && layer1 && layer1->calls == 2);
+    assert(find_stats(summary, "Layer::cache_input"));
+    assert(gemm && gemm->calls == 4);
+    assert(gemm->flops == 2.0 * 2 * (4 * 30 * 20 + 4 * 5 * 30));
+    // Scopes are inclusive: the forward pass contains both layers
+    assert(forward->total_ns >= layer0->total_ns + layer1->total_ns);
+    assert(summary.front().total_ns >= summary.back().total_ns);
+}
+
+void test_threads_and_trace() {
+    ml::reset_profile();
+    ml::set_profiling(true);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 3; ++t) {
+        threads.emplace_back([] {
+            std::vector<float> a(256, 1.0f), b(256, 1.0f), c(256);
+            for (int i = 0; i < 10; ++i) {
+                ml::gemm(c.data(), a.data(), b.data(), 16, 16, 16);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    ml::set_profiling(false);
+
+    auto events = ml::profile_events();
+    assert(events.size() == 30);
+    std::set<uint32_t> ids;
+    for (const auto& event : events) {
+        assert(std::strcmp(event.name, "gemm") == 0);
+        assert(event.duration_ns >= 0);
+        ids.insert(event.thread);
+    }
+    assert(ids.size() == 3);
+
+    std::string trace = ml::chrome_trace();
+    assert(trace.rfind("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", 0) == 0);
+    assert(trace.substr(trace.size() - 2) == "]}");
+    assert(trace.find("\"name\":\"gemm\"") != std::string::npos);
+    assert(trace.find("thread_name") != std::string::npos);
+
+    ml::reset_profile();
+    assert(ml::profile_events().empty());
+    assert(ml::chrome_trace() == "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[]}");
+}
+
+void test_hardware_counters() {
+    ml::reset_profile();
+    ml::set_profiling(true, true);
+    std::vector<float> a(4096, 1.0f), b(4096, 1.0f), c(4096);
+    ml::gemm(c.data(), a.data(), b.data(), 64, 64, 64);
+    ml::set_profiling(false);
+    auto events = ml::profile_events();
+    assert(events.size() == 1);
+    // Counters depend on the kernel's perf_event_paranoid setting
+    if (ml::hardware_counters_available()) {
+        assert(events[0].cycles > 0 && events[0].instructions > 0);
+    } else {
+        assert(events[0].cycles == 0 && events[0].instructions == 0);
+    }
+}
+
+int main() {
+    test_disabled_records_nothing();
+    test_forward_phases();
+    test_threads_and_trace();
+    test_hardware_counters();
+    std::cout << "All profiler tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,117 @@
+#include "../src/quantization.hpp"
+#include "../src/cpu_dispatch.hpp"
+#include "../src/int8_gemm.hpp"
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+void check_int8_gemm(const ml::KernelTable& kernels) {
+    // Odd sizes exercise depth padding, edge rows and partial column blocks
+    const size_t m = 7, n = 37, k = 13;
+    std::vector<float> a(m * k);
+    std::vector<int8_t> b(k * n);
+    for (size_t i = 0; i < m * k; ++i) a[i] = static_cast<float>(static_cast<int>(i % 11) - 4) * 0.25f;
+    for (size_t i = 0; i < k * n; ++i) b[i] = static_cast<int8_t>(static_cast<int>((i * 7) % 255) - 127);
+
+    size_t kp = ml::int8_padded_depth(k);
+    std::vector<uint8_t> qa(m * kp);
+    std::vector<float> a_scales(m);
+    std::vector<int32_t> zero_points(m);
+    kernels.quantize_rows(qa.data(), a_scales.data(), zero_points.data(), a.data(), m, k);
+
+    size_t packed_bytes = kernels.int8_packed_size(k, n);
+    int8_t* packed = static_cast<int8_t*>(ml::pool_allocate(packed_bytes));
+    kernels.pack_int8_weights(packed, b.data(), k, n);
+
+    std::vector<int32_t> sums(n, 0);
+    std::vector<float> b_scales(n), bias(n);
+    for (size_t j = 0; j < n; ++j) {
+        for (size_t p = 0; p < k; ++p) sums[j] += b[p * n + j];
+        b_scales[j] = 0.01f * static_cast<float>(j + 1);
+        bias[j] = 0.5f - 0.03f * static_cast<float>(j);
+    }
+
+    std::vector<float> result(m * n);
+    kernels.int8_gemm_bias_activation(result.data(), qa.data(), a_scales.data(), zero_points.data(),
+                                      packed, sums.data(), b_scales.data(), bias.data(), m, n, k,
+                                      ml::ActivationType::ReLU);
+    ml::pool_deallocate(packed, packed_bytes);
+
+    for (size_t i = 0; i < m; ++i) {
+        for (size_t j = 0; j < n; ++j) {
+            int64_t acc = 0;
+            for (size_t p = 0; p < k; ++p) {
+                assert(qa[i * kp + p] <= kernels.int8_activation_max());
+                acc += (static_cast<int64_t>(qa[i * kp + p]) - zero_points[i]) * b[p * n + j];
+            }
+            float expected = std::max(0.0f, static_cast<float>(acc) * a_scales[i] * b_scales[j] + bias[j]);
+            assert(std::abs(result[i * n + j] - expected) <= 1e-4f * (1.0f + std::abs(expected)));
+        }
+    }
+}
+
+void test_int8_gemm_matches_integer_reference() {
+    for (const std::string& isa : ml::available_kernel_isas()) {
+        check_int8_gemm(ml::kernel_table_for(isa));
+        if (isa == "avx512") {
+            // The float kernels run without VNNI; the int8 ones then take the
+            // 7-bit vpmaddubsw path, as on Skylake-SP
+            const ml::KernelTable& without_vnni = ml::avx512::kernel_table();
+            assert(without_vnni.int8_activation_max() == 127);
+            check_int8_gemm(without_vnni);
+            assert(ml::kernel_table_for(isa).int8_activation_max() ==
+                   (__builtin_cpu_supports("avx512vnni") ? 255 : 127));
+        }
+    }
+}
+
+void test_quantized_layer_dequantization() {
+    ml::Layer layer(20, 9, ml::ActivationType::Tanh);
+    ml::QuantizedLayer quantized(layer);
+    ml::Matrix restored = quantized.dequantized_weights();
+    for (size_t i = 0; i < 20; ++i) {
+        for (size_t j = 0; j < 9; ++j) {
+            // Rounding error is at most half a quantization step
+            float step = quantized.get_weight_scales()[j];
+            assert(std::abs(restored.at(i, j) - layer.get_weights().at(i, j)) <= 0.5f * step + 1e-7f);
+        }
+    }
+}
+
+void test_quantized_network_accuracy() {
+    ml::NeuralNetwork nn;
+    nn.add_layer(64, 128, ml::ActivationType::ReLU);
+    nn.add_layer(128, 128, ml::ActivationType::Tanh);
+    nn.add_layer(128, 10, ml::ActivationType::Sigmoid);
+    ml::QuantizedNetwork quantized(nn);
+
+    ml::Matrix input(32, 64);
+    for (size_t i = 0; i < 32; ++i)
+        for (size_t j = 0; j < 64; ++j)
+            input.at(i, j) = std::sin(0.37f * static_cast<float>(i * 64 + j));
+
+    ml::QuantizationReport report = ml::evaluate_quantization(nn, quantized, input);
+    assert(report.relative_rms_error < 0.02f);
+    assert(report.max_abs_error < 0.05f);
+    assert(report.top1_agreement >= 0.9f);
+    // Int8 weights: close to 4x smaller once scales and biases are counted
+    assert(report.float_weight_bytes > 3 * report.quantized_weight_bytes);
+
+    // Rows are quantized independently, so batching does not change results
+    ml::Matrix row(1, 64);
+    for (size_t j = 0; j < 64; ++j) row.at(0, j) = input.at(5, j);
+    ml::Matrix batched = quantized.forward(input);
+    ml::Matrix single = quantized.forward(row);
+    for (size_t j = 0; j < 10; ++j) assert(single.at(0, j) == batched.at(5, j));
+}
+
+int main() {
+    test_int8_gemm_matches_integer_reference();
+    test_quantized_layer_dequantization();
+    test_quantized_network_accuracy();
+    std::cout << "All quantization tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,130 @@
+#include "../src/sparse_matrix.hpp"
+#include "../src/gemm.hpp"
+#include "../src/neural.hpp"
+#include "../src/thread_pool.hpp"
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+// Deterministic matrix with roughly one element in keep_every nonzero
+ml::Matrix pruned_matrix(size_t rows, size_t cols, size_t keep_every) {
+    ml::Matrix m(rows, cols);
+    for (size_t i = 0; i < rows; ++i)
+        for (size_t j = 0; j < cols; ++j)
+            if ((i * 31 + j * 17) % keep_every == 0)
+                m.at(i, j) = static_cast<float>((i + 2 * j) % 9) * 0.1f - 0.45f;
+    return m;
+}
+
+void test_sparse_conversion() {
+    ml::Matrix dense = pruned_matrix(10, 13, 5);
+    ml::SparseMatrix csr(dense);
+    size_t nonzeros = 0;
+    for (size_t i = 0; i < 10; ++i)
+        for (size_t j = 0; j < 13; ++j)
+            nonzeros += dense.at(i, j) != 0.0f;
+    assert(csr.stored_values() == nonzeros);
+    assert(csr.num_blocks() == nonzeros);
+    assert(csr.row_offsets().size() == 11);
+
+    // Blocks overhanging the matrix edge are zero-padded
+    ml::SparseMatrix bsr(dense, 4, 4);
+    assert(bsr.stored_values() == bsr.num_blocks() * 16);
+    assert(bsr.row_offsets().size() == 4);
+    for (const ml::SparseMatrix* sparse : {&csr, &bsr}) {
+        ml::Matrix back = sparse->to_dense();
+        for (size_t i = 0; i < 10; ++i)
+            for (size_t j = 0; j < 13; ++j)
+                assert(back.at(i, j) == dense.at(i, j));
+    }
+
+    bool threw = false;
+    try {
+        ml::SparseMatrix bad(dense, 0, 4);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+}
+
+void test_spmm_matches_dense() {
+    // Covers every specialized block width, a run-time width, edge blocks,
+    // partial row groups and a product large enough to run threaded
+    const size_t shapes[][3] = {{5, 37, 29}, {2, 2048, 1100}, {37, 1024, 600}};
+    const size_t blocks[][2] = {{1, 1}, {1, 4}, {1, 8}, {4, 4}, {2, 16}, {3, 5}};
+    for (const auto& shape : shapes) {
+        size_t m = shape[0], k = shape[1], n = shape[2];
+        ml::Matrix a(m, k);
+        for (size_t i = 0; i < m; ++i)
+            for (size_t p = 0; p < k; ++p)
+                a.at(i, p) = (i + p) % 4 == 0 ? 0.0f : static_cast<float>((i * 3 + p) % 7) * 0.2f - 0.6f;
+        ml::Matrix w = pruned_matrix(k, n, 7);
+        std::vector<float> bias(n);
+        for (size_t j = 0; j < n; ++j) bias[j] = static_cast<float>(j % 5) * 0.1f - 0.2f;
+
+        ml::Matrix expected(m, n), expected_act(m, n);
+        ml::gemm(expected.view(), a.view(), w.view());
+        ml::gemm_bias_activation(expected_act.view(), a.view(), w.view(), bias.data(), ml::ActivationType::Tanh);
+        for (const auto& block : blocks) {
+            ml::SparseMatrix sparse(w, block[0], block[1]);
+            ml::Matrix result(m, n), result_act(m, n);
+            ml::spmm(result.view(), a.view(), sparse);
+            ml::spmm_bias_activation(result_act.view(), a.view(), sparse, bias.data(), ml::ActivationType::Tanh);
+            for (size_t i = 0; i < m; ++i) {
+                for (size_t j = 0; j < n; ++j) {
+                    assert(std::abs(result.at(i, j) - expected.at(i, j)) < 1e-4f);
+                    assert(std::abs(result_act.at(i, j) - expected_act.at(i, j)) < 1e-4f);
+                }
+            }
+        }
+    }
+}
+
+void test_sparse_layer() {
+    ml::NeuralNetwork nn;
+    nn.add_layer(40, 64, ml::ActivationType::ReLU);
+    nn.add_layer(64, 5, ml::ActivationType::Sigmoid);
+    // Prune the first layer to 1 x 8 blocks, leaving one block in eight
+    ml::Matrix& w = nn.get_layers()[0].get_weights();
+    for (size_t i = 0; i < w.rows(); ++i)
+        for (size_t j = 0; j < w.cols(); ++j)
+            if ((i + j / 8) % 8 != 0) w.at(i, j) = 0.0f;
+
+    ml::Matrix input(9, 40);
+    for (size_t i = 0; i < 9; ++i)
+        for (size_t j = 0; j < 40; ++j)
+            input.at(i, j) = static_cast<float>((i * 40 + j) % 13) * 0.1f - 0.6f;
+    ml::Matrix dense = nn.forward(input);
+
+    // Only the pruned layer is sparse enough to switch
+    assert(nn.sparsify(1, 8) == 1);
+    const ml::SparseMatrix* sparse = nn.get_layers()[0].get_sparse_weights();
+    assert(sparse != nullptr && sparse->density() == 0.125);
+    assert(sparse->memory_bytes() < w.rows() * w.cols() * sizeof(float) / 4);
+    assert(nn.get_layers()[1].get_sparse_weights() == nullptr);
+
+    ml::Matrix out = nn.forward(input);
+    for (size_t i = 0; i < 9; ++i)
+        for (size_t j = 0; j < 5; ++j)
+            assert(std::abs(out.at(i, j) - dense.at(i, j)) < 1e-5f);
+
+    // Training updates every weight, so the layer returns to dense
+    nn.backward(out, 0.01f);
+    assert(nn.get_layers()[0].get_sparse_weights() == nullptr);
+}
+
+int main() {
+    test_sparse_conversion();
+    test_spmm_matches_dense();
+    test_sparse_layer();
+    // Again with several workers, so both the row-split and the depth-split
+    // parallel paths run regardless of the host's core count
+    size_t threads = ml::get_num_threads();
+    ml::set_num_threads(4);
+    test_spmm_matches_dense();
+    ml::set_num_threads(threads);
+    std::cout << "All sparse matrix tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,124 @@
+#include "../src/static_network.hpp"
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+
+using Scorer = ml::StaticNetwork<ml::Dense<32, 64, ml::ActivationType::ReLU>,
+                                 ml::Dense<64, 64, ml::ActivationType::Tanh>,
+                                 ml::Dense<64, 8, ml::ActivationType::Sigmoid>>;
+
+void build_scorer(ml::NeuralNetwork& network) {
+    network.add_layer(32, 64, ml::ActivationType::ReLU);
+    network.add_layer(64, 64, ml::ActivationType::Tanh);
+    network.add_layer(64, 8, ml::ActivationType::Sigmoid);
+    // Non-zero biases so the bias path is checked too
+    for (ml::Layer& layer : network.get_layers()) {
+        for (size_t j = 0; j < layer.output_size(); ++j) {
+            layer.get_biases().data()[j] = static_cast<float>(j % 5) * 0.1f - 0.2f;
+        }
+    }
+}
+
+void fill_input(ml::Matrix& input) {
+    for (size_t i = 0; i < input.rows() * input.cols(); ++i) {
+        input.data()[i] = static_cast<float>((i * 7) % 23) * 0.1f - 1.1f;
+    }
+}
+
+void test_matches_dynamic_network() {
+    static_assert(Scorer::input_size == 32 && Scorer::output_size == 8, "Static shape");
+    ml::NeuralNetwork network;
+    build_scorer(network);
+    Scorer scorer(network);
+
+    ml::Matrix input(5, 32), output(5, 8);
+    fill_input(input);
+    ml::Matrix expected = network.forward(input);
+    scorer.forward(input, output);
+    for (size_t i = 0; i < 5 * 8; ++i) {
+        assert(std::abs(output.data()[i] - expected.data()[i]) < 1e-5f);
+    }
+
+    // Single rows through the array interface
+    Scorer::Input row;
+    std::copy(input.data() + 2 * 32, input.data() + 3 * 32, row.begin());
+    Scorer::Output scores = scorer.forward(row);
+    for (size_t j = 0; j < 8; ++j) {
+        assert(std::abs(scores[j] - expected.at(2, j)) < 1e-5f);
+    }
+
+    // Half-precision weights load widened
+    network.set_weight_precision(ml::Precision::BFloat16);
+    Scorer half(network);
+    ml::Matrix half_expected = network.forward(input);
+    half.forward(input, output);
+    for (size_t i = 0; i < 5 * 8; ++i) {
+        assert(std::abs(output.data()[i] - half_expected.data()[i]) < 1e-4f);
+    }
+}
+
+void test_odd_widths() {
+    // Widths that are not multiples of the vector width, and one wider than
+    // a register block
+    ml::NeuralNetwork network;
+    network.add_layer(7, 150, ml::ActivationType::ReLU);
+    network.add_layer(150, 3, ml::ActivationType::Tanh);
+    ml::StaticNetwork<ml::Dense<7, 150, ml::ActivationType::ReLU>, ml::Dense<150, 3, ml::ActivationType::Tanh>>
+        odd(network);
+    ml::Matrix input(4, 7), output(4, 3);
+    fill_input(input);
+    ml::Matrix expected = network.forward(input);
+    odd.forward(input, output);
+    for (size_t i = 0; i < 4 * 3; ++i) {
+        assert(std::abs(output.data()[i] - expected.data()[i]) < 1e-5f);
+    }
+}
+
+void test_mismatch_throws() {
+    ml::NeuralNetwork network;
+    build_scorer(network);
+    Scorer scorer(network);
+    float first = scorer.layer<0>().weights[0];
+
+    // Wrong activation in the last layer: nothing is loaded
+    ml::NeuralNetwork other;
+    other.add_layer(32, 64, ml::ActivationType::ReLU);
+    other.add_layer(64, 64, ml::ActivationType::Tanh);
+    other.add_layer(64, 8, ml::ActivationType::ReLU);
+    bool threw = false;
+    try {
+        scorer.load(other);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+    assert(scorer.layer<0>().weights[0] == first);
+
+    ml::NeuralNetwork shallow;
+    shallow.add_layer(32, 8, ml::ActivationType::Sigmoid);
+    threw = false;
+    try {
+        scorer.load(shallow);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+
+    ml::Matrix input(2, 31), output(2, 8);
+    threw = false;
+    try {
+        scorer.forward(input, output);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+}
+
+int main() {
+    test_matches_dynamic_network();
+    test_odd_widths();
+    test_mismatch_throws();
+    std::cout << "All static network tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,159 @@
+#include "../src/stream_inference.hpp"
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+// Deterministic rows x cols dataset
+ml::Matrix dataset(size_t rows, size_t cols) {
+    ml::Matrix data(rows, cols);
+    for (size_t i = 0; i < rows * cols; ++i) {
+        data.data()[i] = static_cast<float>((i * 7) % 23) * 0.05f - 0.5f;
+    }
+    return data;
+}
+
+std::string read_file(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+void write_file(const std::string& path, const std::string& bytes) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+// Whether bytes hold expected's floats; chunking moves rows between full
+// and edge GEMM tiles, whose epilogues agree only to the last bit
+bool matches(const std::string& bytes, const ml::Matrix& expected) {
+    if (bytes.size() != expected.rows() * expected.cols() * sizeof(float)) {
+        return false;
+    }
+    for (size_t i = 0; i < expected.rows() * expected.cols(); ++i) {
+        float value;
+        std::memcpy(&value, bytes.data() + i * sizeof(float), sizeof(float));
+        if (std::abs(value - expected.data()[i]) > 1e-6f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string raw_bytes(const ml::Matrix& m) {
+    return std::string(reinterpret_cast<const char*>(m.data()), m.rows() * m.cols() * sizeof(float));
+}
+
+// Minimal version 1.0 .npy file as NumPy writes it
+std::string npy_bytes(const ml::Matrix& m) {
+    std::string dict = "{'descr': '<f4', 'fortran_order': False, 'shape': (" + std::to_string(m.rows()) +
+                       ", " + std::to_string(m.cols()) + "), }";
+    dict.append((64 - (10 + dict.size() + 1) % 64) % 64, ' ');
+    dict.push_back('\n');
+    uint16_t length = static_cast<uint16_t>(dict.size());
+    std::string header("\x93NUMPY\x01\x00", 8);
+    header.append(reinterpret_cast<const char*>(&length), sizeof(length));
+    return header + dict + raw_bytes(m);
+}
+
+void test_stream_matches_forward() {
+    const std::string raw_in = "test_stream_in.bin", npy_in = "test_stream_in.npy";
+    const std::string raw_out = "test_stream_out.bin", npy_out = "test_stream_out.npy";
+    ml::NeuralNetwork network;
+    network.add_layer(12, 20, ml::ActivationType::ReLU);
+    network.add_layer(20, 3, ml::ActivationType::Sigmoid);
+    ml::Matrix input = dataset(1001, 12);
+    ml::Matrix expected = network.forward(input);
+    write_file(raw_in, raw_bytes(input));
+    write_file(npy_in, npy_bytes(input));
+
+    // A partial last chunk with more workers than free slots, one chunk in
+    // flight at a time, and the defaults (a single chunk)
+    ml::StreamConfig configs[3];
+    configs[0].chunk_rows = 64;
+    configs[0].num_workers = 3;
+    configs[0].max_chunks_in_flight = 4;
+    configs[1].chunk_rows = 7;
+    configs[1].num_workers = 1;
+    configs[1].max_chunks_in_flight = 1;
+    for (const ml::StreamConfig& config : configs) {
+        ml::StreamStats stats = ml::stream_inference(network, raw_in, raw_out, config);
+        assert(stats.rows == 1001);
+        assert(stats.chunks == (1001 + config.chunk_rows - 1) / config.chunk_rows);
+        std::string out = read_file(raw_out);
+        assert(matches(out, expected));
+
+        // .npy in and out: the same rows behind a header NumPy accepts
+        ml::stream_inference(network, npy_in, npy_out, config);
+        std::string npy = read_file(npy_out);
+        std::string header = npy_bytes(expected).substr(0, npy.size() - out.size());
+        assert(npy.compare(0, header.size(), header) == 0);
+        assert(npy.substr(header.size()) == out);
+    }
+
+    // Rows wider than the network: the trailing columns are skipped
+    ml::NeuralNetwork narrow;
+    narrow.add_layer(10, 4, ml::ActivationType::Tanh);
+    ml::Matrix leading(1001, 10);
+    for (size_t i = 0; i < 1001; ++i) {
+        std::memcpy(leading.data() + i * 10, input.data() + i * 12, 10 * sizeof(float));
+    }
+    ml::Matrix narrow_expected = narrow.forward(leading);
+    ml::StreamConfig skip;
+    skip.chunk_rows = 100;
+    skip.input_cols = 12;
+    for (const std::string& path : {raw_in, npy_in}) {
+        ml::stream_inference(narrow, path, raw_out, skip);
+        assert(matches(read_file(raw_out), narrow_expected));
+    }
+    skip.input_cols = 8;
+    bool threw = false;
+    try {
+        ml::stream_inference(narrow, raw_in, raw_out, skip);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+
+    // Rows of the wrong width, a truncated raw file and an in-place run are rejected
+    ml::NeuralNetwork wide;
+    wide.add_layer(16, 2, ml::ActivationType::Tanh);
+    threw = false;
+    try {
+        ml::stream_inference(wide, npy_in, npy_out);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+    write_file(raw_in, raw_bytes(input).substr(0, 100));
+    threw = false;
+    try {
+        ml::stream_inference(network, raw_in, raw_out);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    assert(threw);
+    threw = false;
+    try {
+        ml::stream_inference(network, npy_in, npy_in);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+    assert(read_file(npy_in) == npy_bytes(input));
+
+    for (const std::string& path : {raw_in, npy_in, raw_out, npy_out}) {
+        std::remove(path.c_str());
+    }
+}
+
+int main() {
+    test_stream_matches_forward();
+    std::cout << "All stream inference tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,70 @@
+#include "../src/thread_pool.hpp"
+#include "../src/matrix.hpp"
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+void test_parallel_for_covers_range() {
+    ml::ThreadPool pool(4);
+    std::vector<int> hits(1000, 0);
+    pool.parallel_for(hits.size(), [&](size_t i) { hits[i]++; });
+    for (int h : hits) {
+        assert(h == 1);
+    }
+
+    std::atomic<size_t> total{0};
+    pool.parallel_range(12345, 16, [&](size_t begin, size_t end) {
+        assert(begin % 16 == 0);
+        total += end - begin;
+    });
+    assert(total == 12345);
+}
+
+void test_nested_and_exceptions() {
+    ml::ThreadPool pool(3);
+    std::atomic<int> inner{0};
+    pool.parallel_for(8, [&](size_t) {
+        pool.parallel_for(4, [&](size_t) { inner++; });
+    });
+    assert(inner == 32);
+
+    bool caught = false;
+    try {
+        pool.parallel_for(16, [](size_t i) {
+            if (i == 7) throw std::runtime_error("task failed");
+        });
+    } catch (const std::runtime_error&) {
+        caught = true;
+    }
+    assert(caught);
+}
+
+void test_threaded_multiply_matches_serial() {
+    ml::Matrix a(150, 200);
+    ml::Matrix b(200, 170);
+    for (size_t i = 0; i < a.rows(); ++i)
+        for (size_t j = 0; j < a.cols(); ++j)
+            a.at(i, j) = static_cast<float>((i + 2 * j) % 7) - 3.0f;
+    for (size_t i = 0; i < b.rows(); ++i)
+        for (size_t j = 0; j < b.cols(); ++j)
+            b.at(i, j) = static_cast<float>((3 * i + j) % 5) - 2.0f;
+
+    ml::set_num_threads(1);
+    ml::Matrix serial = a * b;
+    ml::set_num_threads(4);
+    ml::Matrix threaded = a * b;
+    for (size_t i = 0; i < serial.rows(); ++i)
+        for (size_t j = 0; j < serial.cols(); ++j)
+            assert(std::abs(serial.at(i, j) - threaded.at(i, j)) < 1e-3f);
+}
+
+int main() {
+    test_parallel_for_covers_range();
+    test_nested_and_exceptions();
+    test_threaded_multiply_matches_serial();
+    std::cout << "All thread pool tests passed!" << std::endl;
+    return 0;
+}
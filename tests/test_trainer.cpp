@@ -0,0 +1,205 @@
+#include "../src/trainer.hpp"
+#include "../src/thread_pool.hpp"
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// Two-input regression dataset with a smooth target
+void dataset(size_t rows, ml::Matrix& inputs, ml::Matrix& targets) {
+    inputs = ml::Matrix(rows, 6);
+    targets = ml::Matrix(rows, 2);
+    for (size_t i = 0; i < rows; ++i) {
+        for (size_t j = 0; j < 6; ++j) {
+            inputs.at(i, j) = static_cast<float>((i * 7 + j * 3) % 17) * 0.1f - 0.8f;
+        }
+        targets.at(i, 0) = 0.5f * std::tanh(inputs.at(i, 0) - inputs.at(i, 3));
+        targets.at(i, 1) = 0.3f * inputs.at(i, 1) * inputs.at(i, 2);
+    }
+}
+
+// Layers with fixed weights, so every network starts from the same point
+void build_network(ml::NeuralNetwork& network) {
+    const size_t sizes[] = {6, 24, 16, 2};
+    const ml::ActivationType activations[] = {ml::ActivationType::ReLU, ml::ActivationType::Tanh,
+                                              ml::ActivationType::Tanh};
+    for (size_t l = 0; l < 3; ++l) {
+        ml::Matrix weights(sizes[l], sizes[l + 1]), biases(1, sizes[l + 1]);
+        for (size_t i = 0; i < weights.rows() * weights.cols(); ++i) {
+            weights.data()[i] = static_cast<float>((i * 13 + l) % 19) * 0.04f - 0.36f;
+        }
+        for (size_t j = 0; j < biases.cols(); ++j) {
+            biases.data()[j] = static_cast<float>(j % 3) * 0.05f;
+        }
+        network.add_layer(ml::Layer(std::move(weights), std::move(biases), activations[l]));
+    }
+}
+
+bool same_weights(const ml::NeuralNetwork& a, const ml::NeuralNetwork& b, float tolerance) {
+    for (size_t l = 0; l < a.get_layers().size(); ++l) {
+        for (const auto& pair : {std::make_pair(&a.get_layers()[l].get_weights(), &b.get_layers()[l].get_weights()),
+                                 std::make_pair(&a.get_layers()[l].get_biases(), &b.get_layers()[l].get_biases())}) {
+            for (size_t i = 0; i < pair.first->rows() * pair.first->cols(); ++i) {
+                if (std::abs(pair.first->data()[i] - pair.second->data()[i]) > tolerance) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+void test_synchronous_matches_backward() {
+    // Without shuffling each step equals backward() on the same minibatch,
+    // including a short last one; only the summation order differs
+    ml::Matrix inputs(1, 1), targets(1, 1);
+    dataset(300, inputs, targets);
+    for (ml::OptimizerType type : {ml::OptimizerType::SGD, ml::OptimizerType::Adam}) {
+        ml::OptimizerConfig optimizer;
+        optimizer.type = type;
+        ml::NeuralNetwork trained, reference;
+        build_network(trained);
+        build_network(reference);
+        trained.set_optimizer(optimizer);
+        reference.set_optimizer(optimizer);
+        ml::TrainerConfig config;
+        config.batch_size = 64;
+        config.num_workers = 3;
+        config.shuffle = false;
+        ml::DataParallelTrainer trainer(trained, config);
+        float learning_rate = type == ml::OptimizerType::SGD ? 0.1f : 0.01f;
+
+        for (int epoch = 0; epoch < 2; ++epoch) {
+            ml::EpochStats stats = trainer.train_epoch(inputs, targets, learning_rate);
+            assert(stats.steps == 5);
+            double loss = 0.0;
+            for (size_t begin = 0; begin < 300; begin += 64) {
+                size_t rows = std::min<size_t>(64, 300 - begin);
+                ml::Matrix x(rows, 6), t(rows, 2);
+                std::memcpy(x.data(), inputs.data() + begin * 6, rows * 6 * sizeof(float));
+                std::memcpy(t.data(), targets.data() + begin * 2, rows * 2 * sizeof(float));
+                ml::Matrix y = reference.forward(x);
+                loss += ml::NeuralNetwork::mse_loss(y, t) * 2.0 * rows;
+                reference.backward(t, learning_rate);
+            }
+            assert(std::abs(stats.loss - loss / 600.0) < 1e-5);
+            assert(same_weights(trained, reference, 1e-5f));
+        }
+    }
+}
+
+void test_deterministic() {
+    ml::Matrix inputs(1, 1), targets(1, 1);
+    dataset(500, inputs, targets);
+
+    // Deterministic mode gives the same bits for any worker count; the
+    // default repeats for a fixed one
+    std::vector<std::unique_ptr<ml::NeuralNetwork>> networks;
+    for (size_t workers : {1, 3, 4, 7}) {
+        networks.push_back(std::make_unique<ml::NeuralNetwork>());
+        build_network(*networks.back());
+        ml::TrainerConfig config;
+        config.batch_size = 100;
+        config.num_workers = workers;
+        config.deterministic = true;
+        config.seed = 42;
+        ml::DataParallelTrainer trainer(*networks.back(), config);
+        for (int epoch = 0; epoch < 3; ++epoch) {
+            trainer.train_epoch(inputs, targets, 0.2f);
+        }
+    }
+    for (size_t i = 1; i < networks.size(); ++i) {
+        assert(same_weights(*networks[0], *networks[i], 0.0f));
+    }
+
+    ml::NeuralNetwork first, second;
+    for (ml::NeuralNetwork* network : {&first, &second}) {
+        build_network(*network);
+        ml::TrainerConfig config;
+        config.batch_size = 50;
+        config.num_workers = 5;
+        ml::DataParallelTrainer trainer(*network, config);
+        trainer.train_epoch(inputs, targets, 0.2f);
+        trainer.train_epoch(inputs, targets, 0.2f);
+    }
+    assert(same_weights(first, second, 0.0f));
+}
+
+void test_hogwild() {
+    ml::Matrix inputs(1, 1), targets(1, 1);
+    dataset(2000, inputs, targets);
+    ml::NeuralNetwork network;
+    build_network(network);
+    ml::TrainerConfig config;
+    config.batch_size = 16;
+    config.num_workers = 4;
+    config.mode = ml::TrainingMode::Hogwild;
+    ml::DataParallelTrainer trainer(network, config);
+    float first = trainer.train_epoch(inputs, targets, 0.1f).loss;
+    float last = first;
+    for (int epoch = 0; epoch < 10; ++epoch) {
+        last = trainer.train_epoch(inputs, targets, 0.1f).loss;
+    }
+    assert(std::isfinite(last) && last < first * 0.5f);
+
+    // Hogwild needs plain SGD and cannot be deterministic
+    ml::OptimizerConfig adam;
+    adam.type = ml::OptimizerType::Adam;
+    network.set_optimizer(adam);
+    bool threw = false;
+    try {
+        trainer.train_epoch(inputs, targets, 0.1f);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+    config.deterministic = true;
+    threw = false;
+    try {
+        ml::DataParallelTrainer bad(network, config);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+}
+
+void test_invalid_inputs() {
+    ml::NeuralNetwork network;
+    build_network(network);
+    ml::DataParallelTrainer trainer(network);
+    ml::Matrix inputs(10, 6), targets(10, 3);
+    bool threw = false;
+    try {
+        trainer.train_epoch(inputs, targets, 0.1f);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+
+    ml::NeuralNetwork empty;
+    ml::DataParallelTrainer empty_trainer(empty);
+    threw = false;
+    try {
+        empty_trainer.train_epoch(inputs, targets, 0.1f);
+    } catch (const std::logic_error&) {
+        threw = true;
+    }
+    assert(threw);
+}
+
+int main() {
+    // Enough pool threads that the workers really run concurrently
+    size_t threads = ml::get_num_threads();
+    ml::set_num_threads(4);
+    test_synchronous_matches_backward();
+    test_deterministic();
+    test_hogwild();
+    test_invalid_inputs();
+    ml::set_num_threads(threads);
+    std::cout << "All trainer tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,126 @@
+// Pre-warms the GEMM tuning cache for a network topology
+// Usage: mlcpp_tune (--layers 784,256,10 | --model model.mlcpp)
+//                   [--batch 1,8,64] [--training] [--threads N] [--output path]
+// Tunes every GEMM shape the network runs at the given batch sizes on this
+// host and writes the plans to the cache file (see src/gemm_tuning.hpp)
+#include "cpu_dispatch.hpp"
+#include "gemm_tuning.hpp"
+#include "model_io.hpp"
+#include "neural.hpp"
+#include "thread_pool.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+void usage() {
+    std::cerr << "usage: mlcpp_tune (--layers N,N,... | --model PATH) [--batch N,N,...] [--training]\n"
+                 "                  [--threads N] [--output PATH]\n";
+}
+
+std::vector<size_t> parse_sizes(const std::string& text) {
+    std::vector<size_t> sizes;
+    std::istringstream stream(text);
+    std::string field;
+    while (std::getline(stream, field, ',')) {
+        size_t used = 0;
+        unsigned long long value = std::stoull(field, &used);
+        if (used != field.size() || value == 0) {
+            throw std::invalid_argument("Not a positive size: " + field);
+        }
+        sizes.push_back(static_cast<size_t>(value));
+    }
+    if (sizes.empty()) {
+        throw std::invalid_argument("Empty size list");
+    }
+    return sizes;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::vector<size_t> layers, batches{1, 8, 64, 256};
+    std::string model, output;
+    bool training = false;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            auto value = [&]() -> std::string {
+                if (i + 1 >= argc) {
+                    throw std::invalid_argument("Missing value for " + arg);
+                }
+                return argv[++i];
+            };
+            if (arg == "--layers") {
+                layers = parse_sizes(value());
+            } else if (arg == "--model") {
+                model = value();
+            } else if (arg == "--batch") {
+                batches = parse_sizes(value());
+            } else if (arg == "--training") {
+                training = true;
+            } else if (arg == "--threads") {
+                ml::set_num_threads(parse_sizes(value()).front());
+            } else if (arg == "--output") {
+                output = value();
+            } else {
+                throw std::invalid_argument("Unknown option " + arg);
+            }
+        }
+        if (model.empty() == (layers.size() < 2)) {
+            throw std::invalid_argument("Give either --model or --layers with at least two sizes");
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "mlcpp_tune: " << e.what() << '\n';
+        usage();
+        return 2;
+    }
+
+    try {
+        std::unique_ptr<ml::NeuralNetwork> network;
+        if (!model.empty()) {
+            network = ml::load_network(model);
+        } else {
+            // Only the shapes matter, the activation does not change the GEMMs
+            network = std::make_unique<ml::NeuralNetwork>();
+            for (size_t l = 0; l + 1 < layers.size(); ++l) {
+                network->add_layer(layers[l], layers[l + 1], ml::ActivationType::ReLU);
+            }
+        }
+        if (output.empty()) {
+            output = ml::gemm_tuning_cache_path();
+            if (output.empty()) {
+                throw std::runtime_error("GEMM tuning cache is disabled; pass --output");
+            }
+        }
+
+        // Start from the plans already cached, so tuning another topology
+        // adds to them; only the buckets this network uses are retuned
+        ml::active_kernels();
+        std::cout << "Tuning " << ml::get_kernel_isa() << " kernels with " << ml::get_num_threads()
+                  << " threads\n";
+        for (const auto& [shape, result] : ml::tune_network(*network, batches, training)) {
+            double flops = 2.0 * shape.m * shape.n * shape.k;
+            const ml::GemmPlan& plan = result.plan;
+            std::string split = plan.threads == 0 ? "default"
+                                                  : std::to_string(plan.m_parts) + "x" + std::to_string(plan.n_parts);
+            std::printf("%6zu x %6zu x %6zu  %8.2f -> %8.2f GFLOP/s  mc %zu kc %zu nc %zu split %s\n",
+                        shape.m, shape.n, shape.k, flops / result.default_seconds * 1e-9,
+                        flops / result.tuned_seconds * 1e-9, plan.blocking.mc, plan.blocking.kc,
+                        plan.blocking.nc, split.c_str());
+        }
+        ml::save_gemm_tuning(output);
+        std::cout << "Wrote " << output << '\n';
+    } catch (const std::exception& e) {
+        std::cerr << "mlcpp_tune: " << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+}